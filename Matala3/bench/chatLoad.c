@@ -0,0 +1,327 @@
+#include <stdio.h>       // Include for printf and perror
+#include <stdlib.h>      // Include for atoi, atof, calloc and exit
+#include <string.h>      // Include for memchr, memmove and strstr
+#include <time.h>        // Include for clock_gettime
+#include <unistd.h>      // Include for read, write and close
+#include <errno.h>       // Include for EAGAIN and EINPROGRESS
+#include <stdint.h>      // Include for uint64_t
+#include <netdb.h>       // Include for getaddrinfo
+#include <sys/socket.h>  // Include for socket, connect and send
+#include <sys/epoll.h>   // Include for epoll watching every connection
+#include <sys/resource.h> // Include for raising the descriptor limit
+
+// Headless load generator for the chat servers (partA/server and partC/proactorServer).
+// Opens many non-blocking connections from one epoll loop, sends timestamped lines at a fixed
+// total rate spread over the connections, and measures how long each broadcast takes to reach
+// every other client. Latencies go into an HDR histogram (3 significant digits) and are reported
+// as percentiles; the full percentile distribution can be written in HdrHistogram's .hgrm format.
+// The timestamps are CLOCK_MONOTONIC, so the generator must run on the server's machine.
+// Usage: chatLoad [connections] [messagesPerSecond] [seconds] [host] [port] [hgrmFile]
+
+#define DEFAULT_CONNECTIONS 1000 // Concurrent clients
+#define DEFAULT_RATE 1000        // Messages per second sent by all clients together
+#define DEFAULT_SECONDS 10       // Length of the measured run
+#define DEFAULT_HOST "127.0.0.1" // Server address
+#define DEFAULT_PORT "8080"      // Server port
+#define CONNECT_TIMEOUT_MS 10000 // Time allowed for every connection to complete
+#define DRAIN_MS 2000            // Time to wait for broadcasts still in flight after the last send
+#define LINE_BUFFER_SIZE 8192    // Unfinished line kept per connection
+#define MAX_EVENTS 512           // Events harvested by one epoll_wait call
+#define MESSAGE_MARKER "load "   // Text in front of the timestamp of every sent line
+
+// HDR histogram layout: values are kept with 11 bits of precision (3 significant decimal digits)
+// in power-of-two buckets, so relative error stays under 0.1% from nanoseconds to minutes
+#define HDR_SUB_BUCKET_BITS 11
+#define HDR_SUB_BUCKET_COUNT (1 << HDR_SUB_BUCKET_BITS)
+#define HDR_SUB_BUCKET_HALF (HDR_SUB_BUCKET_COUNT / 2)
+#define HDR_BUCKET_COUNT 30 // Covers values up to 2^40 ns (about 18 minutes)
+#define HDR_COUNTS ((HDR_BUCKET_COUNT + 1) * HDR_SUB_BUCKET_HALF)
+
+// Structure representing a latency histogram
+typedef struct {
+    uint64_t counts[HDR_COUNTS]; // Number of values recorded per slot
+    uint64_t total;              // Number of values recorded
+    uint64_t maximum;            // Largest value recorded
+} HdrHistogram;
+
+// Structure representing one simulated client
+typedef struct {
+    int socket;                  // Connection to the server
+    int connected;               // Non-zero once the connect completed
+    char line[LINE_BUFFER_SIZE]; // Start of a line split across reads
+    size_t lineLength;           // Bytes in line
+} LoadClient;
+
+static HdrHistogram latencies;   // End-to-end broadcast latencies in nanoseconds
+static long deliveries = 0;      // Timestamped lines received
+static long sendsBlocked = 0;    // Sends skipped because the socket buffer was full
+
+// Helper function to read a monotonic clock in nanoseconds
+static uint64_t nowNanoseconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+// Helper function to find the slot of a value
+static int hdrIndex(uint64_t value) {
+    int bucket = 64 - __builtin_clzll(value | (HDR_SUB_BUCKET_COUNT - 1)) - HDR_SUB_BUCKET_BITS; // 0 below HDR_SUB_BUCKET_COUNT
+    if (bucket >= HDR_BUCKET_COUNT) return HDR_COUNTS - 1; // Clamp absurd values into the last slot
+    int subBucket = (int)(value >> bucket);
+    return ((bucket + 1) << (HDR_SUB_BUCKET_BITS - 1)) + (subBucket - HDR_SUB_BUCKET_HALF);
+}
+
+// Helper function to return the largest value a slot stands for
+static uint64_t hdrHighestValue(int index) {
+    int bucket = (index >> (HDR_SUB_BUCKET_BITS - 1)) - 1;
+    int subBucket = (index & (HDR_SUB_BUCKET_HALF - 1)) + HDR_SUB_BUCKET_HALF;
+    if (bucket < 0) { // The first half bucket holds the smallest values one by one
+        subBucket -= HDR_SUB_BUCKET_HALF;
+        bucket = 0;
+    }
+    return ((uint64_t)subBucket << bucket) + ((1ULL << bucket) - 1);
+}
+
+// Helper function to return the value reported for a slot: its highest value, but never more than the maximum
+static uint64_t hdrValue(const HdrHistogram* histogram, int index) {
+    uint64_t value = hdrHighestValue(index);
+    return value < histogram->maximum ? value : histogram->maximum;
+}
+
+// Helper function to record one value
+static void hdrRecord(HdrHistogram* histogram, uint64_t value) {
+    histogram->counts[hdrIndex(value)]++;
+    histogram->total++;
+    if (value > histogram->maximum) histogram->maximum = value;
+}
+
+// Helper function to return the value below which a percentile of the recorded values fall
+static uint64_t hdrPercentile(const HdrHistogram* histogram, double percentile) {
+    uint64_t wanted = (uint64_t)(percentile / 100.0 * histogram->total + 0.5);
+    if (wanted == 0) wanted = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HDR_COUNTS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= wanted) return hdrValue(histogram, i);
+    }
+    return histogram->maximum;
+}
+
+// Helper function to write the percentile distribution in HdrHistogram's .hgrm text format (microseconds)
+static void hdrWriteDistribution(const HdrHistogram* histogram, FILE* file) {
+    fprintf(file, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+    uint64_t seen = 0;
+    for (int i = 0; i < HDR_COUNTS; i++) {
+        if (histogram->counts[i] == 0) continue;
+        seen += histogram->counts[i];
+        double fraction = (double)seen / histogram->total;
+        if (fraction < 1.0) {
+            fprintf(file, "%12.3f %14.12f %10lu %14.2f\n", hdrValue(histogram, i) / 1000.0, fraction, (unsigned long)seen, 1.0 / (1.0 - fraction));
+        } else {
+            fprintf(file, "%12.3f %14.12f %10lu\n", hdrValue(histogram, i) / 1000.0, fraction, (unsigned long)seen);
+        }
+    }
+    fprintf(file, "#[Max = %12.3f, Total count = %12lu]\n", histogram->maximum / 1000.0, (unsigned long)histogram->total);
+}
+
+// Helper function to take the timestamps out of every complete line received by a client
+static void handleLines(LoadClient* client, uint64_t now) {
+    char* start = client->line;
+    char* end = client->line + client->lineLength;
+    char* newline;
+    while ((newline = (char*)memchr(start, '\n', (size_t)(end - start))) != NULL) {
+        *newline = '\0';
+        char* marker = strstr(start, MESSAGE_MARKER); // Lines look like "Client N: load <ns>" or "Client N says: load <ns>"
+        if (marker != NULL) {
+            uint64_t sent = strtoull(marker + strlen(MESSAGE_MARKER), NULL, 10);
+            if (sent != 0 && sent <= now) {
+                hdrRecord(&latencies, now - sent);
+                deliveries++;
+            }
+        }
+        start = newline + 1;
+    }
+    client->lineLength = (size_t)(end - start);
+    memmove(client->line, start, client->lineLength); // Keep the unfinished line
+    if (client->lineLength == sizeof(client->line)) client->lineLength = 0; // A line this long is not ours
+}
+
+// Helper function to read everything a client received
+static int readClient(LoadClient* client) {
+    while (1) {
+        ssize_t received = read(client->socket, client->line + client->lineLength, sizeof(client->line) - client->lineLength);
+        if (received > 0) {
+            client->lineLength += (size_t)received;
+            handleLines(client, nowNanoseconds());
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        if (received < 0 && errno == EINTR) continue;
+        return -1; // Closed by the server or failed
+    }
+}
+
+// Helper function to send one timestamped line from a client
+static void sendMessage(LoadClient* client) {
+    char message[64];
+    int length = snprintf(message, sizeof(message), MESSAGE_MARKER "%llu\n", (unsigned long long)nowNanoseconds());
+    ssize_t sent = send(client->socket, message, (size_t)length, MSG_NOSIGNAL);
+    if (sent < length) sendsBlocked++; // A full socket buffer means the server is not keeping up; the line is dropped
+    if (sent > 0 && sent < length) client->connected = 0; // Half a line went out: stop sending on this client
+}
+
+// Helper function to open every connection and wait until they are established; returns how many are
+static int connectClients(LoadClient* clients, int count, const char* host, const char* port, int epollDescriptor) {
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo* address;
+    int error = getaddrinfo(host, port, &hints, &address);
+    if (error != 0) {
+        fprintf(stderr, "Error resolving %s: %s\n", host, gai_strerror(error));
+        exit(EXIT_FAILURE);
+    }
+    int pending = 0;
+    for (int i = 0; i < count; i++) {
+        clients[i].socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (clients[i].socket < 0) {
+            perror("Error creating socket (raise ulimit -n or use fewer connections)");
+            exit(EXIT_FAILURE);
+        }
+        if (connect(clients[i].socket, address->ai_addr, address->ai_addrlen) < 0 && errno != EINPROGRESS) {
+            perror("Error connecting");
+            close(clients[i].socket);
+            clients[i].socket = -1;
+            continue;
+        }
+        struct epoll_event event = { .events = EPOLLOUT, .data.u32 = (uint32_t)i };
+        epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, clients[i].socket, &event);
+        pending++;
+    }
+    freeaddrinfo(address);
+
+    // Wait for the connects to complete, then watch the connections for broadcasts
+    int connected = 0;
+    uint64_t deadline = nowNanoseconds() + CONNECT_TIMEOUT_MS * 1000000ULL;
+    struct epoll_event events[MAX_EVENTS];
+    while (pending > 0 && nowNanoseconds() < deadline) {
+        int ready = epoll_wait(epollDescriptor, events, MAX_EVENTS, 100);
+        for (int i = 0; i < ready; i++) {
+            LoadClient* client = &clients[events[i].data.u32];
+            int socketError = 0;
+            socklen_t errorLength = sizeof(socketError);
+            getsockopt(client->socket, SOL_SOCKET, SO_ERROR, &socketError, &errorLength);
+            pending--;
+            if (socketError != 0) {
+                fprintf(stderr, "Connection %u failed: %s\n", events[i].data.u32, strerror(socketError));
+                epoll_ctl(epollDescriptor, EPOLL_CTL_DEL, client->socket, NULL);
+                close(client->socket);
+                client->socket = -1;
+                continue;
+            }
+            struct epoll_event event = { .events = EPOLLIN | EPOLLRDHUP, .data.u32 = events[i].data.u32 };
+            epoll_ctl(epollDescriptor, EPOLL_CTL_MOD, client->socket, &event);
+            client->connected = 1;
+            connected++;
+        }
+    }
+    return connected;
+}
+
+// Helper function to serve the connections until a deadline, sending at the given rate while sending is set
+static long runLoad(LoadClient* clients, int count, int epollDescriptor, double rate, uint64_t start, uint64_t until, int sending) {
+    struct epoll_event events[MAX_EVENTS];
+    static long sent = 0;     // Messages sent since the measured run started
+    static int nextClient = 0; // Round-robin cursor over the clients
+    uint64_t now;
+    while ((now = nowNanoseconds()) < until) {
+        // Send what the rate asks for by now, one client after another
+        long due = sending ? (long)((now - start) / 1e9 * rate) : sent;
+        for (int tries = 0; sent < due && tries < count; tries++) {
+            LoadClient* client = &clients[nextClient];
+            nextClient = (nextClient + 1) % count;
+            if (!client->connected) continue;
+            sendMessage(client);
+            sent++;
+            tries = -1; // Sent: look for the next client from scratch
+        }
+
+        int ready = epoll_wait(epollDescriptor, events, MAX_EVENTS, 1); // Wake every millisecond to keep the rate smooth
+        for (int i = 0; i < ready; i++) {
+            LoadClient* client = &clients[events[i].data.u32];
+            if (readClient(client) < 0 || (events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+                epoll_ctl(epollDescriptor, EPOLL_CTL_DEL, client->socket, NULL);
+                client->connected = 0;
+            }
+        }
+    }
+    return sent;
+}
+
+int main(int argc, char* argv[]) {
+    int connections = argc > 1 ? atoi(argv[1]) : DEFAULT_CONNECTIONS;
+    double rate = argc > 2 ? atof(argv[2]) : DEFAULT_RATE;
+    int seconds = argc > 3 ? atoi(argv[3]) : DEFAULT_SECONDS;
+    const char* host = argc > 4 ? argv[4] : DEFAULT_HOST;
+    const char* port = argc > 5 ? argv[5] : DEFAULT_PORT;
+    const char* hgrmPath = argc > 6 ? argv[6] : NULL;
+    if (connections < 2 || rate <= 0 || seconds < 1) {
+        fprintf(stderr, "Usage: %s [connections] [messagesPerSecond] [seconds] [host] [port] [hgrmFile]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    // Thousands of connections need more descriptors than the usual soft limit
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < (rlim_t)connections + 16) {
+        limit.rlim_cur = limit.rlim_max < (rlim_t)connections + 16 ? limit.rlim_max : (rlim_t)connections + 16;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    LoadClient* clients = (LoadClient*)calloc((size_t)connections, sizeof(LoadClient));
+    int epollDescriptor = epoll_create1(0);
+    if (clients == NULL || epollDescriptor < 0) {
+        perror("Error allocating the load generator");
+        exit(EXIT_FAILURE);
+    }
+    int connected = connectClients(clients, connections, host, port, epollDescriptor);
+    printf("%d of %d connections established to %s:%s\n", connected, connections, host, port);
+    if (connected < 2) exit(EXIT_FAILURE);
+
+    // Let the server finish registering the clients, then measure
+    uint64_t start = nowNanoseconds();
+    runLoad(clients, connections, epollDescriptor, rate, start, start + 500000000ULL, 0);
+    deliveries = 0;
+    memset(&latencies, 0, sizeof(latencies));
+    start = nowNanoseconds();
+    long sent = runLoad(clients, connections, epollDescriptor, rate, start, start + (uint64_t)seconds * 1000000000ULL, 1);
+    uint64_t sendingEnded = nowNanoseconds();
+    runLoad(clients, connections, epollDescriptor, rate, start, sendingEnded + DRAIN_MS * 1000000ULL, 0); // Collect the stragglers
+    double elapsed = (sendingEnded - start) / 1e9;
+
+    int stillConnected = 0;
+    for (int i = 0; i < connections; i++) stillConnected += clients[i].connected;
+    long expected = sent * (long)(connected - 1); // Every message goes to every other client
+    printf("sent %ld messages in %.2f s (%.0f msg/s), %ld dropped on full socket buffers\n",
+           sent, elapsed, sent / elapsed, sendsBlocked);
+    printf("received %ld of %ld expected deliveries (%.1f%%), %.0f deliveries/s, %d connections still open\n",
+           deliveries, expected, expected ? 100.0 * deliveries / expected : 0.0, deliveries / elapsed, stillConnected);
+    if (latencies.total > 0) {
+        printf("latency us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+               hdrPercentile(&latencies, 50) / 1000.0, hdrPercentile(&latencies, 90) / 1000.0,
+               hdrPercentile(&latencies, 99) / 1000.0, hdrPercentile(&latencies, 99.9) / 1000.0, latencies.maximum / 1000.0);
+    }
+    if (hgrmPath != NULL) {
+        FILE* file = fopen(hgrmPath, "w");
+        if (file == NULL) {
+            perror("Error opening histogram file");
+        } else {
+            hdrWriteDistribution(&latencies, file);
+            fclose(file);
+        }
+    }
+
+    for (int i = 0; i < connections; i++) {
+        if (clients[i].socket >= 0) close(clients[i].socket);
+    }
+    close(epollDescriptor);
+    free(clients);
+    return 0;
+}
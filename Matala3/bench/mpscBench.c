@@ -0,0 +1,164 @@
+#include <stdio.h>       // Include for printf and perror
+#include <stdlib.h>      // Include for atoi, malloc and exit
+#include <time.h>        // Include for clock_gettime
+#include <unistd.h>      // Include for read and close
+#include <sched.h>       // Include for sched_yield while a queue is empty
+#include <stdint.h>      // Include for uint64_t
+#include <pthread.h>     // Include for the producer threads and the mutex baseline
+#include <sys/eventfd.h> // Include for the eventfd waking the consumer
+#include "mpscQueue.h"   // Include the queue being measured
+
+// Measures handing items from 1 to 32 producer threads to one consumer, the way tasks reach an
+// event loop: through a mutex-protected array (how the servers share their lists) and through
+// the lock-free queue, once with a polling consumer and once with one sleeping on an eventfd.
+// Usage: mpscBench [itemsPerProducer]
+
+#define DEFAULT_ITEMS 100000 // Items every producer hands over
+#define MAX_PRODUCERS 32     // Largest number of producers measured
+
+// Structure representing one handed-over item
+typedef struct BenchItem {
+    MpscNode node;  // Link in the lock-free queue
+    int producer;   // Thread that produced it
+    int sequence;   // Position in that thread's output, checked for FIFO order
+} BenchItem;
+
+// Ways of handing items over
+enum { MODE_MUTEX, MODE_MPSC_POLL, MODE_MPSC_EVENTFD };
+static const char* modeNames[] = { "mutex+array", "mpsc (poll)", "mpsc (eventfd)" };
+
+static int itemsPerProducer;         // Items every producer hands over
+static BenchItem* items;             // Every item, producer after producer
+static pthread_barrier_t startLine;  // Releases the producers and the consumer together
+static int mode;                     // MODE_* of the current run
+
+// Mutex baseline: producers append to one array, the consumer swaps it for its own empty one
+static pthread_mutex_t arrayMutex = PTHREAD_MUTEX_INITIALIZER;
+static BenchItem** sharedArray;      // Items appended by the producers
+static int sharedCount;              // Entries in sharedArray
+static BenchItem** consumerArray;    // Array the consumer is working through
+
+static MpscQueue queue;              // Lock-free queue of the mpsc runs
+
+// Helper function to read a monotonic clock in nanoseconds
+static double nowNanoseconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+// Function run by every producer
+static void* produce(void* arg) {
+    BenchItem* own = &items[(long)(intptr_t)arg * itemsPerProducer];
+    pthread_barrier_wait(&startLine);
+    for (int i = 0; i < itemsPerProducer; i++) {
+        if (mode == MODE_MUTEX) {
+            pthread_mutex_lock(&arrayMutex);
+            sharedArray[sharedCount++] = &own[i];
+            pthread_mutex_unlock(&arrayMutex);
+        } else {
+            mpscQueuePush(&queue, &own[i].node);
+        }
+    }
+    return NULL;
+}
+
+// Helper function to check that a producer's items arrive in the order it produced them
+static void checkOrder(int* nextSequence, const BenchItem* item) {
+    if (item->sequence != nextSequence[item->producer]++) {
+        fprintf(stderr, "Producer %d item %d arrived out of order\n", item->producer, item->sequence);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Helper function to consume every item on the calling thread
+static void consume(long total) {
+    int nextSequence[MAX_PRODUCERS] = { 0 };
+    long received = 0;
+    uint64_t counter;
+    while (received < total) {
+        if (mode == MODE_MUTEX) {
+            pthread_mutex_lock(&arrayMutex);
+            BenchItem** taken = sharedArray; // Swap the arrays so producers never wait for the consumer
+            int count = sharedCount;
+            sharedArray = consumerArray;
+            sharedCount = 0;
+            pthread_mutex_unlock(&arrayMutex);
+            consumerArray = taken;
+            for (int i = 0; i < count; i++) checkOrder(nextSequence, taken[i]);
+            received += count;
+            if (count == 0) sched_yield();
+            continue;
+        }
+        if (mode == MODE_MPSC_EVENTFD) {
+            if (read(queue.wakeDescriptor, &counter, sizeof(counter)) < 0) perror("Error reading eventfd"); // Sleep until pushed
+            mpscQueueAcknowledge(&queue);
+        }
+        MpscNode* node;
+        int popped = 0;
+        while ((node = mpscQueuePop(&queue)) != NULL) {
+            checkOrder(nextSequence, (BenchItem*)node);
+            popped++;
+        }
+        received += popped;
+        if (popped == 0 && mode == MODE_MPSC_POLL) sched_yield();
+    }
+}
+
+// Helper function to time one run and return the nanoseconds per item
+static double runOnce(int producers) {
+    long total = (long)producers * itemsPerProducer;
+    for (long i = 0; i < total; i++) {
+        items[i].producer = (int)(i / itemsPerProducer);
+        items[i].sequence = (int)(i % itemsPerProducer);
+    }
+    sharedCount = 0;
+    int wakeDescriptor = -1;
+    if (mode == MODE_MPSC_EVENTFD && (wakeDescriptor = eventfd(0, 0)) < 0) {
+        perror("Error creating eventfd");
+        exit(EXIT_FAILURE);
+    }
+    mpscQueueInit(&queue, wakeDescriptor);
+
+    pthread_t threads[MAX_PRODUCERS];
+    pthread_barrier_init(&startLine, NULL, (unsigned)producers + 1);
+    for (int i = 0; i < producers; i++) pthread_create(&threads[i], NULL, produce, (void*)(intptr_t)i);
+    pthread_barrier_wait(&startLine);
+    double start = nowNanoseconds();
+    consume(total);
+    double elapsed = nowNanoseconds() - start;
+    for (int i = 0; i < producers; i++) pthread_join(threads[i], NULL);
+    pthread_barrier_destroy(&startLine);
+    if (wakeDescriptor >= 0) close(wakeDescriptor);
+    return elapsed / total;
+}
+
+int main(int argc, char* argv[]) {
+    itemsPerProducer = argc > 1 ? atoi(argv[1]) : DEFAULT_ITEMS;
+    if (itemsPerProducer < 1) {
+        fprintf(stderr, "Usage: %s [itemsPerProducer]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    size_t capacity = (size_t)MAX_PRODUCERS * itemsPerProducer;
+    items = (BenchItem*)malloc(capacity * sizeof(BenchItem));
+    sharedArray = (BenchItem**)malloc(capacity * sizeof(BenchItem*));
+    consumerArray = (BenchItem**)malloc(capacity * sizeof(BenchItem*));
+    if (items == NULL || sharedArray == NULL || consumerArray == NULL) {
+        perror("Error allocating the benchmark");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%d items per producer, %ld online cores; ns per item (lower is better)\n",
+           itemsPerProducer, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%9s %14s %14s %14s\n", "producers", modeNames[MODE_MUTEX], modeNames[MODE_MPSC_POLL], modeNames[MODE_MPSC_EVENTFD]);
+    for (int producers = 1; producers <= MAX_PRODUCERS; producers *= 2) {
+        printf("%9d", producers);
+        for (mode = MODE_MUTEX; mode <= MODE_MPSC_EVENTFD; mode++) printf(" %14.1f", runOnce(producers));
+        printf("\n");
+    }
+
+    free(consumerArray);
+    free(sharedArray);
+    free(items);
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include <stdio.h>       // Include for printf and perror
+#include <stdlib.h>      // Include for atoi, malloc and exit
+#include <string.h>      // Include for strlen
+#include <time.h>        // Include for clock_gettime
+#include <unistd.h>      // Include for read and close
+#include <fcntl.h>       // Include for fcntl used to make the reading ends non-blocking
+#include <pthread.h>     // Include for the thread draining the clients
+#include <sys/socket.h>  // Include for socketpair
+#include <sys/epoll.h>   // Include for epoll used by the draining thread
+#include "proactor.h"    // Include the proactor queueing the output
+#include "roomTable.h"   // Include the rooms being measured
+
+// Measures what one message costs when it is sent to a room instead of to every client.
+// Every simulated client is a socket pair: the proactor writes one end, a thread drains the other.
+// The benchmark is linked with --wrap for malloc, calloc and realloc, so every heap allocation the
+// library makes is counted; once a warm-up fills the memory pool, the message path should make none.
+// Usage: roomBench [rooms] [membersPerRoom] [clients] [messages]
+
+#define DEFAULT_ROOMS 1000      // Number of rooms
+#define DEFAULT_MEMBERS 10      // Members per room
+#define DEFAULT_CLIENTS 2000    // Distinct sockets; each is a member of rooms * members / clients rooms
+#define DEFAULT_MESSAGES 100000 // Messages sent to rooms
+#define FLAT_MESSAGES 1000      // Messages sent to the room holding every client
+
+static int* readEnds;          // Ends of the socket pairs the draining thread reads
+static int clientCount;        // Number of socket pairs
+static int draining = 1;       // Cleared to stop the draining thread
+static long heapAllocations = 0; // Calls to malloc, calloc and realloc made by the whole process
+
+// Allocation counter: the linker sends every call to malloc, calloc and realloc here first
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* block, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    __atomic_add_fetch(&heapAllocations, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    __atomic_add_fetch(&heapAllocations, 1, __ATOMIC_RELAXED);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* block, size_t size) {
+    __atomic_add_fetch(&heapAllocations, 1, __ATOMIC_RELAXED);
+    return __real_realloc(block, size);
+}
+
+// Helper function to read a monotonic clock in nanoseconds
+static double nowNanoseconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+// Function run by the thread keeping the clients' receive buffers empty
+static void* drainClients(void* unused) {
+    (void)unused;
+    int epollDescriptor = epoll_create1(0);
+    for (int i = 0; i < clientCount; i++) {
+        struct epoll_event event = { .events = EPOLLIN, .data.fd = readEnds[i] };
+        epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, readEnds[i], &event);
+    }
+    struct epoll_event events[256];
+    char buffer[65536];
+    while (__atomic_load_n(&draining, __ATOMIC_ACQUIRE)) {
+        int ready = epoll_wait(epollDescriptor, events, 256, 100);
+        for (int i = 0; i < ready; i++) {
+            while (read(events[i].data.fd, buffer, sizeof(buffer)) > 0) {} // Read until EAGAIN
+        }
+    }
+    close(epollDescriptor);
+    return NULL;
+}
+
+// Helper function to send messages round-robin over rooms and return the nanoseconds per message
+static double sendMessages(RoomTable* table, int roomCount, const char* prefix, int messages, long* deliveries) {
+    char name[ROOM_NAME_MAX + 1];
+    const char text[] = "Client 1 says: benchmark message\n";
+    struct iovec part = { .iov_base = (void*)text, .iov_len = sizeof(text) - 1 };
+    double start = nowNanoseconds();
+    for (int i = 0; i < messages; i++) {
+        int nameLength = roomCount > 1 ? snprintf(name, sizeof(name), "%s%d", prefix, i % roomCount)
+                                       : snprintf(name, sizeof(name), "%s", prefix);
+        ProactorMessage* message = createProactorMessage(&part, 1); // Built per message, as the server does
+        int delivered = roomTableSend(table, name, (size_t)nameLength, -1, &message, 1);
+        if (delivered > 0) *deliveries += delivered;
+        releaseProactorMessage(message);
+    }
+    return (nowNanoseconds() - start) / messages;
+}
+
+int main(int argc, char* argv[]) {
+    int roomCount = argc > 1 ? atoi(argv[1]) : DEFAULT_ROOMS;
+    int membersPerRoom = argc > 2 ? atoi(argv[2]) : DEFAULT_MEMBERS;
+    clientCount = argc > 3 ? atoi(argv[3]) : DEFAULT_CLIENTS;
+    int messages = argc > 4 ? atoi(argv[4]) : DEFAULT_MESSAGES;
+    if (roomCount < 1 || membersPerRoom < 1 || clientCount < membersPerRoom || messages < 1) {
+        fprintf(stderr, "Usage: %s [rooms] [membersPerRoom] [clients] [messages]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    initializeProactor();
+    setDefaultOutputLimits(0, 0, PROACTOR_OVERFLOW_DISCONNECT); // Unbounded: the benchmark never drops output
+    RoomTable* table = createRoomTable();
+    readEnds = (int*)malloc((size_t)clientCount * sizeof(int));
+    int* writeEnds = (int*)malloc((size_t)clientCount * sizeof(int));
+    if (table == NULL || readEnds == NULL || writeEnds == NULL) {
+        perror("Error allocating the benchmark");
+        exit(EXIT_FAILURE);
+    }
+
+    // Create the clients and register the ends the proactor writes
+    for (int i = 0; i < clientCount; i++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+            perror("Error creating socket pair (raise ulimit -n or pass fewer clients)");
+            exit(EXIT_FAILURE);
+        }
+        writeEnds[i] = pair[0];
+        readEnds[i] = pair[1];
+        fcntl(readEnds[i], F_SETFL, fcntl(readEnds[i], F_GETFL) | O_NONBLOCK);
+        if (registerSocketWithContext(writeEnds[i], NULL, NULL, PROACTOR_WRITE_ONLY) < 0) {
+            perror("Error registering client");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Fill the rooms; member j of room r is client (r * membersPerRoom + j) % clients
+    char name[ROOM_NAME_MAX + 1];
+    for (int room = 0; room < roomCount; room++) {
+        int nameLength = snprintf(name, sizeof(name), "room-%d", room);
+        for (int j = 0; j < membersPerRoom; j++) {
+            roomTableSubscribe(table, name, (size_t)nameLength, writeEnds[(room * membersPerRoom + j) % clientCount], 0);
+        }
+    }
+    // The old behaviour for comparison: one room everybody is in
+    for (int i = 0; i < clientCount; i++) roomTableSubscribe(table, "everyone", 8, writeEnds[i], 0);
+
+    pthread_t drainer;
+    pthread_create(&drainer, NULL, drainClients, NULL);
+
+    long roomDeliveries = 0, flatDeliveries = 0, warmUpDeliveries = 0;
+    sendMessages(table, roomCount, "room-", messages / 10 + 1, &warmUpDeliveries); // Fills the pool's caches and depots
+    long allocationsBefore = __atomic_load_n(&heapAllocations, __ATOMIC_RELAXED);
+    double roomCost = sendMessages(table, roomCount, "room-", messages, &roomDeliveries);
+    long roomAllocations = __atomic_load_n(&heapAllocations, __ATOMIC_RELAXED) - allocationsBefore;
+    double flatCost = sendMessages(table, 1, "everyone", FLAT_MESSAGES, &flatDeliveries);
+
+    printf("%d rooms x %d members over %d clients (%d rooms in the table)\n",
+           roomCount, membersPerRoom, clientCount, roomTableSize(table));
+    printf("room send:  %10.0f ns/message  %6.1f ns/delivery  (%d messages)\n",
+           roomCost, roomCost * messages / (roomDeliveries ? roomDeliveries : 1), messages);
+    printf("everyone:   %10.0f ns/message  %6.1f ns/delivery  (%d messages)\n",
+           flatCost, flatCost * FLAT_MESSAGES / (flatDeliveries ? flatDeliveries : 1), FLAT_MESSAGES);
+    printf("a room message costs %.1fx less than a message to everyone\n", flatCost / roomCost);
+    printf("heap allocations after warm-up: %ld during %d room messages (%.4f per message)\n",
+           roomAllocations, messages, (double)roomAllocations / messages);
+
+    __atomic_store_n(&draining, 0, __ATOMIC_RELEASE);
+    pthread_join(drainer, NULL);
+    for (int i = 0; i < clientCount; i++) {
+        roomTableUnsubscribeAll(table, writeEnds[i]);
+        unregisterSocket(writeEnds[i]);
+        close(writeEnds[i]);
+        close(readEnds[i]);
+    }
+    destroyRoomTable(table);
+    cleanupProactor();
+    free(writeEnds);
+    free(readEnds);
+    return 0;
+}
@@ -79,10 +79,11 @@ int main()
 
     // The primary thread listens for server messages
     char serverResponse[BUFFER_SIZE]; // Buffer for server response
+    char pendingLine[BUFFER_SIZE]; // Start of a line whose end has not arrived yet, so a split "/ping" is still recognised
+    size_t pendingLength = 0; // Bytes held in pendingLine
     while(1) {
         bzero(serverResponse, BUFFER_SIZE); // Clear the buffer
-        ssize_t bytesReceived = recv(clientSocket, serverResponse, BUFFER_SIZE, 0); // Receive message from server
-        serverResponse[bytesReceived] ='\0'; // Null-terminate the response
+        ssize_t bytesReceived = recv(clientSocket, serverResponse, BUFFER_SIZE - 1, 0); // Receive message from server
         if (bytesReceived < 0) {
             perror("Error: Unable to read message from server"); // Handle recv error
             exit(EXIT_FAILURE); // Exit the program on error
@@ -90,7 +91,42 @@ int main()
             printf("Server connection closed\n"); // Notify user that server connection is closed
             break; // Break the loop to end program
         }
-        printf("%s\n", serverResponse); // Print the server response
+        serverResponse[bytesReceived] = '\0'; // Null-terminate the response
+        // Print the server response line by line, answering the server's heartbeats instead of showing them
+        char *line = serverResponse;
+        while (*line != '\0') {
+            char *lineEnd = strchr(line, '\n'); // The response is sent as newline-terminated lines
+            if (lineEnd == NULL) { // The rest of the line comes with a later read
+                size_t restLength = strlen(line);
+                if (pendingLength + restLength <= sizeof(pendingLine)) {
+                    memcpy(pendingLine + pendingLength, line, restLength); // Keep it until its end arrives
+                    pendingLength += restLength;
+                } else {
+                    printf("%.*s%s", (int)pendingLength, pendingLine, line); // Far too long to be a heartbeat, print it as it comes
+                    pendingLength = 0;
+                }
+                break;
+            }
+            size_t lineLength = (size_t)(lineEnd - line) + 1;
+            const char *completeLine = line; // The whole line, joined with what earlier reads held back
+            size_t completeLength = lineLength;
+            if (pendingLength > 0) {
+                if (pendingLength + lineLength <= sizeof(pendingLine)) {
+                    memcpy(pendingLine + pendingLength, line, lineLength);
+                    completeLine = pendingLine;
+                    completeLength = pendingLength + lineLength;
+                } else {
+                    printf("%.*s", (int)pendingLength, pendingLine); // Too long to be a heartbeat
+                }
+                pendingLength = 0;
+            }
+            if (completeLength == 6 && strncmp(completeLine, "/ping\n", 6) == 0) {
+                if (send(clientSocket, "/pong\n", 6, 0) < 0) perror("Error: Unable to answer the server's ping"); // Show the server we are alive
+            } else {
+                printf("%.*s", (int)completeLength, completeLine); // Print the line
+            }
+            line += lineLength;
+        }
         fflush(stdout); // Flush the stdout buffer
     }
 
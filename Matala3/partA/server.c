@@ -7,92 +7,385 @@
 #include <netinet/in.h>  // Internet address family
 #include <unistd.h>      // POSIX operating system API
 #include <stdbool.h>     // Boolean data type
+#include "proactor.h"    // Proactor library queueing the output of every client
+#include "roomTable.h"   // Rooms and the recipient snapshots used to fan messages out
+#include "chatFrame.h"   // Framing of the messages exchanged with the clients
+#include "proactorLog.h" // Buffered logging that keeps stdout off the hot path
+#include "memoryPool.h"  // Slab pool the per-client allocations come from
 
-#define BUFFER_SIZE 1024 // Define buffer size for messages
+#define BUFFER_SIZE 65536 // Define buffer size for reads; one read may carry many messages
+#define MAX_MESSAGE_SIZE 4096 // Longest message text accepted from a client
+#define LOBBY_ROOM "lobby" // Room every client joins on connect; plain text messages go there
+#define FORMAT_LINE 0      // Message variant for clients reading newline-terminated text
+#define FORMAT_FRAMED 1    // Message variant for clients reading length-prefixed frames
 #define MAX_CLIENTS 10000 // Define maximum number of clients
+#define OUTPUT_HIGH_WATERMARK (256 * 1024) // Unsent bytes a client may fall behind before the slow-consumer policy applies
+#define OUTPUT_LOW_WATERMARK (64 * 1024)   // Backlog a paused sender waits for
+#define LOG_RING_BYTES (16 * 1024) // Log buffer of every thread; small, as every client has a thread outside multi-reactor mode
+#define ADMIN_SOCKET_PATH "/tmp/chatServer.sock" // Unix socket answering with the metrics, e.g. nc -U
+#ifndef HEARTBEAT_INTERVAL_MS
+#define HEARTBEAT_INTERVAL_MS 30000 // Silence after which a client is pinged
+#endif
+#ifndef IDLE_TIMEOUT_MS
+#define IDLE_TIMEOUT_MS 90000 // Silence after which a client is disconnected
+#endif
 
 // Global variables for managing clients and mutex
-int clientSockets[MAX_CLIENTS]; // Array to hold client sockets
+// Structure representing one entry of the client table
+typedef struct {
+    int socket;   // Client socket, -1 while the slot is free
+    int nextFree; // Next free slot while this one is free, -1 at the end of the free list
+} ClientSlot;
+
+ClientSlot clientSlots[MAX_CLIENTS]; // Table of client sockets; a client keeps its slot index while connected
+int firstFreeSlot = -1; // Head of the list of released slots
+int slotsHandedOut = 0; // Slots below this index have been used; the ones above were never touched
 int numClients = 0; // Counter for the number of connected clients
-pthread_mutex_t clientMutex = PTHREAD_MUTEX_INITIALIZER; // Mutex for synchronizing access to clientSockets
+pthread_mutex_t clientMutex = PTHREAD_MUTEX_INITIALIZER; // Mutex for synchronizing access to clientSlots
 int clientCounter = 0; // Counter to assign client numbers
+RoomTable* rooms; // Rooms and their subscribers; a message only costs as much as its room
+int clientsGauge = -1; // Metric of the connected clients
+int messagesReceivedCounter = -1; // Metric of the text messages received
+int roomSendsCounter = -1; // Metric of the messages sent to a room
+ProactorMessage* pingMessages[2]; // Heartbeat in each format, indexed by FORMAT_*
+ProactorMessage* pongMessages[2]; // Answer to a client's ping in each format
+
+// Structure describing a connected client, passed to the frame handler.
+// A handleClient thread keeps it on its stack; in multi-reactor mode it is the registration context.
+typedef struct {
+    int socket;       // Client socket
+    int clientNumber; // Number shown to the other clients
+    int format;       // FORMAT_* the client receives; line until it sends a frame
+    int slot;         // The client's entry in clientSlots
+    ChatFrameParser parser; // Splits the byte stream into messages, across reads
+} ClientSession;
 
 // Function to handle communication with a client
 void *handleClient(void *pClientSocket);
 
-// Function to send a message to all clients except the sender
-void sendToAllClients(int senderSocket, char *message, int senderClientNumber)
+// Function to put a client in the table; called with clientMutex held.
+// Returns the client's slot, or -1 when the table is full.
+int addClient(int clientSocket)
 {
-    pthread_mutex_lock(&clientMutex); // Lock the mutex to protect shared resources
-    char formattedMessage[BUFFER_SIZE]; // Buffer to hold the formatted message
-    // Format message differently if it's a sign-out message
-    if (strncmp(message, "SIGNOUT", 7) == 0) {
-        snprintf(formattedMessage, BUFFER_SIZE, "Client %d left the chat", senderClientNumber);
+    int slot = firstFreeSlot; // Reuse a released slot first
+    if (slot >= 0) {
+        firstFreeSlot = clientSlots[slot].nextFree;
+    } else if (slotsHandedOut < MAX_CLIENTS) {
+        slot = slotsHandedOut++; // Otherwise take a fresh one
     } else {
-        snprintf(formattedMessage, BUFFER_SIZE, "Client %d says: %s", senderClientNumber, message);
+        return -1; // Table full
     }
-    for (int i = 0; i < numClients; i++) // Iterate through all clients
-    {
-        int clientSocket = clientSockets[i]; // Get client socket
-        if (clientSocket != senderSocket) // Check if it's not the sender
-        {
-            send(clientSocket, formattedMessage, strlen(formattedMessage), 0); // Send message to client
+    clientSlots[slot].socket = clientSocket;
+    numClients++;
+    proactorCounterAdd(clientsGauge, 1);
+    return slot;
+}
+
+// Function to take a client out of the table in constant time; called with clientMutex held
+void removeClient(int slot)
+{
+    clientSlots[slot].socket = -1;
+    clientSlots[slot].nextFree = firstFreeSlot; // Push the slot on the free list
+    firstFreeSlot = slot;
+    numClients--;
+    proactorCounterAdd(clientsGauge, -1);
+}
+
+// Function to send a message to the members of a room except the sender.
+// The text is copied once into a shared message; line clients get it as a line and framed clients
+// get a frame header in front of the same bytes. References are queued for every member without
+// taking clientMutex, so a slow reader never holds up the other clients or new joins.
+void sendToRoom(const char *room, size_t roomLength, int senderSocket, int type, const char *text, size_t textLength, int senderClientNumber)
+{
+    char header[128]; // Buffer to hold the "[room] Client N ..." header
+    struct iovec parts[3]; // Header, text and line end, sent together without being joined
+    int partCount = 1;
+    bool inLobby = roomLength == strlen(LOBBY_ROOM) && strncmp(room, LOBBY_ROOM, roomLength) == 0; // The lobby is not tagged
+    // Format message differently for joins and sign-outs
+    if (type == CHAT_FRAME_SIGNOUT) {
+        parts[0].iov_len = snprintf(header, sizeof(header), "Client %d left the chat", senderClientNumber);
+    } else if (type == CHAT_FRAME_JOIN) {
+        parts[0].iov_len = snprintf(header, sizeof(header), "Client %d joined the chat", senderClientNumber);
+    } else {
+        if (inLobby) {
+            parts[0].iov_len = snprintf(header, sizeof(header), "Client %d says: ", senderClientNumber);
+        } else {
+            parts[0].iov_len = snprintf(header, sizeof(header), "[%.*s] Client %d says: ", (int)roomLength, room, senderClientNumber);
         }
+        parts[1].iov_base = (void *)text; // The text is not copied into a formatting buffer
+        parts[1].iov_len = textLength;
+        partCount = 2;
     }
+    parts[0].iov_base = header;
+
+    ProactorMessage* payload = createProactorMessage(parts, partCount); // One copy for every framed recipient
+    parts[partCount].iov_base = "\n"; // Line clients need the end of the line
+    parts[partCount].iov_len = 1;
+    unsigned char frameHeader[CHAT_FRAME_HEADER_SIZE];
+    ProactorMessage* variants[2]; // Indexed by FORMAT_*
+    variants[FORMAT_LINE] = createProactorMessage(parts, partCount + 1);
+    variants[FORMAT_FRAMED] = payload == NULL ? NULL :
+        createFramedProactorMessage(frameHeader, chatFrameEncodeHeader(frameHeader, type, proactorMessageLength(payload)), payload);
+    if (variants[FORMAT_LINE] == NULL || variants[FORMAT_FRAMED] == NULL) {
+        perror("Error creating message");
+    } else {
+        roomTableSend(rooms, room, roomLength, senderSocket, variants, 2); // Queue it for the other members
+        proactorCounterAdd(roomSendsCounter, 1);
+    }
+    releaseProactorMessage(payload); // Freed once the last recipient's queue has written them
+    releaseProactorMessage(variants[FORMAT_LINE]);
+    releaseProactorMessage(variants[FORMAT_FRAMED]);
+}
+
+// Function to act on one message a client sent
+void handleClientMessage(void *context, int type, const char *text, size_t textLength)
+{
+    ClientSession *session = (ClientSession *)context;
+    const char *space; // End of the room name in a publish
+    switch (type) {
+    case CHAT_FRAME_PING:
+        proactorSendMessage(session->socket, pongMessages[session->format]); // The client checks that the server is alive
+        break;
+    case CHAT_FRAME_TEXT:
+        proactorLog(PROACTOR_LOG_INFO, "Received message from client %d: %.*s\n", session->clientNumber, (int)textLength, text); // Print received message
+        proactorCounterAdd(messagesReceivedCounter, 1);
+        sendToRoom(LOBBY_ROOM, strlen(LOBBY_ROOM), session->socket, type, text, textLength, session->clientNumber);
+        break;
+    case CHAT_FRAME_JOIN:
+    case CHAT_FRAME_SIGNOUT:
+        sendToRoom(LOBBY_ROOM, strlen(LOBBY_ROOM), session->socket, type, text, textLength, session->clientNumber);
+        break;
+    case CHAT_FRAME_SUBSCRIBE:
+        if (roomTableSubscribe(rooms, text, textLength, session->socket, session->format) == 0) {
+            proactorLog(PROACTOR_LOG_INFO, "Client %d subscribed to %.*s\n", session->clientNumber, (int)textLength, text);
+        }
+        break;
+    case CHAT_FRAME_UNSUBSCRIBE:
+        if (roomTableUnsubscribe(rooms, text, textLength, session->socket) == 0) {
+            proactorLog(PROACTOR_LOG_INFO, "Client %d unsubscribed from %.*s\n", session->clientNumber, (int)textLength, text);
+        }
+        break;
+    case CHAT_FRAME_PUBLISH:
+        space = memchr(text, ' ', textLength); // "room text"
+        if (space != NULL) {
+            size_t roomLength = (size_t)(space - text);
+            sendToRoom(text, roomLength, session->socket, CHAT_FRAME_TEXT, space + 1, textLength - roomLength - 1, session->clientNumber);
+        }
+        break;
+    }
+}
+
+// Function to feed what a client sent to its parser, switching the client to frames once it sends one.
+// Returns -1 when the stream is broken.
+int feedClient(ClientSession *session, const char *data, size_t length)
+{
+    int previousMode = session->parser.mode;
+    int parsed = chatFrameParserFeed(&session->parser, data, length, handleClientMessage, session);
+    if (previousMode == CHAT_MODE_UNKNOWN && session->parser.mode == CHAT_MODE_FRAMED)
+    {
+        session->format = FORMAT_FRAMED; // The client speaks frames, so send it frames in every room
+        roomTableSetFormat(rooms, session->socket, FORMAT_FRAMED);
+        setSocketIdleTimeout(session->socket, IDLE_TIMEOUT_MS, HEARTBEAT_INTERVAL_MS, pingMessages[FORMAT_FRAMED]);
+    }
+    return parsed;
+}
+
+// Function to forget a client that left: its slot, its rooms and its unfinished message
+void forgetClient(ClientSession *session)
+{
+    proactorLog(PROACTOR_LOG_INFO, "Client %d left the chat\n", session->clientNumber); // Print message indicating client left
+
+    pthread_mutex_lock(&clientMutex); // Lock the mutex
+    removeClient(session->slot); // Free the client's slot, no search or shifting needed
     pthread_mutex_unlock(&clientMutex); // Unlock the mutex
+
+    roomTableUnsubscribeAll(rooms, session->socket); // Stop receiving broadcasts in every room
+    chatFrameParserDestroy(&session->parser); // Drop any unfinished message
 }
 
 // Function to handle communication with a client
 void *handleClient(void *pClientSocket)
 {
     int clientSocket = *(int *)pClientSocket; // Dereference the pointer to get client socket
-    free(pClientSocket); // Free the allocated memory
+    memoryPoolFree(pClientSocket); // Free the allocated memory
 
     pthread_mutex_lock(&clientMutex); // Lock the mutex to protect shared resources
-    int clientNumber = ++clientCounter; // Increment client counter and assign client number
-    clientSockets[numClients++] = clientSocket; // Add new client socket to array
+    int clientSlot = addClient(clientSocket); // Add new client socket to the table
+    int clientNumber = clientSlot >= 0 ? ++clientCounter : 0; // Increment client counter and assign client number
     pthread_mutex_unlock(&clientMutex); // Unlock the mutex
+    if (clientSlot < 0)
+    {
+        proactorLog(PROACTOR_LOG_WARN, "Max clients reached, refusing client\n"); // Print message if the table is full
+        close(clientSocket); // Close the client socket
+        pthread_exit(NULL); // Terminate the thread
+    }
+    proactorLog(PROACTOR_LOG_INFO, "Accepted client %d\n", clientNumber); // The number the locked increment handed out
+
+    // Let the proactor's event loop write this client's output; the thread keeps doing the reads
+    if (registerSocketWithContext(clientSocket, NULL, NULL, PROACTOR_WRITE_ONLY) < 0)
+    {
+        pthread_mutex_lock(&clientMutex); // Lock the mutex
+        removeClient(clientSlot); // Give the slot back
+        pthread_mutex_unlock(&clientMutex); // Unlock the mutex
+        close(clientSocket); // Without an output queue the client cannot take part
+        pthread_exit(NULL); // Terminate the thread
+    }
+    roomTableSubscribe(rooms, LOBBY_ROOM, strlen(LOBBY_ROOM), clientSocket, FORMAT_LINE); // Start receiving the lobby as plain lines
+    // Ping the client when it goes quiet and shut it down when it stays quiet, which ends this thread's recv
+    setSocketIdleTimeout(clientSocket, IDLE_TIMEOUT_MS, HEARTBEAT_INTERVAL_MS, pingMessages[FORMAT_LINE]);
 
-    char message[BUFFER_SIZE]; // Buffer to store client messages
+    char message[BUFFER_SIZE]; // Buffer to store what the client sent, possibly several messages
+    ClientSession session = { .socket = clientSocket, .clientNumber = clientNumber, .format = FORMAT_LINE, .slot = clientSlot }; // Who the messages come from
+    chatFrameParserInit(&session.parser, MAX_MESSAGE_SIZE);
 
     while (1) // Infinite loop to handle client communication
     {
-        bzero(message, BUFFER_SIZE); // Clear the message buffer
-        ssize_t bytesReceived = recv(clientSocket, message, BUFFER_SIZE, 0); // Receive message from client
-        if (bytesReceived < 1) // Check for disconnection or error
+        ssize_t bytesReceived = recv(clientSocket, message, BUFFER_SIZE, 0); // Receive as much as the client sent
+        if (bytesReceived > 0) markSocketActive(clientSocket); // The proactor never reads this socket, so report the input
+        if (bytesReceived <= 0 || feedClient(&session, message, bytesReceived) < 0) // Check for disconnection, error or a broken stream
         {
-            printf("Client %d left the chat\n", clientNumber); // Print message indicating client left
-
-            pthread_mutex_lock(&clientMutex); // Lock the mutex
-            for (int i = 0; i < numClients; i++) // Find and remove client from array
-            {
-                if (clientSockets[i] == clientSocket) // Check if current socket matches client
-                {
-                    for (int j = i; j < numClients - 1; j++) // Shift remaining clients down
-                    {
-                        clientSockets[j] = clientSockets[j + 1];
-                    }
-                    numClients--; // Decrement number of clients
-                    break;
-                }
-            }
-            pthread_mutex_unlock(&clientMutex); // Unlock the mutex
-
+            forgetClient(&session);
+            unregisterSocket(clientSocket); // Drop the output queue before the descriptor can be reused
             close(clientSocket); // Close the client socket
             pthread_exit(NULL); // Terminate the thread
         }
-        message[bytesReceived - 1] = '\0'; // Null-terminate the received message
-        printf("Received message from client %d: %s\n", clientNumber, message); // Print received message
-        fflush(stdout); // Flush stdout buffer
-
-        // Forward the message to all other clients
-        sendToAllClients(clientSocket, message, clientNumber);
     }
     return NULL; // Return NULL (not reached due to infinite loop)
 }
 
-int main()
+// Function to read the slow-consumer policy from the command line
+int parseOverflowPolicy(int argc, char *argv[])
+{
+    if (argc < 2 || strcmp(argv[1], "disconnect") == 0) return PROACTOR_OVERFLOW_DISCONNECT; // Default policy
+    if (strcmp(argv[1], "drop-oldest") == 0) return PROACTOR_OVERFLOW_DROP_OLDEST;
+    if (strcmp(argv[1], "pause") == 0) return PROACTOR_OVERFLOW_PAUSE;
+    fprintf(stderr, "Usage: %s [disconnect|drop-oldest|pause] [reactors] [adminSocket]\n", argv[0]); // Print usage on a bad argument
+    exit(EXIT_FAILURE); // Exit with failure status
+}
+
+// Callback run by the proactor with what a client sent in multi-reactor mode
+void clientCallback(ProactorEventInfo *info)
 {
+    ClientSession *session = (ClientSession *)info->context;
+    if (info->data_len > 0 && feedClient(session, info->data, info->data_len) < 0)
+    {
+        proactorLog(PROACTOR_LOG_WARN, "Client %d broke the protocol\n", session->clientNumber); // Print protocol error
+        shutdown(info->socket, SHUT_RDWR); // The hang-up that follows forgets the client
+    }
+    if (info->events & (PROACTOR_EVENT_HANGUP | PROACTOR_EVENT_ERROR))
+    {
+        forgetClient(session); // The proactor closes the socket
+        memoryPoolFree(session);
+    }
+}
+
+// Function run by a reactor for every client it accepts: the client is registered from the reactor's own loop,
+// so it stays on that loop, which reads it and writes its output; no thread is started for it
+void acceptClient(int clientSocket, void *context)
+{
+    (void)context; // Unused
+    ClientSession *session = memoryPoolAlloc(sizeof(ClientSession)); // Freed by the hang-up callback
+    if (session == NULL)
+    {
+        perror("Error allocating client"); // Print error message
+        close(clientSocket); // Close the client socket
+        return;
+    }
+    pthread_mutex_lock(&clientMutex); // Lock the mutex to protect shared resources
+    int clientSlot = addClient(clientSocket); // Add new client socket to the table
+    int clientNumber = clientSlot >= 0 ? ++clientCounter : 0; // Increment client counter and assign client number
+    pthread_mutex_unlock(&clientMutex); // Unlock the mutex
+    if (clientSlot < 0)
+    {
+        proactorLog(PROACTOR_LOG_WARN, "Max clients reached, refusing client\n"); // Print message if the table is full
+        memoryPoolFree(session);
+        close(clientSocket); // Close the client socket
+        return;
+    }
+    proactorLog(PROACTOR_LOG_INFO, "Accepted client %d\n", clientNumber); // The number the locked increment handed out
+
+    session->socket = clientSocket;
+    session->clientNumber = clientNumber;
+    session->format = FORMAT_LINE;
+    session->slot = clientSlot;
+    chatFrameParserInit(&session->parser, MAX_MESSAGE_SIZE);
+    roomTableSubscribe(rooms, LOBBY_ROOM, strlen(LOBBY_ROOM), clientSocket, FORMAT_LINE); // Before registering, so the hang-up callback finds it
+    if (registerSocketWithContext(clientSocket, clientCallback, session, PROACTOR_COMPLETION | PROACTOR_CLOSE_ON_HANGUP) < 0)
+    {
+        forgetClient(session); // Without a registration the client cannot take part
+        memoryPoolFree(session);
+        close(clientSocket); // Close the client socket
+        return;
+    }
+    // Ping the client when it goes quiet and shut it down when it stays quiet, which ends its registration
+    setSocketIdleTimeout(clientSocket, IDLE_TIMEOUT_MS, HEARTBEAT_INTERVAL_MS, pingMessages[FORMAT_LINE]);
+}
+
+// Function to start the thread serving an accepted client
+void startClientThread(int clientSocket, void *context)
+{
+    (void)context; // Unused
+    pthread_t thread; // Declare thread variable
+    int *pClientSocket = memoryPoolAlloc(sizeof(int)); // Allocate memory for client socket pointer
+    *pClientSocket = clientSocket; // Set the value of pointer to client socket
+    pthread_create(&thread, NULL, handleClient, pClientSocket); // Create a new thread for the client
+}
+
+// Function to create a heartbeat message in both formats
+void createHeartbeat(ProactorMessage* variants[2], int type, const char *line)
+{
+    struct iovec part = { .iov_base = (void *)line, .iov_len = strlen(line) };
+    unsigned char frameHeader[CHAT_FRAME_HEADER_SIZE];
+    variants[FORMAT_LINE] = createProactorMessage(&part, 1);
+    part.iov_base = frameHeader; // An empty frame of the given type
+    part.iov_len = chatFrameEncodeHeader(frameHeader, type, 0);
+    variants[FORMAT_FRAMED] = createProactorMessage(&part, 1);
+    if (variants[FORMAT_LINE] == NULL || variants[FORMAT_FRAMED] == NULL)
+    {
+        perror("Error creating message"); // Print error message
+        exit(EXIT_FAILURE); // Exit with failure status
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int overflowPolicy = parseOverflowPolicy(argc, argv); // What to do with a client that falls behind
+
+    // Log through per-thread buffers written out in batches, so a client never waits for stdout
+    int logLevel = proactorLogLevelFromName(getenv("LOG_LEVEL")); // debug, info, warn or error
+    if (logLevel >= 0) proactorLogSetLevel(logLevel);
+    if (proactorLogStart(STDOUT_FILENO, LOG_RING_BYTES) < 0) fprintf(stderr, "Logging directly to stdout\n");
+    int reactors = argc > 2 ? atoi(argv[2]) : 0; // With N > 0, N event loops each accept on their own SO_REUSEPORT listener
+    ProactorConfig config = { .eventLoops = reactors }; // 0 keeps the default single loop
+    initializeProactorWithConfig(&config); // Start the event loops draining the client output queues
+    setDefaultOutputLimits(OUTPUT_HIGH_WATERMARK, OUTPUT_LOW_WATERMARK, overflowPolicy); // Bound every client's backlog
+    rooms = createRoomTable(); // Create the room index
+    if (rooms == NULL)
+    {
+        perror("Error creating room table"); // Print error message
+        exit(EXIT_FAILURE); // Exit with failure status
+    }
+    createHeartbeat(pingMessages, CHAT_FRAME_PING, "/ping\n"); // Shared by every client's idle timeout
+    createHeartbeat(pongMessages, CHAT_FRAME_PONG, "/pong\n");
+
+    // Serve the metrics on a local socket; the chat keeps working without it
+    clientsGauge = proactorRegisterCounter("chat_clients", "Connected chat clients", 1);
+    messagesReceivedCounter = proactorRegisterCounter("chat_messages_received_total", "Text messages received from clients", 0);
+    roomSendsCounter = proactorRegisterCounter("chat_room_sends_total", "Messages sent to the members of a room", 0);
+    const char *adminPath = argc > 3 ? argv[3] : ADMIN_SOCKET_PATH;
+    if (proactorStartAdmin(adminPath) == 0) proactorLog(PROACTOR_LOG_INFO, "Metrics available on %s\n", adminPath);
+
+    if (reactors > 0) // Multi-reactor mode: the event loops accept and serve their clients in parallel, room messages reach each loop through its inbox
+    {
+        if (proactorListen(8080, acceptClient, NULL) < 0)
+        {
+            fprintf(stderr, "Could not listen on port 8080\n"); // The reason was printed by the library
+            exit(EXIT_FAILURE); // Exit with failure status
+        }
+        proactorLog(PROACTOR_LOG_INFO, "Server is up and listening with %d reactors...\n", proactorLoopCount()); // Print server start message
+        while (1) pause(); // The reactors accept every client
+    }
+
     int serverSocket = socket(AF_INET, SOCK_STREAM, 0); // Create a socket for the server
     if (serverSocket < 0) // Check for socket creation error
     {
@@ -112,22 +405,16 @@ int main()
         exit(EXIT_FAILURE); // Exit with failure status
     }
 
-    if (listen(serverSocket, 5) < 0) // Listen for incoming connections (backlog of 5)
+    if (listen(serverSocket, SOMAXCONN) < 0) // Listen for incoming connections; a reconnect storm must not overflow the backlog
     {
         perror("Error listening for connections"); // Print error message
         close(serverSocket); // Close the server socket
         exit(EXIT_FAILURE); // Exit with failure status
     }
-    printf("Server is up and listening...\n"); // Print server start message
+    proactorLog(PROACTOR_LOG_INFO, "Server is up and listening...\n"); // Print server start message
     while (1) // Infinite loop to accept incoming connections
     {
         int clientSocket = accept(serverSocket, NULL, NULL); // Accept a client connection
-
-        printf("Accepted client %d\n", clientCounter + 1); // Print message indicating new client
-        fflush(stdout); // Flush stdout buffer
-        pthread_t thread; // Declare thread variable
-        int *pClientSocket = malloc(sizeof(int)); // Allocate memory for client socket pointer
-        *pClientSocket = clientSocket; // Set the value of pointer to client socket
-        pthread_create(&thread, NULL, handleClient, pClientSocket); // Create a new thread for the client
+        startClientThread(clientSocket, NULL); // Serve it on its own thread
     }
 }
@@ -0,0 +1,283 @@
+#include "broadcastGroup.h" // Include the broadcast group header
+#include "memoryPool.h"     // Include the pool the per-broadcast fan-outs come from
+#include <pthread.h>        // Include for POSIX mutexes
+#include <stdlib.h>         // Include for malloc and free
+#include <string.h>         // Include for memcpy
+
+// Defined in proactor.c: queues a message reference on a registration, 1 when the socket is not registered
+int proactorSendMessageRegistered(int socket, ProactorMessage* message);
+
+// Structure representing one member of the group
+typedef struct GroupMember {
+    int socket; // Member socket
+    int format; // Index of the message variant the member receives
+    int loop;   // Event loop the socket was registered with when it joined, -1 if none
+} GroupMember;
+
+// Structure representing one immutable copy of the member list
+typedef struct MemberSnapshot {
+    int references;        // The group's own reference plus one per broadcast using the snapshot
+    int count;             // Number of members
+    GroupMember members[]; // Members, ordered by loop so the members of one loop are a contiguous range
+} MemberSnapshot;
+
+// Structure representing the share of a broadcast handed to the event loop owning its members
+typedef struct LoopFanOut {
+    MemberSnapshot* snapshot;    // Snapshot the members come from; the fan-out holds a reference
+    int begin;                   // First member of the range
+    int end;                     // One past the last member of the range
+    int exceptSocket;            // Member that is skipped
+    int formatCount;             // Number of variants, 0 when messages[0] goes to every member
+    ProactorMessage* messages[]; // Variants; the fan-out holds a reference to each
+} LoopFanOut;
+
+// Structure representing the group
+struct BroadcastGroup {
+    pthread_mutex_t updateMutex;  // Serializes joins and leaves, which copy the member list
+    pthread_mutex_t publishMutex; // Protects the current pointer while it is read or swapped
+    MemberSnapshot* current;      // Snapshot new broadcasts use
+};
+
+// Helper function to allocate a snapshot with room for count members
+static MemberSnapshot* createSnapshot(int count) {
+    MemberSnapshot* snapshot = (MemberSnapshot*)malloc(sizeof(MemberSnapshot) + (size_t)count * sizeof(GroupMember));
+    if (snapshot == NULL) return NULL;
+    snapshot->references = 1; // Owned by the group once published
+    snapshot->count = count;
+    return snapshot;
+}
+
+// Helper function to drop a reference, freeing the snapshot with the last one
+static void releaseSnapshot(MemberSnapshot* snapshot) {
+    if (__atomic_sub_fetch(&snapshot->references, 1, __ATOMIC_ACQ_REL) == 0) free(snapshot);
+}
+
+// Helper function to take a reference to the current snapshot
+static MemberSnapshot* acquireSnapshot(BroadcastGroup* group) {
+    pthread_mutex_lock(&group->publishMutex);
+    MemberSnapshot* snapshot = group->current;
+    __atomic_add_fetch(&snapshot->references, 1, __ATOMIC_RELAXED); // Keeps it alive after a swap
+    pthread_mutex_unlock(&group->publishMutex);
+    return snapshot;
+}
+
+// Helper function to make a new snapshot current; called with updateMutex held
+static void publishSnapshot(BroadcastGroup* group, MemberSnapshot* snapshot) {
+    pthread_mutex_lock(&group->publishMutex);
+    MemberSnapshot* previous = group->current;
+    group->current = snapshot;
+    pthread_mutex_unlock(&group->publishMutex);
+    releaseSnapshot(previous); // Freed now, or by the last broadcast still using it
+}
+
+// Helper function to find a socket in a snapshot
+static int findMember(const MemberSnapshot* snapshot, int socket) {
+    for (int i = 0; i < snapshot->count; i++) {
+        if (snapshot->members[i].socket == socket) return i;
+    }
+    return -1;
+}
+
+// Helper function to find the first member registered with loop or a later one
+static int loopStart(const MemberSnapshot* snapshot, int loop) {
+    int low = 0, high = snapshot->count;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (snapshot->members[middle].loop < loop) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+// Helper function to queue the matching variant for a range of members; returns how many got one
+static int sendRange(const MemberSnapshot* snapshot, int begin, int end, int exceptSocket,
+                     ProactorMessage* const* messages, int formatCount) {
+    int delivered = 0;
+    for (int i = begin; i < end; i++) {
+        const GroupMember* member = &snapshot->members[i];
+        if (member->socket == exceptSocket) continue; // Skip the sender
+        ProactorMessage* message = messages[0];
+        if (formatCount > 0) {
+            if (member->format < 0 || member->format >= formatCount) continue;
+            message = messages[member->format];
+        }
+        if (message == NULL) continue; // No variant for this format
+        // A member that left after the snapshot was taken is skipped instead of written synchronously
+        if (proactorSendMessageRegistered(member->socket, message) == 0) delivered++;
+    }
+    return delivered;
+}
+
+// Function run on an event loop to send a broadcast to the members registered with it
+static void runLoopFanOut(void* argument) {
+    LoopFanOut* fanOut = (LoopFanOut*)argument;
+    sendRange(fanOut->snapshot, fanOut->begin, fanOut->end, fanOut->exceptSocket, fanOut->messages, fanOut->formatCount);
+    for (int i = 0; i < (fanOut->formatCount > 0 ? fanOut->formatCount : 1); i++) releaseProactorMessage(fanOut->messages[i]);
+    releaseSnapshot(fanOut->snapshot);
+    memoryPoolFree(fanOut);
+}
+
+// Helper function to post a range of members to the inbox of their event loop; returns 0 or -1
+static int postLoopFanOut(MemberSnapshot* snapshot, int loop, int begin, int end, int exceptSocket,
+                          ProactorMessage* const* messages, int formatCount) {
+    int variants = formatCount > 0 ? formatCount : 1;
+    LoopFanOut* fanOut = (LoopFanOut*)memoryPoolAlloc(sizeof(LoopFanOut) + (size_t)variants * sizeof(ProactorMessage*));
+    if (fanOut == NULL) return -1;
+    fanOut->snapshot = snapshot;
+    fanOut->begin = begin;
+    fanOut->end = end;
+    fanOut->exceptSocket = exceptSocket;
+    fanOut->formatCount = formatCount;
+    __atomic_add_fetch(&snapshot->references, 1, __ATOMIC_RELAXED); // Taken before the loop can run the task
+    for (int i = 0; i < variants; i++) {
+        fanOut->messages[i] = messages[i] != NULL ? retainProactorMessage(messages[i]) : NULL;
+    }
+    if (proactorPost(loop, runLoopFanOut, fanOut) != 0) {
+        for (int i = 0; i < variants; i++) releaseProactorMessage(fanOut->messages[i]);
+        releaseSnapshot(snapshot); // Never the last reference: the caller still holds one
+        memoryPoolFree(fanOut);
+        return -1;
+    }
+    return 0;
+}
+
+// Helper function shared by the sends: writes the members of the calling thread's loop (or all of them
+// with a single loop) in place and hands every other loop's members to that loop's inbox
+static int fanOutSnapshot(BroadcastGroup* group, int exceptSocket, ProactorMessage* const* messages, int formatCount) {
+    MemberSnapshot* snapshot = acquireSnapshot(group); // No lock is held while writing
+    int loops = proactorLoopCount();
+    if (loops <= 1) {
+        int delivered = sendRange(snapshot, 0, snapshot->count, exceptSocket, messages, formatCount);
+        releaseSnapshot(snapshot);
+        return delivered;
+    }
+
+    int ownLoop = proactorCurrentLoop();
+    int exceptLoop = exceptSocket >= 0 ? proactorSocketLoop(exceptSocket) : -1;
+    int begin = loopStart(snapshot, 0);
+    int delivered = sendRange(snapshot, 0, begin, exceptSocket, messages, formatCount); // Joined before registering
+    for (int loop = 0; loop < loops; loop++) {
+        int end = loopStart(snapshot, loop + 1);
+        if (begin == end) continue;
+        if (loop == ownLoop || postLoopFanOut(snapshot, loop, begin, end, exceptSocket, messages, formatCount) != 0) {
+            delivered += sendRange(snapshot, begin, end, exceptSocket, messages, formatCount);
+        } else {
+            delivered += end - begin - (loop == exceptLoop); // Handed over; the loop skips members that left meanwhile
+        }
+        begin = end;
+    }
+    releaseSnapshot(snapshot);
+    return delivered;
+}
+
+// Function to create a group
+BroadcastGroup* createBroadcastGroup() {
+    BroadcastGroup* group = (BroadcastGroup*)malloc(sizeof(BroadcastGroup));
+    if (group == NULL) return NULL;
+    group->current = createSnapshot(0);
+    if (group->current == NULL) {
+        free(group);
+        return NULL;
+    }
+    pthread_mutex_init(&group->updateMutex, NULL);
+    pthread_mutex_init(&group->publishMutex, NULL);
+    return group;
+}
+
+// Function to free a group
+void destroyBroadcastGroup(BroadcastGroup* group) {
+    if (group == NULL) return;
+    releaseSnapshot(group->current);
+    pthread_mutex_destroy(&group->updateMutex);
+    pthread_mutex_destroy(&group->publishMutex);
+    free(group);
+}
+
+// Function to add a member
+int broadcastGroupAdd(BroadcastGroup* group, int socket) {
+    return broadcastGroupAddWithFormat(group, socket, 0);
+}
+
+// Function to add a member receiving a given message variant
+int broadcastGroupAddWithFormat(BroadcastGroup* group, int socket, int format) {
+    pthread_mutex_lock(&group->updateMutex);
+    MemberSnapshot* members = group->current; // Stable: only holders of updateMutex replace it
+    MemberSnapshot* updated = findMember(members, socket) < 0 ? createSnapshot(members->count + 1) : NULL;
+    if (updated == NULL) {
+        pthread_mutex_unlock(&group->updateMutex);
+        return -1;
+    }
+    GroupMember member = { .socket = socket, .format = format, .loop = proactorSocketLoop(socket) };
+    if (member.loop < 0) member.loop = proactorCurrentLoop(); // Added by an accept callback just before it registers the socket
+    int index = loopStart(members, member.loop + 1); // Last of the members on the same loop
+    memcpy(updated->members, members->members, (size_t)index * sizeof(GroupMember));
+    updated->members[index] = member;
+    memcpy(updated->members + index + 1, members->members + index, (size_t)(members->count - index) * sizeof(GroupMember));
+    publishSnapshot(group, updated);
+    pthread_mutex_unlock(&group->updateMutex);
+    return 0;
+}
+
+// Function to remove a member
+int broadcastGroupRemove(BroadcastGroup* group, int socket) {
+    pthread_mutex_lock(&group->updateMutex);
+    MemberSnapshot* members = group->current;
+    int index = findMember(members, socket);
+    MemberSnapshot* updated = index >= 0 ? createSnapshot(members->count - 1) : NULL;
+    if (updated == NULL) {
+        pthread_mutex_unlock(&group->updateMutex);
+        return -1;
+    }
+    memcpy(updated->members, members->members, (size_t)index * sizeof(GroupMember));
+    memcpy(updated->members + index, members->members + index + 1, (size_t)(members->count - index - 1) * sizeof(GroupMember));
+    publishSnapshot(group, updated);
+    pthread_mutex_unlock(&group->updateMutex);
+    return 0;
+}
+
+// Function to change the message variant a member receives
+int broadcastGroupSetFormat(BroadcastGroup* group, int socket, int format) {
+    pthread_mutex_lock(&group->updateMutex);
+    MemberSnapshot* members = group->current;
+    int index = findMember(members, socket);
+    MemberSnapshot* updated = index >= 0 ? createSnapshot(members->count) : NULL;
+    if (updated == NULL) {
+        pthread_mutex_unlock(&group->updateMutex);
+        return -1;
+    }
+    memcpy(updated->members, members->members, (size_t)members->count * sizeof(GroupMember));
+    updated->members[index].format = format;
+    publishSnapshot(group, updated);
+    pthread_mutex_unlock(&group->updateMutex);
+    return 0;
+}
+
+// Function to count the members
+int broadcastGroupSize(BroadcastGroup* group) {
+    MemberSnapshot* snapshot = acquireSnapshot(group);
+    int count = snapshot->count;
+    releaseSnapshot(snapshot);
+    return count;
+}
+
+// Function to send a message to every member but one
+int broadcastGroupSend(BroadcastGroup* group, int exceptSocket, const void* data, size_t length) {
+    if (length == 0) return 0;
+    struct iovec part = { .iov_base = (void*)data, .iov_len = length };
+    ProactorMessage* message = createProactorMessage(&part, 1); // One copy for every member
+    if (message == NULL) return 0;
+    int delivered = broadcastGroupSendMessage(group, exceptSocket, message);
+    releaseProactorMessage(message); // Freed once the last member's queue has written it
+    return delivered;
+}
+
+// Function to send a shared message to every member but one
+int broadcastGroupSendMessage(BroadcastGroup* group, int exceptSocket, ProactorMessage* message) {
+    return fanOutSnapshot(group, exceptSocket, &message, 0); // The same message for every format
+}
+
+// Function to send every member but one the message variant matching its format
+int broadcastGroupSendFormats(BroadcastGroup* group, int exceptSocket, ProactorMessage* const* messages, int formatCount) {
+    if (formatCount <= 0) return 0;
+    return fanOutSnapshot(group, exceptSocket, messages, formatCount);
+}
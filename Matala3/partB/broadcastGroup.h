@@ -0,0 +1,55 @@
+#ifndef BROADCAST_GROUP_H
+#define BROADCAST_GROUP_H
+
+#include <stddef.h>     // For size_t
+#include "proactor.h"   // For PROACTOR_API
+
+// A set of sockets messages are fanned out to.
+// Senders work on a reference-counted snapshot of the members, so a broadcast never holds a lock
+// while it writes and joins or leaves never wait for a broadcast. Members must be registered with
+// the proactor (PROACTOR_WRITE_ONLY is enough): their output is queued and never written in place.
+// With several event loops a broadcast is split by the loop each member is registered with: every
+// loop gets its share through its inbox and writes it on its own thread, so the loops fan out in
+// parallel and a sender never touches another loop's sockets. A paused overflow policy then lets
+// the queues pass their high watermark instead of making a loop wait, and the returned counts
+// include members handed to another loop that may leave before it writes to them.
+typedef struct BroadcastGroup BroadcastGroup;
+
+// Creates an empty group, or returns NULL when out of memory
+PROACTOR_API BroadcastGroup* createBroadcastGroup();
+
+// Frees the group; no other thread may use it any more
+PROACTOR_API void destroyBroadcastGroup(BroadcastGroup* group);
+
+// Adds a socket to the group. Returns 0 on success and -1 if out of memory or already a member.
+PROACTOR_API int broadcastGroupAdd(BroadcastGroup* group, int socket);
+
+// Adds a socket that receives variant number format of broadcastGroupSendFormats (broadcastGroupAdd uses 0).
+// Returns 0 on success and -1 if out of memory or already a member.
+PROACTOR_API int broadcastGroupAddWithFormat(BroadcastGroup* group, int socket, int format);
+
+// Changes the variant a member receives. Returns 0 on success and -1 if the socket is not a member.
+PROACTOR_API int broadcastGroupSetFormat(BroadcastGroup* group, int socket, int format);
+
+// Removes a socket from the group. Broadcasts already in progress may still write to it.
+// Returns 0 on success and -1 if the socket is not a member.
+PROACTOR_API int broadcastGroupRemove(BroadcastGroup* group, int socket);
+
+// Returns the number of members
+PROACTOR_API int broadcastGroupSize(BroadcastGroup* group);
+
+// Queues one already formatted message for every registered member except exceptSocket (-1 for
+// nobody). Never blocks. Returns the number of members the message was handed to.
+// The bytes are copied once and shared by every member's queue.
+PROACTOR_API int broadcastGroupSend(BroadcastGroup* group, int exceptSocket, const void* data, size_t length);
+
+// Queues a reference to a shared message for every registered member except exceptSocket. The caller
+// keeps its own reference. Returns the number of members the message was handed to.
+PROACTOR_API int broadcastGroupSendMessage(BroadcastGroup* group, int exceptSocket, ProactorMessage* message);
+
+// Like broadcastGroupSendMessage, but each member gets messages[its format], so one fan-out serves
+// members that want the same content encoded differently. Members whose format has no variant
+// (out of range or NULL) are skipped. Returns the number of members a message was handed to.
+PROACTOR_API int broadcastGroupSendFormats(BroadcastGroup* group, int exceptSocket, ProactorMessage* const* messages, int formatCount);
+
+#endif // BROADCAST_GROUP_H
@@ -0,0 +1,154 @@
+#include "chatFrame.h" // Include the chat framing header
+#include <stdint.h>    // Include for uint32_t
+#include <stdlib.h>    // Include for realloc and free
+#include <string.h>    // Include for memchr, memcpy and strncmp
+
+// Helper function to check whether a byte is a frame type
+static int isFrameType(unsigned char type) {
+    return type >= CHAT_FRAME_TEXT && type <= CHAT_FRAME_PONG;
+}
+
+// Structure mapping a line-mode command to the frame type it stands for
+static const struct {
+    const char* prefix; // Start of the line, including the space before the payload
+    int type;           // CHAT_FRAME_* the rest of the line is the payload of
+} lineCommands[] = {
+    { "/subscribe ", CHAT_FRAME_SUBSCRIBE },
+    { "/unsubscribe ", CHAT_FRAME_UNSUBSCRIBE },
+    { "/publish ", CHAT_FRAME_PUBLISH },
+};
+
+// Helper function to read the payload length out of a frame header
+static size_t framePayloadLength(const char* header) {
+    const unsigned char* bytes = (const unsigned char*)header;
+    return ((uint32_t)bytes[1] << 24) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 8) | bytes[4];
+}
+
+// Helper function to measure the message at the start of some bytes.
+// Returns its total length when it is complete, 0 when more bytes are needed and -1 on a protocol error.
+static long messageSize(const ChatFrameParser* parser, const char* bytes, size_t available) {
+    if (parser->mode == CHAT_MODE_FRAMED) {
+        if (available == 0) return 0;
+        if (!isFrameType((unsigned char)bytes[0])) return -1; // Not a frame: the stream is out of step
+        if (available < CHAT_FRAME_HEADER_SIZE) return 0;
+        size_t payloadLength = framePayloadLength(bytes);
+        if (payloadLength > parser->maxPayload) return -1; // Oversized frame
+        return available < CHAT_FRAME_HEADER_SIZE + payloadLength ? 0 : (long)(CHAT_FRAME_HEADER_SIZE + payloadLength);
+    }
+    size_t searched = available < parser->maxPayload + 1 ? available : parser->maxPayload + 1; // Line plus its '\n'
+    const char* newline = (const char*)memchr(bytes, '\n', searched);
+    if (newline != NULL) return (long)(newline - bytes) + 1;
+    return available > parser->maxPayload ? -1 : 0; // A line longer than any payload is refused
+}
+
+// Helper function to hand one complete message to the handler
+static void deliverMessage(const ChatFrameParser* parser, const char* bytes, size_t size,
+                           ChatFrameHandler handler, void* context) {
+    if (parser->mode == CHAT_MODE_FRAMED) {
+        handler(context, (unsigned char)bytes[0], bytes + CHAT_FRAME_HEADER_SIZE, size - CHAT_FRAME_HEADER_SIZE);
+        return;
+    }
+    size_t length = size - 1; // Drop the '\n'
+    if (length > 0 && bytes[length - 1] == '\r') length--; // And a '\r' before it
+    int type = length >= 7 && strncmp(bytes, "SIGNOUT", 7) == 0 ? CHAT_FRAME_SIGNOUT : CHAT_FRAME_TEXT;
+    if (length == 5 && strncmp(bytes, "/ping", 5) == 0) type = CHAT_FRAME_PING; // Heartbeats are whole lines
+    if (length == 5 && strncmp(bytes, "/pong", 5) == 0) type = CHAT_FRAME_PONG;
+    for (size_t i = 0; i < sizeof(lineCommands) / sizeof(lineCommands[0]); i++) {
+        size_t prefixLength = strlen(lineCommands[i].prefix);
+        if (length >= prefixLength && strncmp(bytes, lineCommands[i].prefix, prefixLength) == 0) {
+            handler(context, lineCommands[i].type, bytes + prefixLength, length - prefixLength);
+            return;
+        }
+    }
+    handler(context, type, bytes, length);
+}
+
+// Helper function to append bytes to the unfinished message
+static int appendPending(ChatFrameParser* parser, const char* bytes, size_t length) {
+    if (parser->pendingLength + length > parser->pendingCapacity) {
+        size_t capacity = parser->pendingCapacity == 0 ? 256 : parser->pendingCapacity;
+        while (capacity < parser->pendingLength + length) capacity *= 2;
+        char* grown = (char*)realloc(parser->pending, capacity);
+        if (grown == NULL) return -1;
+        parser->pending = grown;
+        parser->pendingCapacity = capacity;
+    }
+    memcpy(parser->pending + parser->pendingLength, bytes, length);
+    parser->pendingLength += length;
+    return 0;
+}
+
+// Helper function to work out how many fed bytes belong to the unfinished message
+static size_t bytesToComplete(const ChatFrameParser* parser, const char* bytes, size_t length) {
+    size_t needed;
+    if (parser->mode == CHAT_MODE_FRAMED) {
+        if (parser->pendingLength < CHAT_FRAME_HEADER_SIZE) {
+            needed = CHAT_FRAME_HEADER_SIZE - parser->pendingLength; // Finish the header first
+        } else {
+            needed = CHAT_FRAME_HEADER_SIZE + framePayloadLength(parser->pending) - parser->pendingLength;
+        }
+    } else {
+        const char* newline = (const char*)memchr(bytes, '\n', length);
+        needed = newline != NULL ? (size_t)(newline - bytes) + 1 : length;
+    }
+    return needed < length ? needed : length;
+}
+
+// Function to prepare a parser
+void chatFrameParserInit(ChatFrameParser* parser, size_t maxPayload) {
+    memset(parser, 0, sizeof(*parser));
+    parser->mode = CHAT_MODE_UNKNOWN;
+    parser->maxPayload = maxPayload;
+}
+
+// Function to free what a parser buffered
+void chatFrameParserDestroy(ChatFrameParser* parser) {
+    free(parser->pending);
+    parser->pending = NULL;
+    parser->pendingLength = 0;
+    parser->pendingCapacity = 0;
+}
+
+// Function to feed received bytes to a parser
+int chatFrameParserFeed(ChatFrameParser* parser, const void* data, size_t length,
+                        ChatFrameHandler handler, void* context) {
+    const char* bytes = (const char*)data;
+    if (length == 0) return 0;
+    if (parser->mode == CHAT_MODE_UNKNOWN) {
+        parser->mode = isFrameType((unsigned char)bytes[0]) ? CHAT_MODE_FRAMED : CHAT_MODE_LINES; // Decided once
+    }
+
+    // Finish a message an earlier read left incomplete
+    while (parser->pendingLength > 0 && length > 0) {
+        size_t taken = bytesToComplete(parser, bytes, length);
+        if (appendPending(parser, bytes, taken) != 0) return -1;
+        bytes += taken;
+        length -= taken;
+        long size = messageSize(parser, parser->pending, parser->pendingLength);
+        if (size < 0) return -1;
+        if (size == 0) continue; // Still incomplete (a frame header only just finished)
+        parser->pendingLength = 0;
+        deliverMessage(parser, parser->pending, (size_t)size, handler, context);
+    }
+
+    // Hand out every complete message straight from the fed bytes
+    while (length > 0) {
+        long size = messageSize(parser, bytes, length);
+        if (size < 0) return -1;
+        if (size == 0) return appendPending(parser, bytes, length); // Keep the start for the next read
+        deliverMessage(parser, bytes, (size_t)size, handler, context);
+        bytes += size;
+        length -= (size_t)size;
+    }
+    return 0;
+}
+
+// Function to write a frame header
+size_t chatFrameEncodeHeader(unsigned char* header, int type, size_t payloadLength) {
+    header[0] = (unsigned char)type;
+    header[1] = (unsigned char)(payloadLength >> 24);
+    header[2] = (unsigned char)(payloadLength >> 16);
+    header[3] = (unsigned char)(payloadLength >> 8);
+    header[4] = (unsigned char)payloadLength;
+    return CHAT_FRAME_HEADER_SIZE;
+}
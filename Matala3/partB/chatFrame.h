@@ -0,0 +1,57 @@
+#ifndef CHAT_FRAME_H
+#define CHAT_FRAME_H
+
+#include <stddef.h>     // For size_t
+#include "proactor.h"   // For PROACTOR_API
+
+// Chat wire format. A framed connection sends frames made of a 5-byte header, the type code
+// followed by the payload length as a big-endian 32-bit number, then the payload itself.
+// A connection whose first byte is not a frame type is read in line mode instead: every line
+// ending in '\n' is one text message ("SIGNOUT" lines sign out), which keeps plain clients working.
+// Lines starting with "/subscribe ", "/unsubscribe " or "/publish " carry the matching frame's payload,
+// and the lines "/ping" and "/pong" stand for the heartbeat frames.
+#define CHAT_FRAME_HEADER_SIZE 5
+
+// Frame types
+#define CHAT_FRAME_TEXT        0x1 // Chat message
+#define CHAT_FRAME_JOIN        0x2 // Client announces itself (payload: optional name)
+#define CHAT_FRAME_SIGNOUT     0x3 // Client leaves the chat
+#define CHAT_FRAME_SUBSCRIBE   0x4 // Start receiving a room's messages (payload: room name)
+#define CHAT_FRAME_UNSUBSCRIBE 0x5 // Stop receiving a room's messages (payload: room name)
+#define CHAT_FRAME_PUBLISH     0x6 // Message to one room (payload: room name, a space, the text)
+#define CHAT_FRAME_PING        0x7 // Heartbeat asking the other side to answer with a pong
+#define CHAT_FRAME_PONG        0x8 // Answer to a ping
+
+// Modes a parser settles on after the first byte of a connection
+#define CHAT_MODE_UNKNOWN 0 // Nothing received yet
+#define CHAT_MODE_FRAMED  1 // Length-prefixed frames
+#define CHAT_MODE_LINES   2 // Newline-terminated text
+
+// Called for every complete message; payload is only valid until the handler returns
+typedef void (*ChatFrameHandler)(void* context, int type, const char* payload, size_t length);
+
+// Incremental parser: bytes may be fed in pieces of any size, several messages at a time.
+// Complete messages are handed out straight from the fed bytes; only an unfinished one is copied.
+typedef struct {
+    int mode;          // CHAT_MODE_*
+    size_t maxPayload; // Largest payload or line accepted
+    char* pending;     // Start of a message split across reads
+    size_t pendingLength;   // Bytes in pending
+    size_t pendingCapacity; // Allocated size of pending
+} ChatFrameParser;
+
+// Prepares a parser accepting payloads and lines up to maxPayload bytes
+PROACTOR_API void chatFrameParserInit(ChatFrameParser* parser, size_t maxPayload);
+
+// Frees what the parser buffered
+PROACTOR_API void chatFrameParserDestroy(ChatFrameParser* parser);
+
+// Feeds received bytes and calls handler for every message they complete.
+// Returns 0, or -1 when the stream breaks the protocol (unknown type or oversized message).
+PROACTOR_API int chatFrameParserFeed(ChatFrameParser* parser, const void* data, size_t length,
+                                     ChatFrameHandler handler, void* context);
+
+// Writes the header of a frame with the given type and payload length; returns CHAT_FRAME_HEADER_SIZE
+PROACTOR_API size_t chatFrameEncodeHeader(unsigned char* header, int type, size_t payloadLength);
+
+#endif // CHAT_FRAME_H
@@ -0,0 +1,172 @@
+#include "memoryPool.h"      // Include the pool header
+#include "proactorMetrics.h" // Include the counters of heap allocations
+#include <pthread.h>         // Include for the depot mutexes and the cache key
+#include <stdint.h>          // Include for uint32_t
+#include <stdlib.h>          // Include for malloc and free
+
+#define SIZE_CLASSES 11              // 64 bytes to 64 KiB in powers of two
+#define MIN_BLOCK_SHIFT 6            // log2 of MEMORY_POOL_MIN_BLOCK
+#define LARGE_CLASS UINT32_MAX       // Class of a block that came straight from malloc
+#define CACHE_BYTES (32 * 1024)      // Bytes of one class a thread cache holds before it gives a batch back
+#define MIN_CACHE_BLOCKS 4           // Blocks a thread cache holds of even the largest class
+
+// Structure in front of every block handed out
+typedef union BlockHeader {
+    uint32_t sizeClass;                 // Index into depots, or LARGE_CLASS
+    char padding[MEMORY_POOL_HEADER];   // Keeps what follows 16-byte aligned
+} BlockHeader;
+
+// Structure overlaying a free block
+typedef struct FreeBlock {
+    struct FreeBlock* next; // Next free block of the same class
+} FreeBlock;
+
+// Structure representing the free blocks of one class shared by every thread
+typedef struct Depot {
+    pthread_mutex_t mutex;  // Serializes the batches moved in and out
+    FreeBlock* blocks;      // Free blocks
+} Depot;
+
+// Structure representing the free blocks a thread keeps for itself
+typedef struct ThreadCache {
+    FreeBlock* blocks[SIZE_CLASSES]; // Free blocks by class
+    int counts[SIZE_CLASSES];        // Number of blocks in each list
+    int registered;                  // Non-zero once the key gives the blocks back when the thread exits
+} ThreadCache;
+
+static Depot depots[SIZE_CLASSES];          // Shared free blocks by class
+static pthread_key_t cacheKey;              // Empties a thread's cache when the thread exits
+static pthread_once_t poolOnce = PTHREAD_ONCE_INIT;
+static __thread ThreadCache threadCache;    // Cache of the calling thread
+
+// Helper function to return the size of the blocks of a class
+static size_t blockSize(int sizeClass) {
+    return (size_t)1 << (sizeClass + MIN_BLOCK_SHIFT);
+}
+
+// Helper function to return how many blocks of a class a thread cache holds at most
+static int cacheLimit(int sizeClass) {
+    int limit = (int)(CACHE_BYTES / blockSize(sizeClass));
+    return limit > MIN_CACHE_BLOCKS ? limit : MIN_CACHE_BLOCKS;
+}
+
+// Helper function to return the smallest class whose blocks hold size bytes after the header, -1 if none does
+static int sizeClassOf(size_t size) {
+    if (size > MEMORY_POOL_MAX_BLOCK - MEMORY_POOL_HEADER) return -1;
+    size_t needed = size + MEMORY_POOL_HEADER;
+    int sizeClass = 0;
+    while (blockSize(sizeClass) < needed) sizeClass++; // At most SIZE_CLASSES steps
+    return sizeClass;
+}
+
+// Helper function to move up to count blocks from one list to the front of another; returns how many moved
+static int moveBlocks(FreeBlock** from, FreeBlock** to, int count) {
+    int moved = 0;
+    while (moved < count && *from != NULL) {
+        FreeBlock* block = *from;
+        *from = block->next;
+        block->next = *to;
+        *to = block;
+        moved++;
+    }
+    return moved;
+}
+
+// Helper function to give every block of a cache back to the depots
+static void drainCache(ThreadCache* cache) {
+    for (int sizeClass = 0; sizeClass < SIZE_CLASSES; sizeClass++) {
+        if (cache->blocks[sizeClass] == NULL) continue;
+        pthread_mutex_lock(&depots[sizeClass].mutex);
+        moveBlocks(&cache->blocks[sizeClass], &depots[sizeClass].blocks, cache->counts[sizeClass]);
+        pthread_mutex_unlock(&depots[sizeClass].mutex);
+        cache->counts[sizeClass] = 0;
+    }
+}
+
+// Helper function run when a thread exits: its free blocks go to the threads still running
+static void releaseCache(void* cache) {
+    drainCache((ThreadCache*)cache);
+    ((ThreadCache*)cache)->registered = 0; // A free during a later destructor registers it again
+}
+
+// Helper function to set up the depots and the cache key
+static void initializePool() {
+    for (int sizeClass = 0; sizeClass < SIZE_CLASSES; sizeClass++) {
+        pthread_mutex_init(&depots[sizeClass].mutex, NULL);
+    }
+    pthread_key_create(&cacheKey, releaseCache);
+}
+
+// Helper function to make sure the calling thread's cache is emptied when the thread exits
+static void registerCache(ThreadCache* cache) {
+    pthread_once(&poolOnce, initializePool);
+    pthread_setspecific(cacheKey, cache);
+    cache->registered = 1;
+}
+
+// Helper function to fill an empty cache with half its limit: from the depot, or from a new slab
+static int refillCache(ThreadCache* cache, int sizeClass) {
+    if (!cache->registered) registerCache(cache);
+    int batch = cacheLimit(sizeClass) / 2;
+    pthread_mutex_lock(&depots[sizeClass].mutex);
+    cache->counts[sizeClass] += moveBlocks(&depots[sizeClass].blocks, &cache->blocks[sizeClass], batch);
+    pthread_mutex_unlock(&depots[sizeClass].mutex);
+    if (cache->blocks[sizeClass] != NULL) return 0;
+
+    size_t size = blockSize(sizeClass);
+    char* slab = (char*)malloc(size * (size_t)batch); // Never freed: its blocks circulate for the life of the process
+    if (slab == NULL) return -1;
+    metricsAdd(METRIC_POOL_SLABS, 1);
+    for (int i = batch - 1; i >= 0; i--) { // Hand the blocks out in address order
+        FreeBlock* block = (FreeBlock*)(slab + (size_t)i * size);
+        block->next = cache->blocks[sizeClass];
+        cache->blocks[sizeClass] = block;
+    }
+    cache->counts[sizeClass] += batch;
+    return 0;
+}
+
+// Function to allocate a block
+void* memoryPoolAlloc(size_t size) {
+    int sizeClass = sizeClassOf(size);
+    if (sizeClass < 0) {
+        BlockHeader* header = (BlockHeader*)malloc(MEMORY_POOL_HEADER + size); // Too large to pool
+        if (header == NULL) return NULL;
+        metricsAdd(METRIC_POOL_LARGE_ALLOCATIONS, 1);
+        header->sizeClass = LARGE_CLASS;
+        return (char*)header + MEMORY_POOL_HEADER;
+    }
+
+    ThreadCache* cache = &threadCache;
+    if (cache->blocks[sizeClass] == NULL && refillCache(cache, sizeClass) != 0) return NULL;
+    FreeBlock* block = cache->blocks[sizeClass];
+    cache->blocks[sizeClass] = block->next;
+    cache->counts[sizeClass]--;
+    BlockHeader* header = (BlockHeader*)block;
+    header->sizeClass = (uint32_t)sizeClass;
+    return (char*)header + MEMORY_POOL_HEADER;
+}
+
+// Function to free a block
+void memoryPoolFree(void* block) {
+    if (block == NULL) return;
+    BlockHeader* header = (BlockHeader*)((char*)block - MEMORY_POOL_HEADER);
+    if (header->sizeClass == LARGE_CLASS) {
+        free(header);
+        return;
+    }
+
+    int sizeClass = (int)header->sizeClass;
+    ThreadCache* cache = &threadCache;
+    FreeBlock* freed = (FreeBlock*)header;
+    freed->next = cache->blocks[sizeClass];
+    cache->blocks[sizeClass] = freed;
+    if (++cache->counts[sizeClass] <= cacheLimit(sizeClass)) return;
+
+    // Over the limit: a thread that frees what others allocate hands half its cache back
+    if (!cache->registered) registerCache(cache);
+    int batch = cacheLimit(sizeClass) / 2;
+    pthread_mutex_lock(&depots[sizeClass].mutex);
+    cache->counts[sizeClass] -= moveBlocks(&cache->blocks[sizeClass], &depots[sizeClass].blocks, batch);
+    pthread_mutex_unlock(&depots[sizeClass].mutex);
+}
@@ -0,0 +1,27 @@
+#ifndef MEMORY_POOL_H
+#define MEMORY_POOL_H
+
+#include <stddef.h>     // For size_t
+#include "proactor.h"   // For PROACTOR_API
+
+// Slab allocator for the objects and buffers allocated on every message and connection: messages,
+// queued sends, posted tasks, timers, per-connection state. Blocks come in power-of-two size classes
+// from MEMORY_POOL_MIN_BLOCK to MEMORY_POOL_MAX_BLOCK bytes, carved out of slabs that are never given
+// back to the heap. Every thread keeps a cache of free blocks per class, so allocating and freeing
+// take no lock; a cache that runs empty or overflows moves a batch of blocks from or to a shared
+// depot under that class's mutex. Once the caches and depots hold the working set, the steady state
+// makes no heap allocations at all. Larger requests fall through to malloc.
+// proactor_pool_slabs_total and proactor_pool_large_allocations_total count the heap allocations.
+
+#define MEMORY_POOL_MIN_BLOCK 64          // Smallest block, header included
+#define MEMORY_POOL_MAX_BLOCK (64 * 1024) // Largest pooled block, header included
+#define MEMORY_POOL_HEADER 16             // Bytes in front of every block; keeps the blocks 16-byte aligned
+
+// Returns a block of at least size bytes, 16-byte aligned, or NULL when out of memory
+PROACTOR_API void* memoryPoolAlloc(size_t size);
+
+// Returns a block from memoryPoolAlloc to the calling thread's cache (NULL is ignored).
+// Any thread may free a block, not only the one that allocated it.
+PROACTOR_API void memoryPoolFree(void* block);
+
+#endif // MEMORY_POOL_H
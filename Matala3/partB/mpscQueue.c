@@ -0,0 +1,62 @@
+#include "mpscQueue.h" // Include the queue header
+#include <stdint.h>    // Include for uint64_t
+#include <stdio.h>     // Include for perror
+#include <unistd.h>    // Include for write
+
+// Helper function to append a node: claim the tail, then link the previous node to it.
+// Between the two steps the node is queued but not yet reachable from the head.
+static void linkNode(MpscQueue* queue, MpscNode* node) {
+    __atomic_store_n(&node->next, NULL, __ATOMIC_RELAXED);
+    MpscNode* previous = __atomic_exchange_n(&queue->tail, node, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&previous->next, node, __ATOMIC_RELEASE); // Publishes the node to the consumer
+}
+
+// Function to prepare an empty queue
+void mpscQueueInit(MpscQueue* queue, int wakeDescriptor) {
+    queue->stub.next = NULL;
+    queue->tail = &queue->stub;
+    queue->head = &queue->stub;
+    queue->wakeDescriptor = wakeDescriptor;
+    queue->wakePending = 0;
+}
+
+// Function to append a node and wake the consumer if it may be asleep
+void mpscQueuePush(MpscQueue* queue, MpscNode* node) {
+    linkNode(queue, node);
+    if (queue->wakeDescriptor < 0) return;
+    // The link must be visible before the flag is read, or a consumer acknowledging meanwhile could miss the node
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&queue->wakePending, __ATOMIC_RELAXED)) return; // Cheap check first: the flag line stays shared
+    if (__atomic_exchange_n(&queue->wakePending, 1, __ATOMIC_ACQ_REL)) return; // Another producer wakes the consumer
+    uint64_t one = 1;
+    if (write(queue->wakeDescriptor, &one, sizeof(one)) < 0) perror("Error waking queue consumer");
+}
+
+// Function to remove the oldest node
+MpscNode* mpscQueuePop(MpscQueue* queue) {
+    MpscNode* head = queue->head;
+    MpscNode* next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+    if (head == &queue->stub) { // Skip the placeholder
+        if (next == NULL) return NULL; // Empty
+        queue->head = next;
+        head = next;
+        next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+    }
+    if (next != NULL) {
+        queue->head = next;
+        return head;
+    }
+    // head is the last reachable node; it can only be handed out once something follows it
+    if (head != __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE)) return NULL; // A producer has not linked its node yet
+    linkNode(queue, &queue->stub); // Put the placeholder back behind it
+    next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+    if (next == NULL) return NULL; // A producer got in before the placeholder and has not linked yet
+    queue->head = next;
+    return head;
+}
+
+// Function to let producers know the consumer is about to empty the queue
+void mpscQueueAcknowledge(MpscQueue* queue) {
+    __atomic_store_n(&queue->wakePending, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST); // Pops that follow must not be ordered before the flag is cleared
+}
@@ -0,0 +1,47 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include "proactor.h"   // For PROACTOR_API
+
+// Lock-free multi-producer/single-consumer queue used to hand work to a thread that owns it,
+// such as an event loop's inbox. It is intrusive: the caller embeds an MpscNode in its own
+// structure, so pushing never allocates. Any thread may push; only the owner pops.
+// Producers touch the tail and the consumer the head, which live on separate cache lines.
+// With a wake descriptor (an eventfd) the first push after the consumer went to sleep writes it,
+// so the consumer can wait in epoll_wait instead of polling.
+
+#define MPSC_CACHE_LINE_SIZE 64 // Padding keeping the producers' and the consumer's fields apart
+
+// Link embedded in every queued item
+typedef struct MpscNode {
+    struct MpscNode* next; // Next node in push order, set by the queue
+} MpscNode;
+
+// Queue state; the caller allocates it and calls mpscQueueInit
+typedef struct MpscQueue {
+    MpscNode* tail;           // Most recently pushed node, exchanged by producers
+    int wakeDescriptor;       // eventfd written to wake the consumer, -1 for none
+    int wakePending;          // Non-zero once a producer wrote the eventfd the consumer has not acknowledged
+    char producerPadding[MPSC_CACHE_LINE_SIZE]; // Keeps the consumer's fields off the producers' cache line
+    MpscNode* head;           // Oldest node, only touched by the consumer
+    MpscNode stub;            // Placeholder node that keeps the list non-empty
+    char consumerPadding[MPSC_CACHE_LINE_SIZE]; // Keeps whatever follows off the consumer's cache line
+} MpscQueue;
+
+// Prepares an empty queue; wakeDescriptor is an eventfd to write on the first push, or -1
+PROACTOR_API void mpscQueueInit(MpscQueue* queue, int wakeDescriptor);
+
+// Appends a node; safe from any number of threads at once and never blocks.
+// Writes the wake descriptor unless an earlier push already did and the consumer has not acknowledged it.
+PROACTOR_API void mpscQueuePush(MpscQueue* queue, MpscNode* node);
+
+// Removes the oldest node, or returns NULL when the queue is empty (consumer only).
+// A producer caught between its two steps makes the queue look empty; that producer then writes
+// the wake descriptor, so a consumer that acknowledged before popping never misses the node.
+PROACTOR_API MpscNode* mpscQueuePop(MpscQueue* queue);
+
+// Tells producers the consumer has woken up and is about to pop everything (consumer only).
+// Call it after reading the wake descriptor and before the first pop.
+PROACTOR_API void mpscQueueAcknowledge(MpscQueue* queue);
+
+#endif // MPSC_QUEUE_H
@@ -1,99 +1,1859 @@
 #include "proactor.h"    // Include the proactor header for Proactor pattern
+#include "workerPool.h"  // Include the worker pool running the callbacks
+#include "uringRing.h"   // Include the io_uring ring used by the completion backend
+#include "mpscQueue.h"   // Include the lock-free queue feeding each loop's inbox
+#include "proactorMetrics.h" // Include the per-thread counters and histograms
+#include "timerWheel.h"  // Include the timer wheel every event loop keeps
+#include "memoryPool.h"  // Include the slab pool the per-message and per-connection objects come from
 #include <pthread.h>     // Include for POSIX threads
 #include <stdio.h>       // Include for standard input/output functions
 #include <stdlib.h>      // Include for standard library functions like malloc
+#include <string.h>      // Include for memcpy
 #include <unistd.h>      // Include for POSIX API like close function
+#include <errno.h>       // Include for errno values such as EINTR
+#include <stdint.h>      // Include for fixed width integer types
+#include <limits.h>      // Include for INT_MAX bounding the epoll timeout
+#include <time.h>        // Include for clock_gettime timing the timers
+#include <poll.h>        // Include for poll used while a blocking send waits for buffer space
+#include <sys/epoll.h>   // Include for the epoll event notification API
+#include <sys/eventfd.h> // Include for eventfd used to wake the event loops
+#include <sys/socket.h>  // Include for recv used to detect end of stream and sendmsg
+#include <sys/uio.h>     // Include for struct iovec describing scatter-gather writes
+#include <sys/resource.h> // Include for getrlimit used to size the socket registry
+#include <fcntl.h>       // Include for fcntl used to make edge-triggered sockets non-blocking
+#include <netinet/in.h>  // Include for sockaddr_in used by the per-loop listeners
 
-// Structure representing a node in the linked list for socket descriptors
-typedef struct SocketNode {
-    int socketDescriptor;           // Socket descriptor
-    ProactorCallback callbackFunction; // Callback function for the socket
-    struct SocketNode* nextNode;    // Pointer to the next node in the list
-} SocketNode;
-
-static SocketNode* headNode = NULL; // Head node of the linked list
-static pthread_mutex_t socketListMutex = PTHREAD_MUTEX_INITIALIZER; // Mutex for thread-safe operations on the list
-
-// Helper function to find and remove a socket node from the list
-static SocketNode* extractSocketNode(int socket) {
-    SocketNode *currentNode = headNode, *previousNode = NULL;
-    // Iterate through the list to find the node
-    while (currentNode != NULL && currentNode->socketDescriptor != socket) {
-        previousNode = currentNode;
-        currentNode = currentNode->nextNode;
-    }
-    // If node not found, return NULL
-    if (currentNode == NULL) return NULL;
-    // Remove the node from the list
-    if (previousNode == NULL) headNode = currentNode->nextNode;
-    else previousNode->nextNode = currentNode->nextNode;
-    return currentNode; // Return the removed node
-}
-
-// Thread function to process socket data
-void* processSocketThread(void* arg) {
-    int socket = *(int*)arg; // Extract the socket descriptor from the argument
-    ProactorCallback assignedCallback = NULL;
-
-    // Lock the mutex to safely modify the linked list
-    pthread_mutex_lock(&socketListMutex);
-    // Extract the node for the given socket
-    SocketNode* node = extractSocketNode(socket);
-    if (node != NULL) {
-        // Get the callback function assigned to the socket
-        assignedCallback = node->callbackFunction;
-        free(node); // Free the memory of the node
-    }
-    // Unlock the mutex
-    pthread_mutex_unlock(&socketListMutex);
-
-    // If a callback is assigned, call it
-    if (assignedCallback != NULL) {
-        assignedCallback(socket);
-    }
-    close(socket); // Close the socket
-    return NULL; // End the thread
-}
-
-// Function to initialize the proactor
+// Default number of epoll loops sharing the registered sockets (override with -DPROACTOR_EVENT_LOOPS=n)
+#ifndef PROACTOR_EVENT_LOOPS
+#define PROACTOR_EVENT_LOOPS 1
+#endif
+
+#define PROACTOR_MAX_EVENTS 256 // Maximum number of events harvested by one epoll_wait call
+
+// Events every registration is armed with; EPOLLONESHOT guarantees a socket is never dispatched twice at once
+#define PROACTOR_ARM_EVENTS (EPOLLIN | EPOLLRDHUP | EPOLLONESHOT)
+
+// Flags a registration made through registerSocket() gets, matching the original thread-per-socket behaviour
+#define LEGACY_REGISTRATION_FLAGS (PROACTOR_PERSISTENT | PROACTOR_CLOSE_ON_HANGUP)
+
+#define REGISTRY_CHUNK_SLOTS 1024         // Slots allocated together the first time a descriptor range is used
+#define REGISTRY_LOCK_STRIPES 64          // Number of locks striping the registry (neighbouring descriptors never share one)
+#define REGISTRY_MAX_DESCRIPTORS (1 << 24) // Upper bound on the registry size when RLIMIT_NOFILE is unlimited
+#define WAKE_EVENT_KEY UINT64_MAX         // epoll key marking the wake descriptor of a loop
+#define RING_EVENT_KEY (UINT64_MAX - 1)   // epoll key marking the completion eventfd of a loop's ring
+#define LISTEN_EVENT_KEY (UINT64_MAX - 2) // epoll key marking the listener of a loop
+#define ACCEPT_BATCH 64                   // Connections a loop accepts per readiness event before serving its other sockets
+
+#define RECEIVE_BUFFER_SIZE 65536      // Size of one buffer completed reads are delivered in
+#define RECEIVE_BUFFER_COUNT 64        // Receive buffers provided to the kernel per event loop
+#define RECEIVE_BUFFER_GROUP 1         // io_uring buffer group holding the receive buffers
+#define RING_SUBMISSION_ENTRIES 4096   // Submission queue size of each ring
+#define RING_COMPLETION_ENTRIES 16384  // Completion queue size of each ring (one receive is posted per socket)
+#define RING_DRAIN_TIMEOUT_MS 1000     // Longest cleanup waits for the sends still in flight on a ring
+
+#define DEFAULT_HIGH_WATERMARK (256 * 1024) // Unsent bytes a registration may queue before its overflow policy applies
+#define DEFAULT_LOW_WATERMARK (64 * 1024)   // Level a paused sender waits for before queueing again
+#define OUTPUT_QUEUE_INITIAL_CAPACITY 8     // Sends the output ring holds before it first grows
+#define DRAIN_VECTORS 64                    // Byte ranges the event loop gathers into one sendmsg
+
+// io_uring user_data layout: an operation tag in the top byte and a payload below it.
+// Receives carry the descriptor and the low 24 bits of the slot generation, sends carry their request pointer.
+#define RING_TAG_SHIFT 56
+#define RING_PAYLOAD_MASK ((1ULL << RING_TAG_SHIFT) - 1)
+#define RING_GENERATION_MASK 0xFFFFFFu
+enum { RING_OP_RECEIVE = 1, RING_OP_SEND, RING_OP_PROVIDE, RING_OP_CANCEL };
+
+// Structure representing an immutable, reference-counted message shared by every queue it is sent to
+struct ProactorMessage {
+    int references;                  // One per holder: creator, queued sends, framed messages built on it
+    int partCount;                   // Number of byte ranges
+    size_t length;                   // Total length of the ranges
+    struct iovec parts[PROACTOR_MESSAGE_MAX_PARTS]; // Byte ranges written in order with one sendmsg
+    ProactorMessage* payload;        // Message whose ranges follow the header, NULL if none
+    char data[];                     // Storage of the copied ranges
+};
+
+// Structure representing one queued send of a message to a socket
+typedef struct SendRequest {
+    int socket;                      // Destination socket
+    uint32_t generation;             // Registration the request belongs to
+    ProactorMessage* message;        // Bytes to send; the request holds a reference
+    size_t offset;                   // Bytes already sent
+    struct msghdr ringMessage;       // Unsent part of the message while it is submitted to the ring
+    struct iovec ringVectors[PROACTOR_MESSAGE_MAX_PARTS]; // Ranges ringMessage points to
+} SendRequest;
+
+// Structure representing one task posted to an event loop's inbox
+typedef struct LoopTask {
+    MpscNode node;          // Link in the inbox; first, so a popped node is the task
+    ProactorTask task;      // Function to run on the loop thread
+    void* argument;         // Argument passed to task
+} LoopTask;
+
+// Structure representing one epoll event loop and the thread running it
+typedef struct EventLoop {
+    int epollDescriptor;    // epoll instance owning the sockets assigned to this loop
+    int wakeDescriptor;     // eventfd used to interrupt epoll_wait (shutdown or pending ring submissions)
+    int stopping;           // Set by cleanupProactor before the loop is woken for the last time
+    pthread_t thread;       // Thread running the loop
+
+    // Multi-reactor mode
+    int listenDescriptor;   // SO_REUSEPORT listener accepted on by this loop, -1 if none
+    ProactorAcceptCallback acceptCallback; // Called with every accepted connection
+    void* acceptContext;    // Context handed to acceptCallback
+    MpscQueue inbox;        // Tasks posted by other threads; pushing writes the wake descriptor when the loop may be asleep
+
+    // Timers, run on the loop thread
+    TimerWheel timers;          // Scheduled ProactorTimers, in milliseconds of the monotonic clock
+    pthread_mutex_t timerMutex; // Serializes the wheel between the loop and the threads scheduling on it
+    uint64_t wakeTime;          // Millisecond the sleeping loop wakes at by itself, 0 while it is awake
+    uint64_t now;               // Millisecond the current iteration started at
+
+    // io_uring completion backend, only set up when it is the active backend
+    UringRing ring;             // Ring the completed reads and sends are submitted to
+    int ringEventDescriptor;    // eventfd the kernel signals on every completion
+    pthread_mutex_t ringMutex;  // Serializes access to the submission queue
+    int flushScheduled;         // Non-zero once the loop was woken to submit pending entries
+    int sendsInFlight;          // Sends submitted to the ring and not completed yet; their completion frees them
+    char* receiveBuffers;       // RECEIVE_BUFFER_COUNT buffers provided to the kernel
+    uint64_t* starvedReceives;  // Registration keys of receives that found no free buffer
+    int starvedCount;           // Number of entries in starvedReceives
+    int starvedCapacity;        // Allocated entries in starvedReceives
+} EventLoop;
+
+// Structure representing a timer; the node comes first, so an expired node is the timer
+struct ProactorTimer {
+    TimerNode node;                 // Link in the loop's wheel
+    EventLoop* loop;                // Loop whose wheel holds the timer and which runs the callback
+    ProactorTimerCallback callback; // Function run when the timer expires
+    void* argument;                 // Argument passed to callback
+    int firing;                     // Non-zero while the loop runs the callback
+    int destroyed;                  // Destroyed during its callback; the loop frees it afterwards
+};
+
+// Structure representing the bounded output queue of a registration: a ring of sends, oldest first.
+// With io_uring the oldest send is the one submitted to the ring; with epoll the event loop writes
+// the sends whenever the socket is writable.
+typedef struct OutputQueue {
+    SendRequest** requests;   // Ring buffer of queued sends, allocated with the first one
+    unsigned int capacity;    // Number of entries in requests
+    unsigned int head;        // Index of the oldest send
+    unsigned int count;       // Number of queued sends
+    size_t queuedBytes;       // Bytes the kernel has not taken yet
+    size_t highWatermark;     // Limit on queuedBytes before overflowPolicy applies, 0 for none
+    size_t lowWatermark;      // Level paused senders wait for
+    int overflowPolicy;       // PROACTOR_OVERFLOW_* applied at the high watermark
+    int headInFlight;         // Non-zero while the oldest send is submitted to the ring
+} OutputQueue;
+
+// Structure representing the registration slot of one socket descriptor.
+// The slot of descriptor fd lives at slotChunks[fd / REGISTRY_CHUNK_SLOTS][fd % REGISTRY_CHUNK_SLOTS]
+// and is protected by stripeLocks[fd % REGISTRY_LOCK_STRIPES].
+typedef struct SocketSlot {
+    uint32_t generation;            // Bumped whenever the slot is released, so stale events can be told apart
+    int inUse;                      // Non-zero while the descriptor is registered
+    int flags;                      // PROACTOR_* registration flags
+    ProactorCallback callbackFunction; // Descriptor-only callback registered through registerSocket
+    ProactorEventCallback eventCallback; // Event-info callback registered through registerSocketWithContext
+    void* context;                  // User context handed back in ProactorEventInfo
+    EventLoop* ownerLoop;           // Event loop the socket is registered with
+    uint32_t readyEvents;           // Events reported for the dispatch in progress
+    char* readyData;                // Read completed by the ring for the dispatch in progress
+    size_t readyLength;             // Length of readyData
+    int readyBuffer;                // Receive buffer holding readyData, -1 if none
+    int readInterest;               // Non-zero while epoll should report the socket readable (off during a dispatch)
+    int dispatching;                // Non-zero while a callback is queued or running
+    int inputPaused;                // Set by pauseSocketInput: the socket is not read until rearmSocket
+    OutputQueue output;             // Sends the kernel has not taken yet
+    ProactorTimer* idleTimer;       // Checks the connection for silence, NULL without an idle timeout
+    unsigned int idleTimeout;       // Milliseconds of silence after which the connection is shut down
+    unsigned int heartbeatInterval; // Milliseconds of silence after which the heartbeat is queued again
+    ProactorMessage* heartbeat;     // Message asking the peer for a sign of life, NULL for none
+    uint64_t lastInput;             // Millisecond input last arrived at; markSocketActive writes it without the lock
+    uint64_t lastHeartbeat;         // Millisecond the last heartbeat was queued at
+} SocketSlot;
+
+static SocketSlot** slotChunks = NULL; // Lazily allocated chunks of slots indexed by descriptor
+static int slotChunkCount = 0;         // Number of entries in slotChunks
+static pthread_mutex_t chunkAllocationMutex = PTHREAD_MUTEX_INITIALIZER; // Serializes chunk allocation
+static pthread_mutex_t stripeLocks[REGISTRY_LOCK_STRIPES]; // Locks protecting the slots
+static pthread_cond_t stripeDrained[REGISTRY_LOCK_STRIPES]; // Signalled when an output queue with paused senders drains
+static int stripePausedSenders[REGISTRY_LOCK_STRIPES]; // Senders waiting on stripeDrained, protected by the stripe lock
+static size_t defaultHighWatermark = DEFAULT_HIGH_WATERMARK; // Output limits new registrations start with
+static size_t defaultLowWatermark = DEFAULT_LOW_WATERMARK;
+static int defaultOverflowPolicy = PROACTOR_OVERFLOW_DISCONNECT;
+
+static EventLoop* eventLoops = NULL;   // The event loops owning all registered sockets
+static int eventLoopCount = 0;         // Number of entries in eventLoops
+static WorkerPool* callbackPool = NULL; // Workers executing the callbacks of ready sockets
+static unsigned int nextLoopIndex = 0; // Round-robin cursor used to spread sockets over the loops
+static int proactorRunning = 0;        // Non-zero between initializeProactor and cleanupProactor
+static int completionBackend = PROACTOR_BACKEND_EPOLL; // Backend completing reads and sends
+
+static __thread EventLoop* currentLoop = NULL; // Event loop run by the calling thread, if any
+static __thread char receiveBuffer[RECEIVE_BUFFER_SIZE]; // Per-thread buffer for completions emulated over epoll
+
+// Helper function to read the monotonic clock the timers run on, in milliseconds
+static uint64_t currentMilliseconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+// Helper function to build the key identifying one registration of a descriptor
+static uint64_t registrationKey(int socket, uint32_t generation) {
+    return ((uint64_t)generation << 32) | (uint32_t)socket;
+}
+
+// Helper function to build the io_uring user_data of a receive
+static uint64_t receiveUserData(int socket, uint32_t generation) {
+    return ((uint64_t)RING_OP_RECEIVE << RING_TAG_SHIFT) | ((uint64_t)(generation & RING_GENERATION_MASK) << 32) | (uint32_t)socket;
+}
+
+// Helper function to check whether a registration's reads are completed by the ring
+static int usesRing(int flags) {
+    return completionBackend == PROACTOR_BACKEND_IO_URING && (flags & PROACTOR_COMPLETION) && !(flags & PROACTOR_WRITE_ONLY);
+}
+
+// Helper function to check whether a slot has output its event loop must write (epoll backend only)
+static int hasQueuedOutput(const SocketSlot* slot) {
+    return completionBackend == PROACTOR_BACKEND_EPOLL && slot->output.count > 0;
+}
+
+// Helper function to compute the epoll events a registration is currently armed with
+static uint32_t watchedEvents(const SocketSlot* slot) {
+    uint32_t events = EPOLLONESHOT;
+    if (slot->readInterest) events |= PROACTOR_ARM_EVENTS;
+    if (hasQueuedOutput(slot)) events |= EPOLLOUT; // Wait for room in the send buffer
+    if (slot->flags & PROACTOR_EDGE_TRIGGERED) events |= EPOLLET;
+    return events;
+}
+
+// Helper function to return the lock protecting the slot of a descriptor
+static pthread_mutex_t* slotLock(int socket) {
+    return &stripeLocks[socket % REGISTRY_LOCK_STRIPES];
+}
+
+// Helper function to find the slot of a descriptor, allocating its chunk when asked to
+static SocketSlot* findSocketSlot(int socket, int allocate) {
+    if (socket < 0 || socket / REGISTRY_CHUNK_SLOTS >= slotChunkCount) return NULL; // Outside the registry
+    SocketSlot** chunkEntry = &slotChunks[socket / REGISTRY_CHUNK_SLOTS];
+    SocketSlot* chunk = __atomic_load_n(chunkEntry, __ATOMIC_ACQUIRE);
+    if (chunk == NULL && allocate) {
+        pthread_mutex_lock(&chunkAllocationMutex);
+        chunk = *chunkEntry; // Another thread may have allocated it meanwhile
+        if (chunk == NULL) {
+            chunk = (SocketSlot*)calloc(REGISTRY_CHUNK_SLOTS, sizeof(SocketSlot));
+            __atomic_store_n(chunkEntry, chunk, __ATOMIC_RELEASE); // Publish the zeroed chunk
+        }
+        pthread_mutex_unlock(&chunkAllocationMutex);
+    }
+    return chunk == NULL ? NULL : &chunk[socket % REGISTRY_CHUNK_SLOTS];
+}
+
+// Helper function to describe the part of a set of byte ranges that follows offset; returns the range count
+static int remainingVectors(const struct iovec* parts, int partCount, size_t offset, struct iovec* vectors) {
+    int count = 0;
+    for (int i = 0; i < partCount; i++) {
+        if (offset >= parts[i].iov_len) {
+            offset -= parts[i].iov_len; // Range already sent
+            continue;
+        }
+        vectors[count].iov_base = (char*)parts[i].iov_base + offset;
+        vectors[count].iov_len = parts[i].iov_len - offset;
+        offset = 0;
+        count++;
+    }
+    return count;
+}
+
+// Helper function to free a queued send and drop its reference to the message
+static void freeSendRequest(SendRequest* request) {
+    releaseProactorMessage(request->message);
+    memoryPoolFree(request);
+}
+
+// Helper function to reserve a submission entry and make sure the loop submits it.
+// Must be called with ringMutex held. Entries queued by other threads are batched until the loop
+// wakes up; only the first of them since the last submission writes the wake descriptor.
+static struct io_uring_sqe* reserveRingEntry(EventLoop* loop) {
+    struct io_uring_sqe* sqe = uringGetSqe(&loop->ring);
+    if (sqe == NULL) return NULL; // Submission queue full and the kernel refused to drain it
+    if (!loop->flushScheduled && currentLoop != loop) {
+        uint64_t one = 1;
+        loop->flushScheduled = 1;
+        if (write(loop->wakeDescriptor, &one, sizeof(one)) < 0) perror("Error waking event loop");
+    }
+    return sqe;
+}
+
+// Helper function to queue a buffer-selecting receive for a registration
+static void queueRingReceive(EventLoop* loop, int socket, uint32_t generation) {
+    pthread_mutex_lock(&loop->ringMutex);
+    struct io_uring_sqe* sqe = reserveRingEntry(loop);
+    if (sqe != NULL) {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = socket;
+        sqe->len = RECEIVE_BUFFER_SIZE;
+        sqe->flags = IOSQE_BUFFER_SELECT; // The kernel picks a free receive buffer once data arrives
+        sqe->buf_group = RECEIVE_BUFFER_GROUP;
+        sqe->user_data = receiveUserData(socket, generation);
+    } else {
+        fprintf(stderr, "Error queueing receive for socket %d: ring is full\n", socket);
+    }
+    pthread_mutex_unlock(&loop->ringMutex);
+}
+
+// Helper function to queue the cancellation of a registration's pending receive
+static void queueRingCancel(EventLoop* loop, int socket, uint32_t generation) {
+    pthread_mutex_lock(&loop->ringMutex);
+    struct io_uring_sqe* sqe = reserveRingEntry(loop);
+    if (sqe != NULL) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = receiveUserData(socket, generation); // Cancel by the receive's user_data
+        sqe->user_data = (uint64_t)RING_OP_CANCEL << RING_TAG_SHIFT;
+    }
+    pthread_mutex_unlock(&loop->ringMutex);
+}
+
+// Helper function to queue the cancellation of everything pending on a ring (Linux 5.19+, refused with -EINVAL before)
+static void queueRingCancelAll(EventLoop* loop) {
+    pthread_mutex_lock(&loop->ringMutex);
+    struct io_uring_sqe* sqe = reserveRingEntry(loop);
+    if (sqe != NULL) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY | IORING_ASYNC_CANCEL_ALL;
+        sqe->user_data = (uint64_t)RING_OP_CANCEL << RING_TAG_SHIFT;
+    }
+    pthread_mutex_unlock(&loop->ringMutex);
+}
+
+// Helper function to queue the unsent part of a send request
+static void queueRingSend(EventLoop* loop, SendRequest* request) {
+    pthread_mutex_lock(&loop->ringMutex);
+    struct io_uring_sqe* sqe = reserveRingEntry(loop);
+    if (sqe != NULL) {
+        ProactorMessage* message = request->message;
+        memset(&request->ringMessage, 0, sizeof(request->ringMessage));
+        request->ringMessage.msg_iov = request->ringVectors;
+        request->ringMessage.msg_iovlen = remainingVectors(message->parts, message->partCount, request->offset, request->ringVectors);
+        sqe->opcode = IORING_OP_SENDMSG; // Header and payload ranges go out together, never concatenated
+        sqe->fd = request->socket;
+        sqe->addr = (uint64_t)(uintptr_t)&request->ringMessage;
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = ((uint64_t)RING_OP_SEND << RING_TAG_SHIFT) | ((uint64_t)(uintptr_t)request & RING_PAYLOAD_MASK);
+        __atomic_add_fetch(&loop->sendsInFlight, 1, __ATOMIC_RELAXED);
+    } else {
+        fprintf(stderr, "Error queueing send for socket %d: ring is full\n", request->socket);
+    }
+    pthread_mutex_unlock(&loop->ringMutex);
+}
+
+// Helper function to give a receive buffer back to the kernel and retry receives that were starved of buffers
+static void returnReceiveBuffer(EventLoop* loop, int buffer) {
+    uint64_t starved[16]; // Receives resubmitted now that a buffer is free again
+    int starvedCount = 0;
+
+    pthread_mutex_lock(&loop->ringMutex);
+    struct io_uring_sqe* sqe = reserveRingEntry(loop);
+    if (sqe != NULL) {
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd = 1; // Number of buffers provided
+        sqe->addr = (uint64_t)(uintptr_t)(loop->receiveBuffers + (size_t)buffer * RECEIVE_BUFFER_SIZE);
+        sqe->len = RECEIVE_BUFFER_SIZE;
+        sqe->buf_group = RECEIVE_BUFFER_GROUP;
+        sqe->off = (uint64_t)buffer; // Buffer id
+        sqe->user_data = (uint64_t)RING_OP_PROVIDE << RING_TAG_SHIFT;
+    }
+    while (loop->starvedCount > 0 && starvedCount < 16) {
+        starved[starvedCount++] = loop->starvedReceives[--loop->starvedCount];
+    }
+    pthread_mutex_unlock(&loop->ringMutex);
+
+    // Resubmit outside ringMutex: the stripe lock is always taken before it
+    for (int i = 0; i < starvedCount; i++) {
+        int socket = (int)(uint32_t)starved[i];
+        SocketSlot* slot = findSocketSlot(socket, 0);
+        if (slot == NULL) continue;
+        pthread_mutex_lock(slotLock(socket));
+        if (slot->inUse && slot->generation == (uint32_t)(starved[i] >> 32)) {
+            queueRingReceive(loop, socket, slot->generation);
+        }
+        pthread_mutex_unlock(slotLock(socket));
+    }
+}
+
+// Helper function to submit everything queued on a loop's ring; returns the entries the kernel did not take
+static unsigned int flushRing(EventLoop* loop) {
+    pthread_mutex_lock(&loop->ringMutex);
+    loop->flushScheduled = 0;
+    if (uringSubmit(&loop->ring) < 0) perror("Error submitting to io_uring");
+    unsigned int remaining = loop->ring.pendingSubmissions;
+    pthread_mutex_unlock(&loop->ringMutex);
+    return remaining;
+}
+
+// Helper function to return the oldest queued send
+static SendRequest* outputHead(const OutputQueue* queue) {
+    return queue->requests[queue->head];
+}
+
+// Helper function to append a send to a queue, growing its ring when full; returns 0 or -1
+static int pushOutput(OutputQueue* queue, SendRequest* request) {
+    if (queue->count == queue->capacity) {
+        unsigned int capacity = queue->capacity ? queue->capacity * 2 : OUTPUT_QUEUE_INITIAL_CAPACITY;
+        SendRequest** requests = (SendRequest**)memoryPoolAlloc(capacity * sizeof(SendRequest*)); // Per connection, so pooled
+        if (requests == NULL) return -1;
+        for (unsigned int i = 0; i < queue->count; i++) {
+            requests[i] = queue->requests[(queue->head + i) % queue->capacity]; // Unwrap the ring
+        }
+        memoryPoolFree(queue->requests);
+        queue->requests = requests;
+        queue->capacity = capacity;
+        queue->head = 0;
+    }
+    queue->requests[(queue->head + queue->count) % queue->capacity] = request;
+    queue->count++;
+    queue->queuedBytes += request->message->length - request->offset;
+    return 0;
+}
+
+// Helper function to remove the oldest send from a queue, leaving it to the caller
+static SendRequest* popOutput(OutputQueue* queue) {
+    SendRequest* request = queue->requests[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    queue->queuedBytes -= request->message->length - request->offset;
+    return request;
+}
+
+// Helper function to put a send back in front of a queue; only used right after popOutput
+static void pushOutputFront(OutputQueue* queue, SendRequest* request) {
+    queue->head = (queue->head + queue->capacity - 1) % queue->capacity;
+    queue->requests[queue->head] = request;
+    queue->count++;
+    queue->queuedBytes += request->message->length - request->offset;
+}
+
+// Helper function to discard a queue. A send still in flight on the ring is only unlinked:
+// its completion frees it once it finds the registration gone.
+static void clearOutput(OutputQueue* queue) {
+    if (queue->count > 0 && queue->headInFlight) popOutput(queue);
+    while (queue->count > 0) freeSendRequest(popOutput(queue));
+    queue->headInFlight = 0;
+}
+
+// Helper function to discard the oldest sends the kernel has not started on until incoming bytes fit
+static void dropOldestOutput(OutputQueue* queue, size_t incoming) {
+    SendRequest* started = NULL; // A partly written or in-flight send must stay to keep the stream intact
+    if (queue->count > 0 && (queue->headInFlight || outputHead(queue)->offset > 0)) started = popOutput(queue);
+    while (queue->count > 0 && queue->queuedBytes + (started ? started->message->length - started->offset : 0) + incoming > queue->highWatermark) {
+        freeSendRequest(popOutput(queue));
+        metricsAdd(METRIC_MESSAGES_DROPPED, 1);
+    }
+    if (started != NULL) pushOutputFront(queue, started);
+}
+
+// Helper function to wake the senders paused on a queue once it drained to its low watermark
+static void notifyDrained(OutputQueue* queue, int socket) {
+    int stripe = socket % REGISTRY_LOCK_STRIPES;
+    if (stripePausedSenders[stripe] > 0 && queue->queuedBytes <= queue->lowWatermark) {
+        pthread_cond_broadcast(&stripeDrained[stripe]);
+    }
+}
+
+// Helper function to update the epoll events of a registration. Called with the stripe lock held.
+static int watchRegistration(SocketSlot* slot, int socket, int operation) {
+    struct epoll_event event = { .events = watchedEvents(slot), .data.u64 = registrationKey(socket, slot->generation) };
+    return epoll_ctl(slot->ownerLoop->epollDescriptor, operation, socket, &event);
+}
+
+// Helper function to arm a registration: a receive on the ring for ring completions, epoll otherwise.
+// Called with the stripe lock held; returns 0 on success and -1 on failure.
+static int armRegistration(SocketSlot* slot, int socket, int operation) {
+    if (usesRing(slot->flags)) {
+        queueRingReceive(slot->ownerLoop, socket, slot->generation);
+        return 0;
+    }
+    slot->readInterest = !(slot->flags & PROACTOR_WRITE_ONLY) && !slot->inputPaused;
+    return watchRegistration(slot, socket, operation);
+}
+
+// Helper function to account for bytes the kernel took from the front of a queue
+static void consumeOutput(OutputQueue* queue, size_t sent) {
+    metricsAdd(METRIC_BYTES_SENT, (int64_t)sent);
+    while (sent > 0) {
+        SendRequest* request = outputHead(queue);
+        size_t remaining = request->message->length - request->offset;
+        size_t taken = sent < remaining ? sent : remaining;
+        request->offset += taken;
+        queue->queuedBytes -= taken;
+        sent -= taken;
+        if (request->offset == request->message->length) freeSendRequest(popOutput(queue));
+    }
+}
+
+// Helper function to write queued output until the send buffer is full; runs with the stripe lock held.
+// Several queued messages are gathered into each sendmsg call.
+// Returns 0 when the queue was written or the socket is full, -1 if the connection broke (the queue is dropped).
+static int drainSendQueue(SocketSlot* slot, int socket) {
+    OutputQueue* queue = &slot->output;
+    int result = 0;
+    while (queue->count > 0) {
+        struct iovec vectors[DRAIN_VECTORS];
+        int vectorCount = 0;
+        size_t gathered = 0; // Bytes offered to the kernel by this call
+        for (unsigned int i = 0; i < queue->count && vectorCount + PROACTOR_MESSAGE_MAX_PARTS <= DRAIN_VECTORS; i++) {
+            SendRequest* request = queue->requests[(queue->head + i) % queue->capacity];
+            ProactorMessage* message = request->message;
+            vectorCount += remainingVectors(message->parts, message->partCount, request->offset, vectors + vectorCount);
+            gathered += message->length - request->offset;
+        }
+        struct msghdr header = { .msg_iov = vectors, .msg_iovlen = (size_t)vectorCount };
+        ssize_t sent = sendmsg(socket, &header, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue; // Interrupted, try again
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break; // Full: the loop waits for EPOLLOUT
+            clearOutput(queue); // The connection is broken, drop what is still queued
+            result = -1;
+            break;
+        }
+        consumeOutput(queue, (size_t)sent);
+        if ((size_t)sent < gathered) break; // The send buffer filled up: wait for EPOLLOUT
+    }
+    notifyDrained(queue, socket);
+    return result;
+}
+
+// Helper function to check whether the peer has finished sending and no data is left to read
+static int socketAtEndOfStream(int socket) {
+    char probe; // Single byte used for peeking
+    ssize_t peeked = recv(socket, &probe, 1, MSG_PEEK | MSG_DONTWAIT); // Look without consuming
+    if (peeked == 0) return 1; // Orderly shutdown and nothing left in the receive buffer
+    if (peeked < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return 1; // Socket error
+    return 0; // Data is still pending, keep the registration alive
+}
+
+// Helper function to allocate a timer on a loop
+static ProactorTimer* createLoopTimer(EventLoop* loop, ProactorTimerCallback callback, void* argument) {
+    ProactorTimer* timer = (ProactorTimer*)memoryPoolAlloc(sizeof(ProactorTimer)); // One per connection with an idle timeout
+    if (timer == NULL) return NULL;
+    memset(timer, 0, sizeof(ProactorTimer));
+    timer->loop = loop;
+    timer->callback = callback;
+    timer->argument = argument;
+    return timer;
+}
+
+// Helper function to drop a registration's idle timeout; called with the stripe lock held
+static void dropIdleTimeout(SocketSlot* slot) {
+    destroyProactorTimer(slot->idleTimer); // Freed after its callback when it is firing right now
+    slot->idleTimer = NULL;
+    releaseProactorMessage(slot->heartbeat);
+    slot->heartbeat = NULL;
+}
+
+// Helper function to drop a registration, optionally closing its socket; returns 0 if it was already gone
+static int releaseSocketSlot(int socket, uint32_t generation, int closeSocket) {
+    SocketSlot* slot = findSocketSlot(socket, 0);
+    if (slot == NULL) return 0;
+
+    pthread_mutex_lock(slotLock(socket));
+    if (!slot->inUse || slot->generation != generation) {
+        pthread_mutex_unlock(slotLock(socket));
+        return 0; // Released by somebody else
+    }
+    if (usesRing(slot->flags)) {
+        queueRingCancel(slot->ownerLoop, socket, generation); // The pending receive holds its own reference to the socket
+    } else {
+        epoll_ctl(slot->ownerLoop->epollDescriptor, EPOLL_CTL_DEL, socket, NULL); // Stop watching the socket
+    }
+    slot->inUse = 0;
+    slot->generation++; // Invalidate every event still carrying the old key
+    metricsAdd(METRIC_RELEASES, 1);
+    clearOutput(&slot->output); // The send in flight is freed when the ring completes it
+    memoryPoolFree(slot->output.requests);
+    slot->output.requests = NULL;
+    slot->output.capacity = 0;
+    dropIdleTimeout(slot);
+    if (stripePausedSenders[socket % REGISTRY_LOCK_STRIPES] > 0) {
+        pthread_cond_broadcast(&stripeDrained[socket % REGISTRY_LOCK_STRIPES]); // Paused senders give up
+    }
+    int buffer = slot->readyBuffer; // Completed read whose dispatch will now be dropped as stale
+    EventLoop* loop = slot->ownerLoop;
+    slot->readyBuffer = -1;
+    slot->readyData = NULL;
+    pthread_mutex_unlock(slotLock(socket));
+
+    if (buffer >= 0) returnReceiveBuffer(loop, buffer);
+    // The descriptor number cannot be reused before close, so closing outside the lock is safe
+    if (closeSocket) close(socket);
+    return 1;
+}
+
+// Worker task running the callback of a ready socket and deciding whether to keep watching it
+static void runSocketCallback(void* arg) {
+    uint64_t key = (uint64_t)(uintptr_t)arg; // Registration the event belongs to
+    int socket = (int)(uint32_t)key;
+    uint32_t generation = (uint32_t)(key >> 32);
+    SocketSlot* slot = findSocketSlot(socket, 0);
+    if (slot == NULL) return;
+
+    // Take a consistent copy of the registration
+    pthread_mutex_lock(slotLock(socket));
+    if (!slot->inUse || slot->generation != generation) {
+        pthread_mutex_unlock(slotLock(socket));
+        return; // Stale event for a registration that no longer exists
+    }
+    ProactorCallback callback = slot->callbackFunction;
+    ProactorEventCallback eventCallback = slot->eventCallback;
+    ProactorEventInfo info = { .socket = socket, .data = slot->readyData, .data_len = slot->readyLength, .context = slot->context };
+    EventLoop* loop = slot->ownerLoop;
+    int flags = slot->flags;
+    int buffer = slot->readyBuffer; // Ring buffer to give back once the callback is done with it
+    uint32_t events = slot->readyEvents; // Events reported by the event loop
+    slot->readyData = NULL;
+    slot->readyLength = 0;
+    slot->readyBuffer = -1;
+    pthread_mutex_unlock(slotLock(socket));
+
+    // Work out whether the peer hung up once everything it sent has been consumed
+    int hangup = 0;
+    int deliver = 1; // Whether the callback runs for this event
+    if (usesRing(flags)) {
+        hangup = (events & (EPOLLRDHUP | EPOLLERR)) != 0; // The ring already completed the read
+    } else if (flags & PROACTOR_COMPLETION) {
+        // Complete the read here so the callback receives data just like with the ring
+        ssize_t received = recv(socket, receiveBuffer, sizeof(receiveBuffer), MSG_DONTWAIT);
+        if (received > 0) {
+            info.data = receiveBuffer;
+            info.data_len = (size_t)received;
+        } else if (received == 0) {
+            hangup = 1; // Orderly shutdown
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            deliver = 0; // Spurious wake-up: nothing to deliver, just re-arm
+        } else {
+            events |= EPOLLERR; // Connection error
+            hangup = 1;
+        }
+    } else {
+        hangup = (events & EPOLLERR) || ((events & (EPOLLRDHUP | EPOLLHUP)) && socketAtEndOfStream(socket));
+    }
+    info.events = PROACTOR_EVENT_READ;
+    if (hangup) info.events |= PROACTOR_EVENT_HANGUP;
+    if (events & EPOLLERR) info.events |= PROACTOR_EVENT_ERROR;
+
+    // A socket owned by the caller leaves the proactor before its last callback, so the callback may close it
+    if (hangup && !(flags & PROACTOR_CLOSE_ON_HANGUP)) releaseSocketSlot(socket, generation, 0);
+
+    // Let the callback consume the data that is available now
+    if (deliver) {
+        uint64_t started = metricsNow();
+        if (callback != NULL) callback(socket);
+        else eventCallback(&info);
+        metricsObserve(HISTOGRAM_CALLBACK, metricsNow() - started);
+        metricsAdd(METRIC_CALLBACKS, 1);
+        metricsAdd(METRIC_BYTES_RECEIVED, (int64_t)info.data_len);
+    }
+
+    // The data handed to the callback is only valid during the call
+    if (buffer >= 0) returnReceiveBuffer(loop, buffer);
+
+    if (hangup) {
+        if (flags & PROACTOR_CLOSE_ON_HANGUP) releaseSocketSlot(socket, generation, 1); // Close a socket the proactor owns
+        return;
+    }
+
+    // Re-arm a persistent registration unless the callback unregistered it meanwhile
+    pthread_mutex_lock(slotLock(socket));
+    int rearmFailed = 0;
+    if (slot->inUse && slot->generation == generation) {
+        slot->dispatching = 0;
+        if (slot->inputPaused) pthread_cond_broadcast(&stripeDrained[socket % REGISTRY_LOCK_STRIPES]); // Wakes pauseSocketInput
+        // A one-shot registration stays disarmed until rearmSocket()
+        if (!(flags & PROACTOR_ONESHOT) || !deliver) rearmFailed = armRegistration(slot, socket, EPOLL_CTL_MOD) == -1;
+    }
+    pthread_mutex_unlock(slotLock(socket));
+    if (rearmFailed) {
+        perror("Error re-arming socket"); // Handle re-arm error
+        releaseSocketSlot(socket, generation, flags & PROACTOR_CLOSE_ON_HANGUP);
+    }
+}
+
+// Helper function to hand a registration whose event was recorded in its slot to the workers
+static void dispatchRegistration(uint64_t key) {
+    if (submitWorkerTask(callbackPool, runSocketCallback, (void*)(uintptr_t)key) != 0) {
+        runSocketCallback((void*)(uintptr_t)key); // Could not queue the task, run it on the loop thread instead
+    }
+}
+
+// Helper function to handle a completed ring receive on the loop thread
+static void completeRingReceive(EventLoop* loop, uint64_t payload, int result, unsigned int cqeFlags) {
+    int socket = (int)(uint32_t)payload;
+    uint32_t ringGeneration = (uint32_t)(payload >> 32) & RING_GENERATION_MASK;
+    int buffer = (cqeFlags & IORING_CQE_F_BUFFER) ? (int)(cqeFlags >> IORING_CQE_BUFFER_SHIFT) : -1;
+    SocketSlot* slot = findSocketSlot(socket, 0);
+
+    if (slot != NULL) pthread_mutex_lock(slotLock(socket));
+    if (slot == NULL || !slot->inUse || (slot->generation & RING_GENERATION_MASK) != ringGeneration) {
+        if (slot != NULL) pthread_mutex_unlock(slotLock(socket));
+        if (buffer >= 0) returnReceiveBuffer(loop, buffer); // Completed for a registration that is gone
+        return;
+    }
+    if (result == -ENOBUFS) {
+        // Every buffer is lent to a callback: retry once one is given back
+        pthread_mutex_lock(&loop->ringMutex);
+        if (loop->starvedCount == loop->starvedCapacity) {
+            int capacity = loop->starvedCapacity ? loop->starvedCapacity * 2 : 64;
+            uint64_t* grown = (uint64_t*)realloc(loop->starvedReceives, capacity * sizeof(uint64_t));
+            if (grown != NULL) {
+                loop->starvedReceives = grown;
+                loop->starvedCapacity = capacity;
+            }
+        }
+        if (loop->starvedCount < loop->starvedCapacity) {
+            loop->starvedReceives[loop->starvedCount++] = registrationKey(socket, slot->generation);
+        }
+        pthread_mutex_unlock(&loop->ringMutex);
+        pthread_mutex_unlock(slotLock(socket));
+        return;
+    }
+    if (slot->idleTimer != NULL) __atomic_store_n(&slot->lastInput, loop->now, __ATOMIC_RELAXED);
+    slot->readyBuffer = buffer;
+    slot->readyData = buffer >= 0 ? loop->receiveBuffers + (size_t)buffer * RECEIVE_BUFFER_SIZE : NULL;
+    slot->readyLength = result > 0 ? (size_t)result : 0;
+    slot->readyEvents = result > 0 ? EPOLLIN : (result == 0 ? (EPOLLIN | EPOLLRDHUP) : EPOLLERR);
+    slot->dispatching = 1;
+    uint64_t key = registrationKey(socket, slot->generation);
+    pthread_mutex_unlock(slotLock(socket));
+
+    dispatchRegistration(key);
+}
+
+// Helper function to handle a completed ring send on the loop thread
+static void completeRingSend(EventLoop* loop, SendRequest* request, int result) {
+    __atomic_sub_fetch(&loop->sendsInFlight, 1, __ATOMIC_RELAXED);
+    int socket = request->socket;
+    SocketSlot* slot = findSocketSlot(socket, 0);
+    if (slot == NULL) {
+        freeSendRequest(request);
+        return;
+    }
+
+    pthread_mutex_lock(slotLock(socket));
+    OutputQueue* queue = &slot->output;
+    if (!slot->inUse || slot->generation != request->generation || !queue->headInFlight || outputHead(queue) != request) {
+        pthread_mutex_unlock(slotLock(socket));
+        freeSendRequest(request); // The registration went away while the send was in flight
+        return;
+    }
+    if (result < 0) {
+        clearOutput(queue); // The connection is broken, drop what is still queued
+        freeSendRequest(request);
+    } else {
+        request->offset += (size_t)result;
+        queue->queuedBytes -= (size_t)result;
+        metricsAdd(METRIC_BYTES_SENT, result);
+        if (request->offset < request->message->length) {
+            queueRingSend(loop, request); // Short send: submit the rest
+            notifyDrained(queue, socket);
+            pthread_mutex_unlock(slotLock(socket));
+            return;
+        }
+        freeSendRequest(popOutput(queue));
+        queue->headInFlight = 0;
+    }
+    // Start the next queued send, if any
+    if (queue->count > 0) {
+        queue->headInFlight = 1;
+        queueRingSend(loop, outputHead(queue));
+    }
+    notifyDrained(queue, socket);
+    pthread_mutex_unlock(slotLock(socket));
+}
+
+// Helper function to reap every completion posted on a loop's ring
+static void processRingCompletions(EventLoop* loop) {
+    struct io_uring_cqe* cqe;
+    while ((cqe = uringPeekCqe(&loop->ring)) != NULL) {
+        uint64_t userData = cqe->user_data;
+        int result = cqe->res;
+        unsigned int cqeFlags = cqe->flags;
+        uringCqeSeen(&loop->ring); // Free the entry before the handlers queue new submissions
+
+        switch ((int)(userData >> RING_TAG_SHIFT)) {
+        case RING_OP_RECEIVE:
+            completeRingReceive(loop, userData & RING_PAYLOAD_MASK, result, cqeFlags);
+            break;
+        case RING_OP_SEND:
+            completeRingSend(loop, (SendRequest*)(uintptr_t)(userData & RING_PAYLOAD_MASK), result);
+            break;
+        case RING_OP_PROVIDE:
+            if (result < 0) fprintf(stderr, "Error providing receive buffers: %s\n", strerror(-result));
+            break;
+        default:
+            break; // Cancellations need no follow-up
+        }
+    }
+}
+
+// Helper function to run and free the tasks in a loop's inbox, oldest first; only the loop's thread (or cleanup once it stopped) calls it
+static void runInbox(EventLoop* loop) {
+    mpscQueueAcknowledge(&loop->inbox); // Tasks posted from now on wake the loop again
+    MpscNode* node;
+    while ((node = mpscQueuePop(&loop->inbox)) != NULL) {
+        LoopTask* task = (LoopTask*)node;
+        task->task(task->argument);
+        memoryPoolFree(task);
+        metricsAdd(METRIC_TASKS_RUN, 1);
+    }
+}
+
+// Helper function to accept the connections waiting on a loop's listener
+static void acceptConnections(EventLoop* loop) {
+    if (loop->listenDescriptor == -1) return; // Closed by proactorStopListening earlier in this batch
+    for (int i = 0; i < ACCEPT_BATCH; i++) {
+        int client = accept(loop->listenDescriptor, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue; // The next connection may still be fine
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("Error accepting connection");
+            return; // Drained (or failing): wait for the next readiness event
+        }
+        metricsAdd(METRIC_ACCEPTED, 1);
+        loop->acceptCallback(client, loop->acceptContext); // Registrations it makes stay on this loop
+    }
+}
+
+// Helper function to compute how long a loop may sleep before its next timer is due, -1 for no limit
+static int sleepTimeout(EventLoop* loop) {
+    pthread_mutex_lock(&loop->timerMutex);
+    uint64_t next = timerWheelNextTick(&loop->timers);
+    loop->wakeTime = next; // Timers scheduled from now on that are due earlier wake the loop
+    pthread_mutex_unlock(&loop->timerMutex);
+    if (next == UINT64_MAX) return -1;
+    uint64_t now = currentMilliseconds();
+    if (next <= now) return 0;
+    return next - now > INT_MAX ? INT_MAX : (int)(next - now);
+}
+
+// Helper function to run the timers of a loop that came due; a callback may restart, stop or destroy its own timer
+static void runTimers(EventLoop* loop) {
+    pthread_mutex_lock(&loop->timerMutex);
+    loop->wakeTime = 0; // Awake: timers scheduled meanwhile are seen before the loop sleeps again
+    timerWheelAdvance(&loop->timers, currentMilliseconds());
+    TimerNode* node;
+    while ((node = loop->timers.expired) != NULL) {
+        ProactorTimer* timer = (ProactorTimer*)node;
+        timerWheelRemove(&loop->timers, node);
+        timer->firing = 1;
+        pthread_mutex_unlock(&loop->timerMutex);
+        timer->callback(timer->argument);
+        metricsAdd(METRIC_TIMERS_FIRED, 1);
+        pthread_mutex_lock(&loop->timerMutex);
+        timer->firing = 0;
+        if (timer->destroyed) memoryPoolFree(timer);
+    }
+    pthread_mutex_unlock(&loop->timerMutex);
+}
+
+// Thread function running one epoll event loop
+static void* eventLoopThread(void* arg) {
+    EventLoop* loop = (EventLoop*)arg; // The loop served by this thread
+    struct epoll_event events[PROACTOR_MAX_EVENTS]; // Events harvested per iteration
+    unsigned int unsubmitted = 0; // Ring entries the kernel refused during the last flush
+    currentLoop = loop; // Ring entries queued from this thread are submitted at the end of the iteration
+
+    while (1) {
+        // Sleep until the next timer at the latest, and poll while the kernel refused part of the last submission
+        int timeout = sleepTimeout(loop);
+        if (unsubmitted > 0 && (timeout < 0 || timeout > 1)) timeout = 1;
+        int count = epoll_wait(loop->epollDescriptor, events, PROACTOR_MAX_EVENTS, timeout); // Wait for ready sockets
+        if (count < 0) {
+            if (errno == EINTR) continue; // Interrupted by a signal, wait again
+            perror("Error waiting for events"); // Handle epoll error
+            return NULL; // End the thread
+        }
+        uint64_t iterationStart = metricsNow(); // Time spent on the batch shows loop stalls
+        loop->now = currentMilliseconds();
+        for (int i = 0; i < count; i++) {
+            uint64_t key = events[i].data.u64;
+            uint64_t counter; // Value drained from an eventfd
+            if (key == WAKE_EVENT_KEY) {
+                if (read(loop->wakeDescriptor, &counter, sizeof(counter)) < 0 && errno != EAGAIN) perror("Error reading wake descriptor");
+                if (__atomic_load_n(&loop->stopping, __ATOMIC_ACQUIRE)) return NULL; // The proactor is shutting down
+                runInbox(loop); // Woken for posted tasks, or to submit ring entries, which happens below
+                continue;
+            }
+            if (key == LISTEN_EVENT_KEY) {
+                acceptConnections(loop);
+                continue;
+            }
+            if (key == RING_EVENT_KEY) {
+                if (read(loop->ringEventDescriptor, &counter, sizeof(counter)) < 0 && errno != EAGAIN) perror("Error reading ring descriptor");
+                processRingCompletions(loop);
+                continue;
+            }
+            int socket = (int)(uint32_t)key;
+            SocketSlot* slot = findSocketSlot(socket, 0);
+            if (slot == NULL) continue;
+
+            // Handle the events unless the registration changed since the socket was armed
+            pthread_mutex_lock(slotLock(socket));
+            int dispatch = 0;
+            if (slot->inUse && slot->generation == (uint32_t)(key >> 32)) {
+                uint32_t ready = events[i].events;
+                if (hasQueuedOutput(slot) && (ready & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+                    drainSendQueue(slot, socket); // Output is written here, never by the workers
+                }
+                if (slot->readInterest && (ready & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+                    if (slot->idleTimer != NULL) __atomic_store_n(&slot->lastInput, loop->now, __ATOMIC_RELAXED);
+                    slot->readInterest = 0; // A single dispatch in flight until the callback re-arms the socket
+                    slot->dispatching = 1;
+                    slot->readyEvents = ready;
+                    dispatch = 1;
+                }
+                // The one-shot registration was disarmed by this event: keep watching what is still wanted
+                if ((slot->readInterest || hasQueuedOutput(slot)) && watchRegistration(slot, socket, EPOLL_CTL_MOD) == -1) {
+                    perror("Error re-arming socket");
+                }
+            }
+            pthread_mutex_unlock(slotLock(socket));
+            if (dispatch) dispatchRegistration(key);
+        }
+        runTimers(loop);
+
+        // Submit everything queued during this iteration with a single system call
+        if (completionBackend == PROACTOR_BACKEND_IO_URING) unsubmitted = flushRing(loop);
+        if (count > 0) metricsObserve(HISTOGRAM_LOOP_ITERATION, metricsNow() - iterationStart);
+    }
+}
+
+// Helper function to create a loop's ring and hand it the receive buffers; returns 0 or -1 with errno set
+static int setupLoopRing(EventLoop* loop) {
+    if (uringSetup(&loop->ring, RING_SUBMISSION_ENTRIES, RING_COMPLETION_ENTRIES) != 0) return -1;
+    loop->ringEventDescriptor = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    loop->receiveBuffers = (char*)malloc((size_t)RECEIVE_BUFFER_COUNT * RECEIVE_BUFFER_SIZE);
+    if (loop->ringEventDescriptor == -1 || loop->receiveBuffers == NULL ||
+        uringRegisterEventfd(&loop->ring, loop->ringEventDescriptor) != 0) {
+        int savedErrno = errno;
+        if (loop->ringEventDescriptor != -1) close(loop->ringEventDescriptor);
+        free(loop->receiveBuffers);
+        uringTeardown(&loop->ring);
+        errno = savedErrno;
+        return -1;
+    }
+    pthread_mutex_init(&loop->ringMutex, NULL);
+
+    // Provide every receive buffer with one request
+    struct io_uring_sqe* sqe = uringGetSqe(&loop->ring);
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = RECEIVE_BUFFER_COUNT; // Number of buffers
+    sqe->addr = (uint64_t)(uintptr_t)loop->receiveBuffers;
+    sqe->len = RECEIVE_BUFFER_SIZE;
+    sqe->buf_group = RECEIVE_BUFFER_GROUP;
+    sqe->off = 0; // Id of the first buffer
+    sqe->user_data = (uint64_t)RING_OP_PROVIDE << RING_TAG_SHIFT;
+    uringSubmit(&loop->ring);
+
+    // Completions wake the loop through epoll like any other event
+    struct epoll_event ringEvent = { .events = EPOLLIN, .data.u64 = RING_EVENT_KEY };
+    epoll_ctl(loop->epollDescriptor, EPOLL_CTL_ADD, loop->ringEventDescriptor, &ringEvent);
+    return 0;
+}
+
+// Helper function to reap the sends still in flight on a stopped loop's ring, so each completion frees its request.
+// The registrations must be invalidated first so the completions only free. Sends of released registrations wait on sockets
+// their owners keep, so everything pending is cancelled; on older kernels shutting the registered sockets down must do.
+static void drainRingSends(EventLoop* loop) {
+    queueRingCancelAll(loop);
+    for (int waited = 0; waited < RING_DRAIN_TIMEOUT_MS; waited += 10) {
+        flushRing(loop); // Returned receive buffers queue entries too
+        processRingCompletions(loop);
+        if (__atomic_load_n(&loop->sendsInFlight, __ATOMIC_RELAXED) == 0) return;
+        struct pollfd ready = { .fd = loop->ringEventDescriptor, .events = POLLIN };
+        uint64_t counter;
+        if (poll(&ready, 1, 10) > 0 && read(loop->ringEventDescriptor, &counter, sizeof(counter)) < 0 && errno != EAGAIN) {
+            perror("Error reading ring descriptor");
+        }
+    }
+    fprintf(stderr, "Error draining io_uring: %d sends still in flight\n", loop->sendsInFlight);
+}
+
+// Helper function to release a loop's ring and its buffers
+static void teardownLoopRing(EventLoop* loop) {
+    uringTeardown(&loop->ring);
+    close(loop->ringEventDescriptor);
+    free(loop->receiveBuffers);
+    free(loop->starvedReceives);
+    pthread_mutex_destroy(&loop->ringMutex);
+}
+
+// Function to initialize the proactor with explicit loop and worker counts
+void initializeProactorWithConfig(const ProactorConfig* config) {
+    int loops = (config != NULL && config->eventLoops > 0) ? config->eventLoops : PROACTOR_EVENT_LOOPS;
+    int workers = (config != NULL) ? config->workerThreads : 0; // 0 lets the pool size itself to the cores
+    completionBackend = (config != NULL) ? config->backend : PROACTOR_BACKEND_EPOLL;
+
+    // Size the registry after the highest descriptor this process may open
+    struct rlimit descriptorLimit;
+    rlim_t maxDescriptors = REGISTRY_MAX_DESCRIPTORS;
+    if (getrlimit(RLIMIT_NOFILE, &descriptorLimit) == 0 && descriptorLimit.rlim_cur < maxDescriptors) {
+        maxDescriptors = descriptorLimit.rlim_cur;
+    }
+    slotChunkCount = (int)((maxDescriptors + REGISTRY_CHUNK_SLOTS - 1) / REGISTRY_CHUNK_SLOTS);
+    slotChunks = (SocketSlot**)calloc(slotChunkCount, sizeof(SocketSlot*));
+    for (int i = 0; i < REGISTRY_LOCK_STRIPES; i++) {
+        pthread_mutex_init(&stripeLocks[i], NULL); // Initialize the mutexes for thread safety
+        pthread_cond_init(&stripeDrained[i], NULL);
+    }
+
+    // Start the workers before any event can be dispatched to them
+    callbackPool = createWorkerPool(workers);
+    eventLoops = (EventLoop*)calloc(loops, sizeof(EventLoop));
+    if (slotChunks == NULL || callbackPool == NULL || eventLoops == NULL) {
+        perror("Error allocating proactor"); // Handle allocation error
+        exit(EXIT_FAILURE);
+    }
+    eventLoopCount = loops;
+
+    // Create every event loop together with its wake descriptor
+    for (int i = 0; i < eventLoopCount; i++) {
+        EventLoop* loop = &eventLoops[i];
+        loop->epollDescriptor = epoll_create1(EPOLL_CLOEXEC); // Create the epoll instance
+        loop->wakeDescriptor = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK); // Create the wake descriptor
+        if (loop->epollDescriptor == -1 || loop->wakeDescriptor == -1) {
+            perror("Error creating event loop"); // Handle creation error
+            exit(EXIT_FAILURE);
+        }
+        struct epoll_event wakeEvent = { .events = EPOLLIN, .data.u64 = WAKE_EVENT_KEY };
+        epoll_ctl(loop->epollDescriptor, EPOLL_CTL_ADD, loop->wakeDescriptor, &wakeEvent);
+        loop->listenDescriptor = -1; // Listeners are only opened by proactorListen
+        mpscQueueInit(&loop->inbox, loop->wakeDescriptor);
+        timerWheelInit(&loop->timers, currentMilliseconds());
+        pthread_mutex_init(&loop->timerMutex, NULL);
+    }
+
+    // Give every loop a ring when io_uring was asked for, falling back to epoll if the kernel refuses
+    if (completionBackend == PROACTOR_BACKEND_IO_URING) {
+        for (int i = 0; i < eventLoopCount; i++) {
+            if (setupLoopRing(&eventLoops[i]) == 0) continue;
+            perror("io_uring unavailable, falling back to epoll");
+            while (--i >= 0) {
+                epoll_ctl(eventLoops[i].epollDescriptor, EPOLL_CTL_DEL, eventLoops[i].ringEventDescriptor, NULL);
+                teardownLoopRing(&eventLoops[i]);
+            }
+            completionBackend = PROACTOR_BACKEND_EPOLL;
+            break;
+        }
+    }
+
+    for (int i = 0; i < eventLoopCount; i++) {
+        if (pthread_create(&eventLoops[i].thread, NULL, eventLoopThread, &eventLoops[i]) != 0) {
+            perror("Error creating event loop thread"); // Handle thread creation error
+            exit(EXIT_FAILURE);
+        }
+    }
+    proactorRunning = 1; // Registrations are accepted from now on
+}
+
+// Function to initialize the proactor with the default configuration
 void initializeProactor() {
-    // Initialize the mutex for thread safety
-    pthread_mutex_init(&socketListMutex, NULL);
+    initializeProactorWithConfig(NULL);
+}
+
+// Function to report the library version
+int proactorVersion() {
+    return PROACTOR_VERSION;
+}
+
+// Function to report the backend completing reads and sends
+int proactorBackend() {
+    return completionBackend;
 }
 
 // Function to clean up resources used by the proactor
 void cleanupProactor() {
-    // Destroy the mutex
-    pthread_mutex_destroy(&socketListMutex);
+    if (!proactorRunning) return; // Nothing to clean up
+    __atomic_store_n(&proactorRunning, 0, __ATOMIC_RELEASE); // Paused senders check it while waiting
+
+    stopMetricsAdmin(); // Nothing is left to report on
+
+    // Wake and join every event loop so no new event is dispatched
+    for (int i = 0; i < eventLoopCount; i++) {
+        uint64_t one = 1;
+        __atomic_store_n(&eventLoops[i].stopping, 1, __ATOMIC_RELEASE);
+        if (write(eventLoops[i].wakeDescriptor, &one, sizeof(one)) < 0) perror("Error waking event loop");
+        pthread_join(eventLoops[i].thread, NULL);
+    }
+
+    // Senders paused on an output queue would wait forever now that nothing drains it
+    for (int i = 0; i < REGISTRY_LOCK_STRIPES; i++) {
+        pthread_mutex_lock(&stripeLocks[i]);
+        pthread_cond_broadcast(&stripeDrained[i]);
+        pthread_mutex_unlock(&stripeLocks[i]);
+    }
+
+    // Let the workers finish the callbacks already handed to them
+    destroyWorkerPool(callbackPool);
+    callbackPool = NULL;
+
+    // Tasks posted to the stopped loops still run: they may own references, and their sockets are still registered
+    for (int i = 0; i < eventLoopCount; i++) runInbox(&eventLoops[i]);
+
+    // A send in flight on a ring is the kernel's until it completes, including those of registrations released earlier.
+    // Invalidate every registration so the completions only free, unlink what is in flight, and shut the sockets down
+    // (they are closed below anyway); then reap the rings while the registry still exists.
+    if (completionBackend == PROACTOR_BACKEND_IO_URING) {
+        for (int chunk = 0; chunk < slotChunkCount; chunk++) {
+            if (slotChunks[chunk] == NULL) continue;
+            for (int i = 0; i < REGISTRY_CHUNK_SLOTS; i++) {
+                SocketSlot* slot = &slotChunks[chunk][i];
+                if (!slot->inUse) continue;
+                slot->generation++;
+                clearOutput(&slot->output);
+                shutdown(chunk * REGISTRY_CHUNK_SLOTS + i, SHUT_RDWR);
+            }
+        }
+        for (int i = 0; i < eventLoopCount; i++) drainRingSends(&eventLoops[i]);
+    }
+
+    // Close every socket that is still registered and free the registry
+    for (int chunk = 0; chunk < slotChunkCount; chunk++) {
+        if (slotChunks[chunk] == NULL) continue;
+        for (int i = 0; i < REGISTRY_CHUNK_SLOTS; i++) {
+            SocketSlot* slot = &slotChunks[chunk][i];
+            if (!slot->inUse) continue;
+            while (slot->output.count > 0) freeSendRequest(popOutput(&slot->output)); // The rings were drained: nothing is in flight
+            memoryPoolFree(slot->output.requests);
+            memoryPoolFree(slot->idleTimer); // The loops are stopped, so no timer is firing
+            releaseProactorMessage(slot->heartbeat);
+            close(chunk * REGISTRY_CHUNK_SLOTS + i);
+        }
+        free(slotChunks[chunk]);
+    }
+    free(slotChunks);
+    slotChunks = NULL;
+    slotChunkCount = 0;
+    for (int i = 0; i < REGISTRY_LOCK_STRIPES; i++) {
+        pthread_mutex_destroy(&stripeLocks[i]); // Destroy the mutexes
+        pthread_cond_destroy(&stripeDrained[i]);
+    }
+
+    for (int i = 0; i < eventLoopCount; i++) {
+        if (completionBackend == PROACTOR_BACKEND_IO_URING) teardownLoopRing(&eventLoops[i]);
+        if (eventLoops[i].listenDescriptor != -1) close(eventLoops[i].listenDescriptor);
+        close(eventLoops[i].wakeDescriptor);
+        close(eventLoops[i].epollDescriptor);
+        pthread_mutex_destroy(&eventLoops[i].timerMutex);
+    }
+    free(eventLoops);
+    eventLoops = NULL;
+    eventLoopCount = 0;
+}
+
+// Helper function shared by both registration functions; returns 0 on success and -1 on failure
+static int addRegistration(int socket, ProactorCallback callback, ProactorEventCallback eventCallback,
+                           void* context, int flags) {
+    if (!proactorRunning) {
+        fprintf(stderr, "Error registering socket: proactor is not initialized\n");
+        return -1;
+    }
+
+    // Find the slot of the descriptor in the registry
+    SocketSlot* slot = findSocketSlot(socket, 1);
+    if (slot == NULL) {
+        fprintf(stderr, "Error registering socket %d: descriptor outside the registry\n", socket);
+        return -1;
+    }
+
+    // Edge-triggered callbacks read until EAGAIN, which needs a non-blocking socket
+    if (flags & PROACTOR_EDGE_TRIGGERED) {
+        int socketFlags = fcntl(socket, F_GETFL, 0);
+        if (socketFlags == -1 || fcntl(socket, F_SETFL, socketFlags | O_NONBLOCK) == -1) {
+            perror("Error making socket non-blocking");
+            return -1;
+        }
+    }
+
+    // Fill the slot and hand the socket to its event loop while holding the slot lock
+    pthread_mutex_lock(slotLock(socket));
+    if (slot->inUse) {
+        pthread_mutex_unlock(slotLock(socket));
+        fprintf(stderr, "Error registering socket %d: already registered\n", socket);
+        return -1;
+    }
+    slot->inUse = 1;
+    slot->flags = flags;
+    slot->callbackFunction = callback;
+    slot->eventCallback = eventCallback;
+    slot->context = context;
+    // A socket registered on a loop thread (from an accept callback) stays with the loop that accepted it
+    slot->ownerLoop = currentLoop != NULL ? currentLoop
+                                          : &eventLoops[__atomic_fetch_add(&nextLoopIndex, 1, __ATOMIC_RELAXED) % eventLoopCount];
+    slot->readyEvents = 0;
+    slot->readyData = NULL;
+    slot->readyLength = 0;
+    slot->readyBuffer = -1;
+    slot->dispatching = 0;
+    slot->inputPaused = 0;
+    slot->idleTimer = NULL; // No idle timeout until setSocketIdleTimeout asks for one
+    slot->heartbeat = NULL;
+    memset(&slot->output, 0, sizeof(slot->output));
+    slot->output.highWatermark = defaultHighWatermark;
+    slot->output.lowWatermark = defaultLowWatermark;
+    slot->output.overflowPolicy = defaultOverflowPolicy;
+    int added = armRegistration(slot, socket, EPOLL_CTL_ADD) == 0;
+    if (!added) {
+        perror("Error registering socket"); // Handle registration error
+        slot->inUse = 0;
+        slot->generation++;
+    } else {
+        metricsAdd(METRIC_REGISTRATIONS, 1);
+    }
+    pthread_mutex_unlock(slotLock(socket));
+    return added ? 0 : -1;
 }
 
 // Function to register a socket and its callback
 void registerSocket(int socket, ProactorCallback callback) {
-    // Allocate memory for a new SocketNode
-    SocketNode* newNode = (SocketNode*)malloc(sizeof(SocketNode));
-    // Initialize the new node with socket descriptor and callback
-    newNode->socketDescriptor = socket;
-    newNode->callbackFunction = callback;
-    newNode->nextNode = NULL;
-
-    // Lock the mutex to safely modify the linked list
-    pthread_mutex_lock(&socketListMutex);
-    // Insert the new node at the head of the list
-    newNode->nextNode = headNode;
-    headNode = newNode;
-    // Unlock the mutex
-    pthread_mutex_unlock(&socketListMutex);
-
-    // Create a new thread to process the socket
-    pthread_t thread;
-    if (pthread_create(&thread, NULL, processSocketThread, &newNode->socketDescriptor) != 0) {
-        perror("Error creating thread"); // Handle thread creation error
-        // Safely remove the node if thread creation fails
-        pthread_mutex_lock(&socketListMutex);
-        extractSocketNode(socket);
-        pthread_mutex_unlock(&socketListMutex);
-        close(socket); // Close the socket
-    } else {
-        pthread_detach(thread); // Detach the thread
+    if (addRegistration(socket, callback, NULL, NULL, LEGACY_REGISTRATION_FLAGS) != 0) {
+        close(socket); // The proactor owns the socket, even when it refuses it
+    }
+}
+
+// Function to register a socket with an event-info callback, a user context and registration flags
+int registerSocketWithContext(int socket, ProactorEventCallback callback, void* context, int flags) {
+    if (callback == NULL && !(flags & PROACTOR_WRITE_ONLY)) return -1;
+    return addRegistration(socket, NULL, callback, context, flags);
+}
+
+// Function to remove a registration without closing the socket
+int unregisterSocket(int socket) {
+    SocketSlot* slot = findSocketSlot(socket, 0);
+    if (slot == NULL) return -1;
+
+    pthread_mutex_lock(slotLock(socket));
+    uint32_t generation = slot->generation;
+    int registered = slot->inUse;
+    pthread_mutex_unlock(slotLock(socket));
+    if (!registered) return -1;
+    return releaseSocketSlot(socket, generation, 0) ? 0 : -1;
+}
+
+// Function to re-arm a one-shot registration after its callback ran
+int rearmSocket(int socket) {
+    SocketSlot* slot = findSocketSlot(socket, 0);
+    if (slot == NULL) return -1;
+
+    pthread_mutex_lock(slotLock(socket));
+    if (slot->inUse) slot->inputPaused = 0; // Resumes a paused registration too
+    int result = slot->inUse ? armRegistration(slot, socket, EPOLL_CTL_MOD) : -1;
+    pthread_mutex_unlock(slotLock(socket));
+    return result == 0 ? 0 : -1;
+}
+
+// Helper function to stop reading a registration and wait until a callback and, optionally, its queued output
+// are done. Called with the stripe lock held, which it gives up while waiting. Returns 0 when they are done,
+// 1 on timeout and -1 when the registration went away meanwhile.
+static int quiesceSlot(SocketSlot* slot, int socket, int waitForOutput, unsigned int timeoutMilliseconds) {
+    uint32_t generation = slot->generation;
+    if (!slot->inputPaused) {
+        slot->inputPaused = 1;
+        if (slot->readInterest) { // Not dispatched right now: take the socket out of the read set
+            slot->readInterest = 0;
+            if (watchRegistration(slot, socket, EPOLL_CTL_MOD) == -1) perror("Error pausing socket input");
+        }
+    }
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline); // The clock the stripe conditions wait on
+    deadline.tv_sec += timeoutMilliseconds / 1000;
+    deadline.tv_nsec += (long)(timeoutMilliseconds % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    int stripe = socket % REGISTRY_LOCK_STRIPES;
+    int timedOut = 0;
+    stripePausedSenders[stripe]++; // Makes the loop signal the stripe when the output drains
+    while (slot->inUse && slot->generation == generation && (slot->dispatching || (waitForOutput && slot->output.count > 0))) {
+        if (pthread_cond_timedwait(&stripeDrained[stripe], slotLock(socket), &deadline) == ETIMEDOUT) {
+            timedOut = 1;
+            break;
+        }
+    }
+    stripePausedSenders[stripe]--;
+    if (!slot->inUse || slot->generation != generation) return -1;
+    return timedOut ? 1 : 0;
+}
+
+// Function to stop reading a registration until rearmSocket
+int pauseSocketInput(int socket, unsigned int timeoutMilliseconds) {
+    SocketSlot* slot = findSocketSlot(socket, 0);
+    if (slot == NULL) return -1;
+
+    pthread_mutex_lock(slotLock(socket));
+    int result = -1;
+    if (slot->inUse && usesRing(slot->flags)) {
+        errno = EOPNOTSUPP; // A receive is always posted on the ring
+    } else if (slot->inUse) {
+        result = quiesceSlot(slot, socket, 0, timeoutMilliseconds) == 0 ? 0 : -1;
+    }
+    pthread_mutex_unlock(slotLock(socket));
+    return result;
+}
+
+// Function to remove a registration without closing its socket once its output was written
+int detachSocket(int socket, unsigned int timeoutMilliseconds) {
+    SocketSlot* slot = findSocketSlot(socket, 0);
+    if (slot == NULL) return -1;
+
+    pthread_mutex_lock(slotLock(socket));
+    if (!slot->inUse || usesRing(slot->flags)) {
+        if (slot->inUse) errno = EOPNOTSUPP;
+        pthread_mutex_unlock(slotLock(socket));
+        return -1;
+    }
+    uint32_t generation = slot->generation;
+    int result = quiesceSlot(slot, socket, 1, timeoutMilliseconds);
+    pthread_mutex_unlock(slotLock(socket));
+    if (result < 0) return -1; // The peer hung up meanwhile
+    return releaseSocketSlot(socket, generation, 0) ? result : -1; // Whatever is still queued on timeout is discarded
+}
+
+// Helper function to write byte ranges with blocking semantics, even on a non-blocking socket
+static int sendAll(int socket, const struct iovec* parts, int partCount, size_t length) {
+    size_t sent = 0; // Bytes written so far
+    while (sent < length) {
+        struct iovec vectors[PROACTOR_MESSAGE_MAX_PARTS];
+        struct msghdr header = { .msg_iov = vectors, .msg_iovlen = (size_t)remainingVectors(parts, partCount, sent, vectors) };
+        ssize_t written = sendmsg(socket, &header, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) continue; // Interrupted, try again
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                struct pollfd writable = { .fd = socket, .events = POLLOUT };
+                poll(&writable, 1, -1); // Wait for room in the send buffer
+                continue;
+            }
+            return -1; // Connection error
+        }
+        sent += (size_t)written;
+        metricsAdd(METRIC_BYTES_SENT, written);
+    }
+    return 0;
+}
+
+// Helper function to apply a registration's overflow policy before incoming bytes are queued.
+// Called with the stripe lock held, which a paused sender gives up while it waits.
+// Returns 0 when the bytes may be queued and -1 with errno set when they must not.
+static int makeRoomForOutput(SocketSlot* slot, int socket, size_t incoming) {
+    OutputQueue* queue = &slot->output;
+    if (queue->highWatermark == 0 || queue->queuedBytes + incoming <= queue->highWatermark) return 0;
+
+    switch (queue->overflowPolicy) {
+    case PROACTOR_OVERFLOW_DROP_OLDEST:
+        dropOldestOutput(queue, incoming); // Keeps the queue bounded by the watermark plus the new message
+        return 0;
+    case PROACTOR_OVERFLOW_PAUSE: {
+        if (currentLoop != NULL) return 0; // The loop draining the queue must never wait for itself
+        metricsAdd(METRIC_PAUSED_SENDS, 1);
+        uint32_t generation = slot->generation;
+        int stripe = socket % REGISTRY_LOCK_STRIPES;
+        stripePausedSenders[stripe]++;
+        while (slot->inUse && slot->generation == generation && __atomic_load_n(&proactorRunning, __ATOMIC_ACQUIRE) &&
+               queue->queuedBytes > queue->lowWatermark) {
+            pthread_cond_wait(&stripeDrained[stripe], slotLock(socket)); // The event loop drains meanwhile
+        }
+        stripePausedSenders[stripe]--;
+        if (slot->inUse && slot->generation == generation && __atomic_load_n(&proactorRunning, __ATOMIC_ACQUIRE)) return 0;
+        errno = EPIPE; // The registration went away while the sender was paused
+        return -1;
+    }
+    default:
+        metricsAdd(METRIC_SLOW_CONSUMER_DISCONNECTS, 1);
+        clearOutput(queue); // Slow consumer: give up on it
+        shutdown(socket, SHUT_RDWR); // Its reader sees the hang-up and releases the registration
+        errno = ENOBUFS;
+        return -1;
+    }
+}
+
+// Helper function to queue byte ranges on a registration whose stripe lock is held, waiting only when a paused
+// policy asks for it. The ranges are those of message when it is given; otherwise the bytes are copied into a
+// new message if they cannot be written at once. Returns 0 on success and -1 on failure.
+static int queueOutputLocked(SocketSlot* slot, int socket, const struct iovec* parts, int partCount, size_t length,
+                             ProactorMessage* message) {
+    OutputQueue* queue = &slot->output;
+
+    size_t sent = 0; // Bytes the kernel took right away
+    if (completionBackend == PROACTOR_BACKEND_EPOLL && queue->count == 0) {
+        // Nothing is queued ahead of these bytes, so try to write them without waiting for the loop
+        while (sent < length) {
+            struct iovec vectors[PROACTOR_MESSAGE_MAX_PARTS];
+            struct msghdr header = { .msg_iov = vectors, .msg_iovlen = (size_t)remainingVectors(parts, partCount, sent, vectors) };
+            ssize_t written = sendmsg(socket, &header, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EINTR) continue; // Interrupted, try again
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break; // Full: queue the rest
+                return -1; // Connection error
+            }
+            sent += (size_t)written;
+        }
+        metricsAdd(METRIC_BYTES_SENT, (int64_t)sent);
+        if (sent == length) {
+            metricsAdd(METRIC_MESSAGES_SENT, 1);
+            return 0;
+        }
+    }
+
+    SendRequest* request = NULL;
+    if (makeRoomForOutput(slot, socket, length - sent) == 0) {
+        request = (SendRequest*)memoryPoolAlloc(sizeof(SendRequest));
+    }
+    if (request != NULL) {
+        request->socket = socket;
+        request->generation = slot->generation;
+        request->offset = 0;
+        if (message != NULL) {
+            request->message = retainProactorMessage(message); // Shared with every other queue it was sent to
+            request->offset = sent;
+        } else {
+            // Copy only the unsent bytes; the caller may reuse its buffer as soon as we return
+            struct iovec vectors[PROACTOR_MESSAGE_MAX_PARTS];
+            request->message = createProactorMessage(vectors, remainingVectors(parts, partCount, sent, vectors));
+        }
+    }
+    if (request == NULL || request->message == NULL || pushOutput(queue, request) != 0) {
+        if (request != NULL && request->message != NULL) releaseProactorMessage(request->message);
+        memoryPoolFree(request);
+        return -1;
+    }
+    if (completionBackend == PROACTOR_BACKEND_EPOLL) {
+        // The first queued request makes the loop watch for EPOLLOUT; later ones find it already watching
+        if (queue->count == 1 && watchRegistration(slot, socket, EPOLL_CTL_MOD) == -1) {
+            perror("Error watching socket for output");
+        }
+    } else if (!queue->headInFlight) {
+        queue->headInFlight = 1; // One send in flight per socket keeps the bytes in order
+        queueRingSend(slot->ownerLoop, outputHead(queue));
+    }
+    metricsAdd(METRIC_MESSAGES_SENT, 1);
+    return 0;
+}
+
+// Helper function to queue byte ranges on a socket's registration, as queueOutputLocked does.
+// Returns 0 on success, -1 on failure and 1 when the socket is not registered.
+static int queueOutput(int socket, const struct iovec* parts, int partCount, size_t length, ProactorMessage* message) {
+    SocketSlot* slot = findSocketSlot(socket, 0);
+    if (slot == NULL) return 1; // Never registered
+
+    pthread_mutex_lock(slotLock(socket));
+    if (!slot->inUse) {
+        pthread_mutex_unlock(slotLock(socket));
+        return 1; // Not registered: nothing would write the queued bytes
+    }
+    int result = queueOutputLocked(slot, socket, parts, partCount, length, message);
+    pthread_mutex_unlock(slotLock(socket));
+    return result;
+}
+
+// Helper function to queue a message on a registered socket without ever writing it in place.
+// Used by broadcastGroup.c. Returns 0 on success, -1 on failure and 1 when the socket is not registered.
+int proactorSendMessageRegistered(int socket, ProactorMessage* message) {
+    if (message->length == 0) return 0;
+    return queueOutput(socket, message->parts, message->partCount, message->length, message);
+}
+
+// Function to set the output limits of later registrations
+void setDefaultOutputLimits(size_t highWatermark, size_t lowWatermark, int overflowPolicy) {
+    defaultHighWatermark = highWatermark;
+    defaultLowWatermark = lowWatermark < highWatermark ? lowWatermark : highWatermark;
+    defaultOverflowPolicy = overflowPolicy;
+}
+
+// Function to change the output limits of one registration
+int setSocketOutputLimits(int socket, size_t highWatermark, size_t lowWatermark, int overflowPolicy) {
+    SocketSlot* slot = findSocketSlot(socket, 0);
+    if (slot == NULL) return -1;
+
+    pthread_mutex_lock(slotLock(socket));
+    int registered = slot->inUse;
+    if (registered) {
+        slot->output.highWatermark = highWatermark;
+        slot->output.lowWatermark = lowWatermark < highWatermark ? lowWatermark : highWatermark;
+        slot->output.overflowPolicy = overflowPolicy;
+        notifyDrained(&slot->output, socket); // A raised low watermark may release paused senders
+    }
+    pthread_mutex_unlock(slotLock(socket));
+    return registered ? 0 : -1;
+}
+
+// Function to report how many bytes a registration still has to write
+size_t queuedOutputBytes(int socket) {
+    SocketSlot* slot = findSocketSlot(socket, 0);
+    if (slot == NULL) return 0;
+
+    pthread_mutex_lock(slotLock(socket));
+    size_t queued = slot->inUse ? slot->output.queuedBytes : 0;
+    pthread_mutex_unlock(slotLock(socket));
+    return queued;
+}
+
+// Timer callback checking a registration for silence on its loop thread: it queues the heartbeat once the
+// peer was quiet for the heartbeat interval and shuts the connection down once it was quiet for the timeout
+static void checkIdleSocket(void* arg) {
+    uint64_t key = (uint64_t)(uintptr_t)arg; // Registration the timer was set up for
+    int socket = (int)(uint32_t)key;
+    SocketSlot* slot = findSocketSlot(socket, 0);
+    if (slot == NULL) return;
+
+    pthread_mutex_lock(slotLock(socket));
+    if (!slot->inUse || slot->generation != (uint32_t)(key >> 32) || slot->idleTimer == NULL) {
+        pthread_mutex_unlock(slotLock(socket));
+        return; // Released meanwhile; the release destroyed the timer
+    }
+    uint64_t now = currentMilliseconds();
+    uint64_t lastInput = __atomic_load_n(&slot->lastInput, __ATOMIC_RELAXED);
+    uint64_t deadline = lastInput + slot->idleTimeout;
+    if (now >= deadline) {
+        metricsAdd(METRIC_IDLE_TIMEOUTS, 1);
+        clearOutput(&slot->output); // Nobody is reading it any more
+        shutdown(socket, SHUT_RDWR); // Its reader sees the hang-up and releases the registration
+        pthread_mutex_unlock(slotLock(socket));
+        return;
+    }
+    if (slot->heartbeat != NULL) {
+        uint64_t quietSince = lastInput > slot->lastHeartbeat ? lastInput : slot->lastHeartbeat;
+        if (now >= quietSince + slot->heartbeatInterval) {
+            ProactorMessage* heartbeat = slot->heartbeat;
+            if (queueOutputLocked(slot, socket, heartbeat->parts, heartbeat->partCount, heartbeat->length, heartbeat) == 0) {
+                metricsAdd(METRIC_HEARTBEATS, 1);
+            }
+            slot->lastHeartbeat = now;
+            quietSince = now;
+        }
+        if (quietSince + slot->heartbeatInterval < deadline) deadline = quietSince + slot->heartbeatInterval;
+    }
+    startProactorTimer(slot->idleTimer, (unsigned int)(deadline - now)); // Input meanwhile only moves the deadline later
+    pthread_mutex_unlock(slotLock(socket));
+}
+
+// Function to set up, change or remove the idle timeout and heartbeat of a registration
+int setSocketIdleTimeout(int socket, unsigned int timeoutMilliseconds, unsigned int heartbeatMilliseconds, ProactorMessage* heartbeat) {
+    SocketSlot* slot = findSocketSlot(socket, 0);
+    if (slot == NULL) return -1;
+
+    pthread_mutex_lock(slotLock(socket));
+    if (!slot->inUse) {
+        pthread_mutex_unlock(slotLock(socket));
+        return -1;
+    }
+    if (timeoutMilliseconds == 0) {
+        dropIdleTimeout(slot);
+        pthread_mutex_unlock(slotLock(socket));
+        return 0;
+    }
+    if (slot->idleTimer == NULL) {
+        slot->idleTimer = createLoopTimer(slot->ownerLoop, checkIdleSocket, (void*)(uintptr_t)registrationKey(socket, slot->generation));
+        if (slot->idleTimer == NULL) {
+            pthread_mutex_unlock(slotLock(socket));
+            return -1;
+        }
+    }
+    ProactorMessage* previous = slot->heartbeat; // Released after the new one is retained, as it may be the same message
+    slot->heartbeat = heartbeatMilliseconds > 0 && heartbeat != NULL ? retainProactorMessage(heartbeat) : NULL;
+    releaseProactorMessage(previous);
+    slot->idleTimeout = timeoutMilliseconds;
+    slot->heartbeatInterval = heartbeatMilliseconds;
+    uint64_t now = currentMilliseconds();
+    __atomic_store_n(&slot->lastInput, now, __ATOMIC_RELAXED); // The silence is counted from now
+    slot->lastHeartbeat = now;
+    unsigned int first = slot->heartbeat != NULL && heartbeatMilliseconds < timeoutMilliseconds ? heartbeatMilliseconds : timeoutMilliseconds;
+    startProactorTimer(slot->idleTimer, first);
+    pthread_mutex_unlock(slotLock(socket));
+    return 0;
+}
+
+// Function to record input a caller read itself from a registered socket, postponing its idle timeout
+void markSocketActive(int socket) {
+    SocketSlot* slot = findSocketSlot(socket, 0);
+    if (slot == NULL) return;
+    // One relaxed store and no lock: the idle check only ever reads it, and a lost race delays it by one round
+    __atomic_store_n(&slot->lastInput, currentMilliseconds(), __ATOMIC_RELAXED);
+}
+
+// Function to send data on a socket through the active backend
+int proactorSend(int socket, const void* data, size_t length) {
+    if (length == 0) return 0;
+    struct iovec part = { .iov_base = (void*)data, .iov_len = length };
+    int result = queueOutput(socket, &part, 1, length, NULL);
+    return result == 1 ? sendAll(socket, &part, 1, length) : result; // Unregistered sockets are written in place
+}
+
+// Function to send a shared message on a socket
+int proactorSendMessage(int socket, ProactorMessage* message) {
+    if (message->length == 0) return 0;
+    int result = queueOutput(socket, message->parts, message->partCount, message->length, message);
+    return result == 1 ? sendAll(socket, message->parts, message->partCount, message->length) : result;
+}
+
+// Function to create a message from byte ranges copied once
+ProactorMessage* createProactorMessage(const struct iovec* parts, int partCount) {
+    if (partCount < 0 || partCount > PROACTOR_MESSAGE_MAX_PARTS) return NULL;
+    size_t length = 0;
+    for (int i = 0; i < partCount; i++) length += parts[i].iov_len;
+
+    ProactorMessage* message = (ProactorMessage*)memoryPoolAlloc(sizeof(ProactorMessage) + length); // Pooled: one or more per broadcast
+    if (message == NULL) return NULL;
+    message->references = 1; // Owned by the creator
+    message->partCount = partCount;
+    message->length = length;
+    message->payload = NULL;
+    char* storage = message->data;
+    for (int i = 0; i < partCount; i++) {
+        memcpy(storage, parts[i].iov_base, parts[i].iov_len); // Keep the range boundaries for sendmsg
+        message->parts[i].iov_base = storage;
+        message->parts[i].iov_len = parts[i].iov_len;
+        storage += parts[i].iov_len;
+    }
+    return message;
+}
+
+// Function to create a message that prefixes a shared payload with its own header
+ProactorMessage* createFramedProactorMessage(const void* header, size_t headerLength, ProactorMessage* payload) {
+    if (payload->partCount + 1 > PROACTOR_MESSAGE_MAX_PARTS) return NULL;
+    ProactorMessage* message = (ProactorMessage*)memoryPoolAlloc(sizeof(ProactorMessage) + headerLength);
+    if (message == NULL) return NULL;
+    message->references = 1;
+    message->partCount = payload->partCount + 1;
+    message->length = headerLength + payload->length;
+    message->payload = retainProactorMessage(payload); // The payload's bytes are referenced, not copied
+    memcpy(message->data, header, headerLength);
+    message->parts[0].iov_base = message->data;
+    message->parts[0].iov_len = headerLength;
+    memcpy(&message->parts[1], payload->parts, payload->partCount * sizeof(struct iovec));
+    return message;
+}
+
+// Function to take another reference to a message
+ProactorMessage* retainProactorMessage(ProactorMessage* message) {
+    __atomic_add_fetch(&message->references, 1, __ATOMIC_RELAXED);
+    return message;
+}
+
+// Function to drop a reference to a message, freeing it with the last one
+void releaseProactorMessage(ProactorMessage* message) {
+    if (message == NULL) return;
+    if (__atomic_sub_fetch(&message->references, 1, __ATOMIC_ACQ_REL) != 0) return;
+    releaseProactorMessage(message->payload); // A framed message lets go of the payload it shares
+    memoryPoolFree(message);
+}
+
+// Function to report the length of a message
+size_t proactorMessageLength(const ProactorMessage* message) {
+    return message->length;
+}
+
+// Helper function to open the non-blocking SO_REUSEPORT listener of one loop; returns it or -1
+static int openLoopListener(int port) {
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listener == -1) return -1;
+    int enable = 1;
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_ANY), .sin_port = htons(port) };
+    if (setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) < 0 ||
+        setsockopt(listener, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0 ||
+        bind(listener, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listener, SOMAXCONN) < 0) {
+        int savedErrno = errno;
+        close(listener);
+        errno = savedErrno;
+        return -1;
+    }
+    return listener;
+}
+
+// Function to give every event loop its own listener on a port
+int proactorListen(int port, ProactorAcceptCallback callback, void* context) {
+    if (!proactorRunning || callback == NULL || eventLoops[0].listenDescriptor != -1) return -1;
+    // Open every listener before any loop sees one: the loops are running, so a listener handed to a loop
+    // could not be closed again without racing its accepts
+    int* listeners = (int*)malloc(eventLoopCount * sizeof(int));
+    if (listeners == NULL) return -1;
+    for (int i = 0; i < eventLoopCount; i++) {
+        listeners[i] = openLoopListener(port);
+        if (listeners[i] == -1) {
+            perror("Error opening listener");
+            while (--i >= 0) close(listeners[i]); // Close the listeners opened so far
+            free(listeners);
+            return -1;
+        }
+    }
+    for (int i = 0; i < eventLoopCount; i++) {
+        EventLoop* loop = &eventLoops[i];
+        loop->listenDescriptor = listeners[i];
+        loop->acceptCallback = callback;
+        loop->acceptContext = context;
+        // Level-triggered: a loop that stops after ACCEPT_BATCH connections is told again about the rest
+        struct epoll_event listenEvent = { .events = EPOLLIN, .data.u64 = LISTEN_EVENT_KEY };
+        epoll_ctl(loop->epollDescriptor, EPOLL_CTL_ADD, loop->listenDescriptor, &listenEvent);
+    }
+    free(listeners);
+    return 0;
+}
+
+// Structure tracking the loops that still have to reach a barrier posted to every loop
+typedef struct LoopBarrier {
+    pthread_mutex_t mutex;  // Guards remaining
+    pthread_cond_t done;    // Signalled when remaining reaches 0
+    int remaining;          // Loops that did not run the barrier yet
+    void (*action)(EventLoop* loop); // Run by every loop when it reaches the barrier, or NULL
+} LoopBarrier;
+
+// Helper task run by every loop when it reaches a barrier
+static void passLoopBarrier(void* argument) {
+    LoopBarrier* barrier = (LoopBarrier*)argument;
+    if (barrier->action != NULL) barrier->action(currentLoop);
+    pthread_mutex_lock(&barrier->mutex);
+    if (--barrier->remaining == 0) pthread_cond_signal(&barrier->done);
+    pthread_mutex_unlock(&barrier->mutex);
+}
+
+// Helper function to post a barrier to every loop and wait until all of them ran it; -1 from a loop thread
+static int runLoopBarrier(void (*action)(EventLoop* loop)) {
+    if (!__atomic_load_n(&proactorRunning, __ATOMIC_ACQUIRE) || currentLoop != NULL) return -1; // A loop would wait for itself
+    LoopBarrier barrier = { .mutex = PTHREAD_MUTEX_INITIALIZER, .done = PTHREAD_COND_INITIALIZER, .remaining = 0, .action = action };
+    pthread_mutex_lock(&barrier.mutex);
+    for (int i = 0; i < eventLoopCount; i++) {
+        if (proactorPost(i, passLoopBarrier, &barrier) == 0) barrier.remaining++; // Runs after everything posted before it
+    }
+    while (barrier.remaining > 0) pthread_cond_wait(&barrier.done, &barrier.mutex);
+    pthread_mutex_unlock(&barrier.mutex);
+    return 0;
+}
+
+// Helper function closing the listener of a loop, after accepting what its backlog still holds
+static void closeLoopListener(EventLoop* loop) {
+    while (loop->listenDescriptor != -1) {
+        int client = accept(loop->listenDescriptor, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            epoll_ctl(loop->epollDescriptor, EPOLL_CTL_DEL, loop->listenDescriptor, NULL);
+            close(loop->listenDescriptor); // Connections that arrive from now on go to the other listeners on the port
+            loop->listenDescriptor = -1;
+            break;
+        }
+        metricsAdd(METRIC_ACCEPTED, 1);
+        loop->acceptCallback(client, loop->acceptContext);
+    }
+}
+
+// Function to close the listeners opened by proactorListen
+int proactorStopListening() {
+    return runLoopBarrier(closeLoopListener); // Closed on the loop threads, between two accepts
+}
+
+// Function to wait until every loop ran the tasks posted to it so far
+int proactorSync() {
+    return runLoopBarrier(NULL);
+}
+
+// Function to report the number of event loops
+int proactorLoopCount() {
+    return eventLoopCount;
+}
+
+// Function to report the event loop run by the calling thread
+int proactorCurrentLoop() {
+    return currentLoop != NULL ? (int)(currentLoop - eventLoops) : -1;
+}
+
+// Function to report the event loop a socket is registered with
+int proactorSocketLoop(int socket) {
+    SocketSlot* slot = findSocketSlot(socket, 0);
+    if (slot == NULL) return -1;
+    pthread_mutex_lock(slotLock(socket));
+    int loop = slot->inUse ? (int)(slot->ownerLoop - eventLoops) : -1;
+    pthread_mutex_unlock(slotLock(socket));
+    return loop;
+}
+
+// Function to queue a task in an event loop's inbox
+int proactorPost(int loop, ProactorTask task, void* argument) {
+    if (!__atomic_load_n(&proactorRunning, __ATOMIC_ACQUIRE) || loop < 0 || loop >= eventLoopCount || task == NULL) return -1;
+    LoopTask* entry = (LoopTask*)memoryPoolAlloc(sizeof(LoopTask));
+    if (entry == NULL) return -1;
+    entry->task = task;
+    entry->argument = argument;
+    metricsAdd(METRIC_TASKS_POSTED, 1); // Counted first, so the inbox depth never goes negative
+    mpscQueuePush(&eventLoops[loop].inbox, &entry->node); // Lock-free; wakes the loop unless a wake-up is already pending
+    return 0;
+}
+
+// Function to create a timer whose callback runs on an event loop's thread
+ProactorTimer* createProactorTimer(int loop, ProactorTimerCallback callback, void* argument) {
+    if (!__atomic_load_n(&proactorRunning, __ATOMIC_ACQUIRE) || callback == NULL) return NULL;
+    if (loop < 0) loop = currentLoop != NULL ? (int)(currentLoop - eventLoops) : 0; // Default to the caller's own loop
+    if (loop >= eventLoopCount) return NULL;
+    return createLoopTimer(&eventLoops[loop], callback, argument);
+}
+
+// Function to (re)schedule a timer to fire once after the given number of milliseconds
+int startProactorTimer(ProactorTimer* timer, unsigned int milliseconds) {
+    if (timer == NULL) return -1;
+    EventLoop* loop = timer->loop;
+    uint64_t expiry = currentMilliseconds() + milliseconds;
+    pthread_mutex_lock(&loop->timerMutex);
+    timerWheelRemove(&loop->timers, &timer->node); // O(1) whether it was pending or not
+    timerWheelAdd(&loop->timers, &timer->node, expiry);
+    int wake = expiry < loop->wakeTime && currentLoop != loop; // The loop sleeps past the new expiry
+    pthread_mutex_unlock(&loop->timerMutex);
+    if (wake) {
+        uint64_t one = 1;
+        if (write(loop->wakeDescriptor, &one, sizeof(one)) < 0) perror("Error waking event loop");
+    }
+    return 0;
+}
+
+// Function to cancel a pending timer
+int stopProactorTimer(ProactorTimer* timer) {
+    if (timer == NULL) return 0;
+    pthread_mutex_lock(&timer->loop->timerMutex);
+    int pending = timerWheelLinked(&timer->node);
+    timerWheelRemove(&timer->loop->timers, &timer->node);
+    pthread_mutex_unlock(&timer->loop->timerMutex);
+    return pending;
+}
+
+// Function to cancel and free a timer
+void destroyProactorTimer(ProactorTimer* timer) {
+    if (timer == NULL) return;
+    pthread_mutex_lock(&timer->loop->timerMutex);
+    timerWheelRemove(&timer->loop->timers, &timer->node);
+    int firing = timer->firing;
+    if (firing) timer->destroyed = 1; // The loop frees it once the callback returns
+    pthread_mutex_unlock(&timer->loop->timerMutex);
+    if (!firing) memoryPoolFree(timer);
+}
+
+// Function to add up the output queues of every registration for a metrics snapshot
+void collectOutputQueueMetrics(size_t* queuedBytes, size_t* largestQueue, int* largestSocket, int* overWatermark) {
+    if (!__atomic_load_n(&proactorRunning, __ATOMIC_ACQUIRE)) return;
+    for (int chunk = 0; chunk < slotChunkCount; chunk++) {
+        SocketSlot* slots = __atomic_load_n(&slotChunks[chunk], __ATOMIC_ACQUIRE);
+        if (slots == NULL) continue;
+        for (int i = 0; i < REGISTRY_CHUNK_SLOTS; i++) {
+            int socket = chunk * REGISTRY_CHUNK_SLOTS + i;
+            pthread_mutex_lock(slotLock(socket)); // One stripe at a time, never blocking the loops for long
+            if (slots[i].inUse) {
+                const OutputQueue* queue = &slots[i].output;
+                *queuedBytes += queue->queuedBytes;
+                if (queue->queuedBytes > *largestQueue) {
+                    *largestQueue = queue->queuedBytes;
+                    *largestSocket = socket;
+                }
+                if (queue->highWatermark > 0 && queue->queuedBytes > queue->highWatermark) (*overWatermark)++;
+            }
+            pthread_mutex_unlock(slotLock(socket));
+        }
     }
 }
@@ -1,16 +1,265 @@
 #ifndef PROACTOR_H
 #define PROACTOR_H
 
-// Callback function type for handling socket operations
+#include <stddef.h>  // For size_t
+#include <sys/uio.h> // For struct iovec
+
+// Library version. The major number is the shared library's soname (libproactor.so.MAJOR) and only
+// changes when an existing declaration below changes; new functions, flags and trailing fields of
+// library-allocated structures bump the minor number.
+#define PROACTOR_VERSION_MAJOR 1
+#define PROACTOR_VERSION_MINOR 12
+#define PROACTOR_VERSION_PATCH 0
+#define PROACTOR_VERSION (PROACTOR_VERSION_MAJOR * 10000 + PROACTOR_VERSION_MINOR * 100 + PROACTOR_VERSION_PATCH)
+
+// Marks the functions exported by the shared library; everything else is built hidden
+#define PROACTOR_API __attribute__((visibility("default")))
+
+// Buffer ownership rules:
+//  - ProactorEventInfo and its data belong to the proactor. They are valid only until the callback
+//    returns, so a callback that needs the bytes later must copy them.
+//  - proactorSend never keeps the caller's pointer: the bytes are copied or written before it returns.
+//  - A ProactorMessage is immutable and reference counted. Every queue it is sent to holds its own
+//    reference, so the creator may release it right after the last proactorSendMessage.
+//  - The context pointer is never dereferenced by the proactor; the caller frees it after the
+//    registration is gone (after unregisterSocket, or in the hang-up callback).
+
+// Callback function type for handling socket operations.
+// The callback runs on a pool worker every time the socket becomes readable, never twice
+// at once for the same socket, so it should consume the available data and return.
 typedef void (*ProactorCallback)(int);
 
-// Initializes the proactor system
-void initializeProactor();
+// Registration flags for registerSocketWithContext
+#define PROACTOR_PERSISTENT      0x0 // Re-armed automatically after every callback (default)
+#define PROACTOR_ONESHOT         0x1 // Disarmed after one callback until rearmSocket() is called
+#define PROACTOR_EDGE_TRIGGERED  0x2 // Socket is made non-blocking; the callback must read until EAGAIN
+#define PROACTOR_CLOSE_ON_HANGUP 0x4 // The proactor closes the socket after the hang-up callback
+#define PROACTOR_COMPLETION      0x8 // The proactor reads the socket and passes the bytes in ProactorEventInfo.data
+#define PROACTOR_WRITE_ONLY      0x10 // Only proactorSend output is handled; the socket is never read (callback may be NULL)
+
+// Event bits reported in ProactorEventInfo.events
+#define PROACTOR_EVENT_READ   0x1 // Data (or end of stream) is available
+#define PROACTOR_EVENT_HANGUP 0x2 // The peer hung up and everything it sent was consumed
+#define PROACTOR_EVENT_ERROR  0x4 // The socket reported an error
+
+// Overflow policies, applied when a registered socket's unsent output would pass its high watermark
+#define PROACTOR_OVERFLOW_DISCONNECT  0 // Drop the queued output and shut the connection down (default)
+#define PROACTOR_OVERFLOW_DROP_OLDEST 1 // Discard the oldest queued messages the kernel has not started on
+#define PROACTOR_OVERFLOW_PAUSE       2 // Block the sending thread until the queue drains to the low watermark
+
+// Backends completing PROACTOR_COMPLETION reads and proactorSend writes
+#define PROACTOR_BACKEND_EPOLL    0 // Readiness from epoll, the read or write is done by the proactor (default)
+#define PROACTOR_BACKEND_IO_URING 1 // Reads and writes are submitted to io_uring in batches
+
+// Structure for callback arguments
+// Allocated by the proactor, so fields may only ever be appended to it.
+typedef struct {
+    int socket;          // Socket the event refers to
+    void *data;          // Completed read (PROACTOR_COMPLETION only), valid until the callback returns
+    size_t data_len;     // Length of the data
+    void *context;       // User context given when the socket was registered
+    unsigned int events; // PROACTOR_EVENT_* bits describing what happened
+} ProactorEventInfo;
+
+// Callback function type for registrations made with registerSocketWithContext
+typedef void (*ProactorEventCallback)(ProactorEventInfo*);
+
+// Sizing of the proactor; a field left at 0 selects its default.
+// Callers allocate it, so its layout is frozen for the whole major version.
+typedef struct {
+    int eventLoops;    // Number of epoll loops demultiplexing the sockets (default 1)
+    int workerThreads; // Number of workers running the callbacks (default one per online core)
+    int backend;       // PROACTOR_BACKEND_*; io_uring falls back to epoll when the kernel refuses it
+} ProactorConfig;
+
+// Returns the PROACTOR_VERSION the library was built as, to check it against the header in use
+PROACTOR_API int proactorVersion();
+
+// Initializes the proactor system with the default configuration
+PROACTOR_API void initializeProactor();
+
+// Initializes the proactor system with the given configuration (NULL means defaults)
+PROACTOR_API void initializeProactorWithConfig(const ProactorConfig* config);
+
+// Returns the PROACTOR_BACKEND_* actually in use after initialization
+PROACTOR_API int proactorBackend();
+
+// Stops the event loops and closes every socket still registered
+PROACTOR_API void cleanupProactor();
+
+// Registers a socket and its associated callback function.
+// The proactor owns the socket and closes it once the peer hangs up.
+PROACTOR_API void registerSocket(int socket, ProactorCallback callback);
+
+// Registers a socket with an event-info callback, a user context and PROACTOR_* flags.
+// Unless PROACTOR_CLOSE_ON_HANGUP is given the caller keeps owning the socket: on hang-up the
+// registration is removed before the final callback, which may then close the socket.
+// Returns 0 on success and -1 on failure.
+PROACTOR_API int registerSocketWithContext(int socket, ProactorEventCallback callback, void* context, int flags);
+
+// Removes a registration without closing the socket; a callback already running may still finish.
+// Safe to call from inside the socket's own callback. Returns 0 on success and -1 if not registered.
+PROACTOR_API int unregisterSocket(int socket);
+
+// Re-arms a PROACTOR_ONESHOT registration so its callback runs on the next readable event, and resumes
+// reading a socket paused with pauseSocketInput. Returns 0 on success and -1 if the socket is not registered.
+PROACTOR_API int rearmSocket(int socket);
+
+// Stops reading a registered socket while its queued output keeps being written. Waits up to
+// timeoutMilliseconds for a callback already queued or running, so no callback runs once it returns;
+// it must not be called from the socket's own callback. Unread input stays in the socket.
+// Returns 0 on success and -1 on failure (not registered, timed out, or a PROACTOR_COMPLETION
+// registration on the io_uring backend, errno EOPNOTSUPP).
+PROACTOR_API int pauseSocketInput(int socket, unsigned int timeoutMilliseconds);
+
+// Pauses the input of a registered socket, waits up to timeoutMilliseconds for its queued output to be
+// written and removes the registration without closing the socket, even with PROACTOR_CLOSE_ON_HANGUP:
+// the socket can then be closed without losing output or handed to another process with its unread
+// input intact. Returns 0 when everything was written, 1 when the timeout discarded unsent output and
+// -1 on failure (not registered or hung up meanwhile, or io_uring completion as above).
+PROACTOR_API int detachSocket(int socket, unsigned int timeoutMilliseconds);
+
+// Sends data on a socket. For a registered socket the bytes are copied into its bounded output queue:
+// with io_uring they are submitted asynchronously, with epoll what the kernel does not take at once
+// is written by the socket's event loop once it is writable. Bytes are sent in call order; unsent ones
+// are discarded when the registration goes away. Only PROACTOR_OVERFLOW_PAUSE makes the call wait.
+// An unregistered socket is written with blocking semantics. Returns 0 on success and -1 on failure
+// (errno ENOBUFS after a slow-consumer disconnect).
+PROACTOR_API int proactorSend(int socket, const void* data, size_t length);
+
+// Shared message: bytes copied once and queued by reference on any number of sockets
+typedef struct ProactorMessage ProactorMessage;
+
+// Largest number of byte ranges a message is made of
+#define PROACTOR_MESSAGE_MAX_PARTS 4
+
+// Creates a message from partCount byte ranges (at most PROACTOR_MESSAGE_MAX_PARTS), copied once and
+// kept as separate ranges so a header and its payload are written together without being joined.
+// The caller owns the returned reference. Returns NULL when out of memory or given too many ranges.
+PROACTOR_API ProactorMessage* createProactorMessage(const struct iovec* parts, int partCount);
+
+// Creates a message made of a copied header followed by the ranges of payload, which are shared
+// rather than copied, so one payload can go out with several framings. Returns NULL on failure.
+PROACTOR_API ProactorMessage* createFramedProactorMessage(const void* header, size_t headerLength, ProactorMessage* payload);
+
+// Takes another reference to a message and returns it
+PROACTOR_API ProactorMessage* retainProactorMessage(ProactorMessage* message);
+
+// Drops a reference, freeing the message with the last one (NULL is ignored)
+PROACTOR_API void releaseProactorMessage(ProactorMessage* message);
+
+// Returns the total number of bytes in a message
+PROACTOR_API size_t proactorMessageLength(const ProactorMessage* message);
+
+// Sends a message like proactorSend, but queues a reference to it instead of copying its bytes.
+// Returns 0 on success and -1 on failure.
+PROACTOR_API int proactorSendMessage(int socket, ProactorMessage* message);
+
+// Sets the output limits of registrations made from now on (default 256 KiB / 64 KiB, disconnect).
+// A high watermark of 0 leaves the output queues unbounded.
+PROACTOR_API void setDefaultOutputLimits(size_t highWatermark, size_t lowWatermark, int overflowPolicy);
+
+// Changes the output limits of a registered socket. Returns 0 on success and -1 if it is not registered.
+PROACTOR_API int setSocketOutputLimits(int socket, size_t highWatermark, size_t lowWatermark, int overflowPolicy);
+
+// Returns the number of bytes queued for a registered socket that the kernel has not taken yet
+PROACTOR_API size_t queuedOutputBytes(int socket);
+
+// Multi-reactor mode: every event loop is a reactor with its own listener, epoll instance and inbox.
+
+// Called on the event loop that accepted a connection, with the new (blocking) socket. Registrations
+// made from it stay on that loop, so a connection is served by the reactor that accepted it.
+// It runs on the loop thread and should only register the socket or hand it to another thread.
+typedef void (*ProactorAcceptCallback)(int socket, void* context);
+
+// Task run on an event loop's thread
+typedef void (*ProactorTask)(void* argument);
+
+// Opens one SO_REUSEPORT listener on port for every event loop, each watched by its own loop, so the
+// kernel spreads incoming connections over the loops and they accept in parallel. Can be called once
+// after initialization. Returns 0 on success and -1 on failure (no listener is left open).
+PROACTOR_API int proactorListen(int port, ProactorAcceptCallback callback, void* context);
+
+// Stops accepting: every loop accepts what its listener's backlog holds, running the accept callback
+// as usual, and closes it. Returns once all of them are closed, so no accept callback runs afterwards;
+// it must not be called from an event loop thread. A connection that reaches a listener between its
+// last accept and its close is reset by the kernel. Returns 0 on success and -1 on failure.
+PROACTOR_API int proactorStopListening();
+
+// Returns the number of event loops
+PROACTOR_API int proactorLoopCount();
+
+// Returns the index of the event loop run by the calling thread, or -1 when it is not a loop thread
+PROACTOR_API int proactorCurrentLoop();
+
+// Returns the index of the event loop a registered socket belongs to, or -1 if it is not registered
+PROACTOR_API int proactorSocketLoop(int socket);
+
+// Queues a task in an event loop's inbox; the loop runs it on its own thread, in posting order.
+// Returns 0 on success and -1 if the loop does not exist, the proactor is stopping or memory runs out.
+PROACTOR_API int proactorPost(int loop, ProactorTask task, void* argument);
+
+// Waits until every event loop ran the tasks posted to it before the call, broadcasts handed to other
+// loops included, so their output is queued. Must not be called from an event loop thread.
+// Returns 0 on success and -1 on failure.
+PROACTOR_API int proactorSync();
+
+// Timers, kept on a hierarchical timing wheel per event loop with millisecond ticks: starting,
+// restarting and stopping one is O(1) however many are pending, and a loop only wakes up when
+// the next one is due.
+
+// One-shot timer; restart it from its callback to make it periodic
+typedef struct ProactorTimer ProactorTimer;
+
+// Function run on the timer's event loop thread when it expires; it should not block
+typedef void (*ProactorTimerCallback)(void* argument);
+
+// Creates a stopped timer run by event loop loop (-1 for the calling loop thread, or loop 0 elsewhere).
+// Returns NULL on failure.
+PROACTOR_API ProactorTimer* createProactorTimer(int loop, ProactorTimerCallback callback, void* argument);
+
+// Schedules a timer to fire once after milliseconds, replacing its previous schedule. Safe from any
+// thread, including the timer's own callback. Returns 0 on success and -1 on failure.
+PROACTOR_API int startProactorTimer(ProactorTimer* timer, unsigned int milliseconds);
+
+// Cancels a timer; returns 1 if it was pending and 0 otherwise. A callback already running still finishes.
+PROACTOR_API int stopProactorTimer(ProactorTimer* timer);
+
+// Cancels and frees a timer; it may be called from the timer's own callback. Every timer must be
+// destroyed before cleanupProactor.
+PROACTOR_API void destroyProactorTimer(ProactorTimer* timer);
+
+// Idle timeouts: once a registered socket has received nothing for heartbeatMilliseconds, the
+// heartbeat message (if not NULL) is queued on it, and again after every further interval of
+// silence; once it has received nothing for timeoutMilliseconds it is shut down, so its reader sees
+// the hang-up and the registration goes away as usual. Input read by the proactor (or reported with
+// markSocketActive) resets both. A timeout of 0 removes the idle timeout. The registration keeps its
+// own reference to heartbeat. Returns 0 on success and -1 if the socket is not registered.
+PROACTOR_API int setSocketIdleTimeout(int socket, unsigned int timeoutMilliseconds, unsigned int heartbeatMilliseconds,
+                                      ProactorMessage* heartbeat);
+
+// Reports input the caller read itself from a registered socket (e.g. one registered PROACTOR_WRITE_ONLY),
+// postponing its idle timeout. Lock-free, cheap enough to call after every read.
+PROACTOR_API void markSocketActive(int socket);
+
+// Runtime metrics. Counters and latency histograms are kept per thread without locks and added up
+// on demand, in the Prometheus text format: connections, callbacks, bytes and messages in and out,
+// slow-consumer actions, inbox and output queue depths, callback and event loop iteration times.
+
+// Writes the current metrics into buffer, NUL-terminated when capacity is not 0. Returns the full
+// length like snprintf, so a result of capacity or more means the text was cut short.
+PROACTOR_API size_t proactorMetricsText(char* buffer, size_t capacity);
+
+// Serves the metrics on a Unix domain socket at path (replacing a stale one): every connection gets
+// one snapshot and is closed, e.g. with "nc -U path". Runs on its own thread, so it keeps answering
+// while the event loops stall. Stopped by cleanupProactor. Returns 0 on success and -1 on failure.
+PROACTOR_API int proactorStartAdmin(const char* path);
 
-// Cleans up resources used by the proactor system
-void cleanupProactor();
+// Registers an application counter reported with the proactor's metrics under name, a gauge when
+// isGauge is set. Returns its id, or -1 when the name is invalid or too many counters exist.
+PROACTOR_API int proactorRegisterCounter(const char* name, const char* help, int isGauge);
 
-// Registers a socket and its associated callback function
-void registerSocket(int socket, ProactorCallback callback);
+// Adds delta (negative for a gauge going down) to a registered counter; lock-free from any thread
+PROACTOR_API void proactorCounterAdd(int counter, long delta);
 
 #endif // PROACTOR_H
@@ -0,0 +1,227 @@
+#include "proactorLog.h"     // Include the logging header
+#include "proactorMetrics.h" // Include the drop counter
+#include <pthread.h>         // Include for the ring key and the flusher thread
+#include <stdarg.h>          // Include for the variable arguments of proactorLog
+#include <stdint.h>          // Include for uint64_t
+#include <stdio.h>           // Include for vsnprintf and perror
+#include <stdlib.h>          // Include for malloc and free
+#include <string.h>          // Include for memcpy
+#include <strings.h>         // Include for strcasecmp
+#include <time.h>            // Include for nanosleep
+#include <unistd.h>          // Include for write
+#include <errno.h>           // Include for EINTR
+
+#define DEFAULT_RING_BYTES (64 * 1024) // Ring of a thread when proactorLogStart is given 0
+#define FLUSH_INTERVAL_MS 10           // How often the flusher collects the rings
+#define BATCH_BYTES (64 * 1024)        // Bytes the flusher gathers before writing them
+#define CACHE_LINE_SIZE 64             // Padding keeping the producer's and the flusher's fields apart
+
+// Structure representing the ring one thread logs into; the thread writes, the flusher reads
+typedef struct LogRing {
+    struct LogRing* next;  // Next ring in the list of all rings
+    int inUse;             // Non-zero while a thread owns the ring; rings of exited threads are reused
+    char* data;            // capacity bytes
+    size_t capacity;       // Power of two, so positions wrap with a mask
+    uint64_t head;         // Bytes ever written; only the owner stores it, with release
+    uint64_t dropped;      // Lines the owner could not fit
+    char producerPadding[CACHE_LINE_SIZE]; // Keeps the flusher's fields off the owner's cache line
+    uint64_t tail;         // Bytes ever written out; only the flusher stores it, with release
+    uint64_t reportedDrops; // Drops the flusher already reported
+} LogRing;
+
+static LogRing* rings = NULL;                  // Every ring ever created, pushed lock-free
+static __thread LogRing* threadRing = NULL;    // Ring of the calling thread
+static pthread_key_t ringKey;                  // Gives a ring back when its thread exits
+static pthread_once_t ringKeyOnce = PTHREAD_ONCE_INIT;
+
+static int logLevel = PROACTOR_LOG_INFO;       // Least severe level logged
+static int logRunning = 0;                     // Non-zero while the flusher runs
+static int flusherStopping = 0;                // Tells the flusher to drain and exit
+static int logDescriptor = -1;                 // Where the flusher writes
+static size_t ringBytes = DEFAULT_RING_BYTES;  // Capacity of new rings
+static pthread_t flusherThread;                // Thread writing the rings out
+static char batch[BATCH_BYTES];                // Flusher's output buffer
+static size_t batchLength = 0;                 // Bytes waiting in batch
+
+// Helper function run when a thread exits: the next new thread takes its ring over
+static void releaseRing(void* ring) {
+    __atomic_store_n(&((LogRing*)ring)->inUse, 0, __ATOMIC_RELEASE);
+}
+
+// Helper function to create the key whose destructor releases rings
+static void createRingKey() {
+    pthread_key_create(&ringKey, releaseRing);
+}
+
+// Helper function to return the calling thread's ring, claiming or creating one the first time
+static LogRing* localRing() {
+    if (threadRing != NULL) return threadRing;
+    pthread_once(&ringKeyOnce, createRingKey);
+    LogRing* ring;
+    for (ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&ring->inUse, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) break;
+    }
+    if (ring == NULL) {
+        ring = (LogRing*)calloc(1, sizeof(LogRing));
+        if (ring == NULL) return NULL;
+        ring->capacity = ringBytes;
+        ring->data = (char*)malloc(ring->capacity);
+        if (ring->data == NULL) {
+            free(ring);
+            return NULL;
+        }
+        ring->inUse = 1;
+        ring->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {}
+    }
+    pthread_setspecific(ringKey, ring);
+    threadRing = ring;
+    return ring;
+}
+
+// Helper function to write a whole buffer, retrying after short writes
+static void writeOut(const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(logDescriptor, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return; // Nowhere to complain to; the lines are lost
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+}
+
+// Helper function to append bytes to the batch, writing it out whenever it fills up
+static void appendBatch(const char* data, size_t length) {
+    while (length > 0) {
+        size_t chunk = BATCH_BYTES - batchLength;
+        if (chunk > length) chunk = length;
+        memcpy(batch + batchLength, data, chunk);
+        batchLength += chunk;
+        data += chunk;
+        length -= chunk;
+        if (batchLength == BATCH_BYTES) {
+            writeOut(batch, batchLength);
+            batchLength = 0;
+        }
+    }
+}
+
+// Helper function to move everything buffered in every ring to the descriptor
+static void drainRings() {
+    for (LogRing* ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE); // Lines before it are complete
+        uint64_t tail = ring->tail;
+        if (head != tail) {
+            size_t offset = (size_t)(tail & (ring->capacity - 1));
+            size_t length = (size_t)(head - tail);
+            size_t first = ring->capacity - offset < length ? ring->capacity - offset : length;
+            appendBatch(ring->data + offset, first);
+            appendBatch(ring->data, length - first); // Part that wrapped around
+            __atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE); // Hands the space back to the owner
+        }
+        uint64_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+        if (dropped != ring->reportedDrops) {
+            char notice[96];
+            int length = snprintf(notice, sizeof(notice), "proactor: %llu log lines dropped on a full buffer\n",
+                                  (unsigned long long)(dropped - ring->reportedDrops));
+            appendBatch(notice, (size_t)length);
+            ring->reportedDrops = dropped;
+        }
+    }
+    if (batchLength > 0) {
+        writeOut(batch, batchLength); // One system call for everything collected
+        batchLength = 0;
+    }
+}
+
+// Function run by the flusher thread
+static void* flushLoop(void* arg) {
+    (void)arg; // Unused
+    struct timespec interval = { 0, FLUSH_INTERVAL_MS * 1000000L };
+    while (!__atomic_load_n(&flusherStopping, __ATOMIC_ACQUIRE)) {
+        nanosleep(&interval, NULL);
+        drainRings();
+    }
+    drainRings(); // Whatever was logged before the stop
+    return NULL;
+}
+
+// Function to start the flusher
+int proactorLogStart(int descriptor, size_t bytes) {
+    if (__atomic_load_n(&logRunning, __ATOMIC_ACQUIRE) || descriptor < 0) return -1;
+    if (__atomic_load_n(&rings, __ATOMIC_ACQUIRE) == NULL) { // Rings created by an earlier start keep their size
+        size_t capacity = bytes == 0 ? DEFAULT_RING_BYTES : PROACTOR_LOG_LINE_MAX;
+        while (capacity < bytes) capacity <<= 1;
+        ringBytes = capacity;
+    }
+    fflush(stdout); // Lines printed so far come first
+    logDescriptor = descriptor;
+    __atomic_store_n(&flusherStopping, 0, __ATOMIC_RELAXED);
+    if (pthread_create(&flusherThread, NULL, flushLoop, NULL) != 0) {
+        perror("Error creating log flusher");
+        return -1;
+    }
+    __atomic_store_n(&logRunning, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Function to write out the rings and stop the flusher
+void proactorLogStop() {
+    if (!__atomic_load_n(&logRunning, __ATOMIC_ACQUIRE)) return;
+    __atomic_store_n(&logRunning, 0, __ATOMIC_RELEASE); // New lines go straight to stdout
+    __atomic_store_n(&flusherStopping, 1, __ATOMIC_RELEASE);
+    pthread_join(flusherThread, NULL); // Its last pass drains every ring
+}
+
+// Function to set the least severe level logged
+void proactorLogSetLevel(int level) {
+    __atomic_store_n(&logLevel, level, __ATOMIC_RELAXED);
+}
+
+// Function to look a level up by name
+int proactorLogLevelFromName(const char* name) {
+    static const char* names[] = { "debug", "info", "warn", "error" }; // Indexed by PROACTOR_LOG_*
+    if (name == NULL) return -1;
+    for (int level = PROACTOR_LOG_DEBUG; level <= PROACTOR_LOG_ERROR; level++) {
+        if (strcasecmp(name, names[level]) == 0) return level;
+    }
+    return -1;
+}
+
+// Function to log a line: format it on the stack and copy it into the caller's ring
+void proactorLog(int level, const char* format, ...) {
+    if (level < __atomic_load_n(&logLevel, __ATOMIC_RELAXED)) return; // Disabled levels cost one load
+    va_list arguments;
+    va_start(arguments, format);
+    if (!__atomic_load_n(&logRunning, __ATOMIC_ACQUIRE)) {
+        vprintf(format, arguments); // No flusher: behave like printf
+        va_end(arguments);
+        return;
+    }
+    char line[PROACTOR_LOG_LINE_MAX];
+    int formatted = vsnprintf(line, sizeof(line), format, arguments);
+    va_end(arguments);
+    if (formatted <= 0) return;
+    size_t length = (size_t)formatted;
+    if (length >= sizeof(line)) { // Cut short, but keep the line ending
+        length = sizeof(line) - 1;
+        line[length - 1] = '\n';
+    }
+
+    LogRing* ring = localRing();
+    if (ring == NULL) return;
+    uint64_t head = ring->head;
+    if (ring->capacity - (size_t)(head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) < length) {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED); // Only the owner writes it
+        metricsAdd(METRIC_LOG_DROPPED, 1);
+        return;
+    }
+    size_t offset = (size_t)(head & (ring->capacity - 1));
+    size_t first = ring->capacity - offset < length ? ring->capacity - offset : length;
+    memcpy(ring->data + offset, line, first);
+    memcpy(ring->data, line + first, length - first); // Part that wraps around
+    __atomic_store_n(&ring->head, head + length, __ATOMIC_RELEASE); // Publishes the whole line to the flusher
+}
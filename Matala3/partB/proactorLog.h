@@ -0,0 +1,39 @@
+#ifndef PROACTOR_LOG_H
+#define PROACTOR_LOG_H
+
+#include <stddef.h>     // For size_t
+#include "proactor.h"   // For PROACTOR_API
+
+// Asynchronous logging for hot paths. Every thread formats its lines into a ring buffer of its own,
+// with no lock and no system call; a background thread collects the rings every few milliseconds
+// and writes them out in large batches. Lines of one thread keep their order, lines of different
+// threads may interleave by batch. When a ring is full the line is dropped and counted: the flusher
+// reports the drops in the log and proactor_log_dropped_total counts them in the metrics.
+// Until proactorLogStart is called, and after proactorLogStop, lines go straight to stdout.
+
+// Log levels, from the most to the least verbose
+#define PROACTOR_LOG_DEBUG 0
+#define PROACTOR_LOG_INFO 1
+#define PROACTOR_LOG_WARN 2
+#define PROACTOR_LOG_ERROR 3
+
+// Starts the flusher writing to descriptor, with a ring of ringBytes (rounded up to a power of two,
+// 0 for the default) for every thread that logs. Returns 0 on success and -1 on failure.
+PROACTOR_API int proactorLogStart(int descriptor, size_t ringBytes);
+
+// Writes out what is buffered and stops the flusher; no other thread may log while it runs
+PROACTOR_API void proactorLogStop();
+
+// Sets the least severe level that is logged (PROACTOR_LOG_INFO by default)
+PROACTOR_API void proactorLogSetLevel(int level);
+
+// Returns the level called name ("debug", "info", "warn" or "error"), or -1 if there is none
+PROACTOR_API int proactorLogLevelFromName(const char* name);
+
+// Logs a printf-style line, newline included, if level is enabled. Lines longer than
+// PROACTOR_LOG_LINE_MAX are cut short.
+PROACTOR_API void proactorLog(int level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+#define PROACTOR_LOG_LINE_MAX 1024 // Longest line proactorLog keeps
+
+#endif // PROACTOR_LOG_H
@@ -0,0 +1,320 @@
+#include "proactor.h"        // Include the exported metrics functions
+#include "proactorMetrics.h" // Include the internal instrumentation
+#include <pthread.h>         // Include for the shard key and the admin thread
+#include <stdarg.h>          // Include for the formatted text appender
+#include <stdio.h>           // Include for vsnprintf and perror
+#include <stdlib.h>          // Include for calloc and malloc
+#include <string.h>          // Include for strlen and strncpy
+#include <time.h>            // Include for clock_gettime
+#include <unistd.h>          // Include for write, close and unlink
+#include <errno.h>           // Include for EINTR
+#include <sys/socket.h>      // Include for the admin socket
+#include <sys/un.h>          // Include for sockaddr_un
+#include <sys/time.h>        // Include for the admin send timeout
+#include <sys/stat.h>        // Include for the inode of the admin socket file
+
+#define MAX_USER_COUNTERS 32     // Application counters proactorRegisterCounter accepts
+#define COUNTER_NAME_MAX 64      // Longest counter name
+#define COUNTER_HELP_MAX 128     // Longest counter description
+#define HISTOGRAM_BUCKETS 26     // Bucket i counts durations up to 2^i microseconds; the last one is +Inf
+#define ADMIN_SEND_TIMEOUT_SECONDS 1 // An admin client that does not read is dropped after this long
+
+// Structure representing the metrics updated by one thread
+typedef struct MetricsShard {
+    struct MetricsShard* next;   // Next shard in the list of all shards
+    int inUse;                   // Non-zero while a thread owns the shard; shards of exited threads are reused
+    int64_t counters[METRIC_COUNT + MAX_USER_COUNTERS]; // Proactor counters followed by the application ones
+    uint64_t buckets[HISTOGRAM_COUNT][HISTOGRAM_BUCKETS]; // Non-cumulative histogram buckets
+    uint64_t sums[HISTOGRAM_COUNT]; // Sum of the observed durations in nanoseconds
+} MetricsShard;
+
+// Structure describing one reported counter
+typedef struct {
+    const char* name;   // Metric name
+    const char* help;   // Description
+    int isGauge;        // Reported as a gauge rather than a counter
+} CounterInfo;
+
+static const CounterInfo proactorCounters[METRIC_COUNT] = {
+    [METRIC_REGISTRATIONS] = { "proactor_registrations_total", "Sockets registered", 0 },
+    [METRIC_RELEASES] = { "proactor_releases_total", "Registrations removed", 0 },
+    [METRIC_ACCEPTED] = { "proactor_accepted_total", "Connections accepted by the event loop listeners", 0 },
+    [METRIC_CALLBACKS] = { "proactor_callbacks_total", "Callbacks run", 0 },
+    [METRIC_BYTES_RECEIVED] = { "proactor_received_bytes_total", "Bytes read for completion callbacks", 0 },
+    [METRIC_MESSAGES_SENT] = { "proactor_sent_messages_total", "Sends handed to the proactor", 0 },
+    [METRIC_BYTES_SENT] = { "proactor_sent_bytes_total", "Bytes written to the sockets", 0 },
+    [METRIC_MESSAGES_DROPPED] = { "proactor_dropped_messages_total", "Queued sends discarded by the drop-oldest policy", 0 },
+    [METRIC_SLOW_CONSUMER_DISCONNECTS] = { "proactor_slow_consumer_disconnects_total", "Connections shut down by the disconnect policy", 0 },
+    [METRIC_PAUSED_SENDS] = { "proactor_paused_sends_total", "Sends that waited for an output queue to drain", 0 },
+    [METRIC_TASKS_POSTED] = { "proactor_posted_tasks_total", "Tasks posted to the event loop inboxes", 0 },
+    [METRIC_TASKS_RUN] = { "proactor_run_tasks_total", "Posted tasks the event loops ran", 0 },
+    [METRIC_LOG_DROPPED] = { "proactor_log_dropped_total", "Log lines dropped because the thread's log buffer was full", 0 },
+    [METRIC_TIMERS_FIRED] = { "proactor_timers_fired_total", "Timer callbacks run by the event loops", 0 },
+    [METRIC_IDLE_TIMEOUTS] = { "proactor_idle_timeouts_total", "Connections shut down after staying silent for their idle timeout", 0 },
+    [METRIC_HEARTBEATS] = { "proactor_heartbeats_total", "Heartbeats queued on quiet connections", 0 },
+    [METRIC_POOL_SLABS] = { "proactor_pool_slabs_total", "Slabs the memory pool allocated from the heap", 0 },
+    [METRIC_POOL_LARGE_ALLOCATIONS] = { "proactor_pool_large_allocations_total", "Pool requests too large for a size class, passed to malloc", 0 },
+};
+
+static const CounterInfo proactorHistograms[HISTOGRAM_COUNT] = {
+    [HISTOGRAM_CALLBACK] = { "proactor_callback_duration_seconds", "Time spent in one callback", 0 },
+    [HISTOGRAM_LOOP_ITERATION] = { "proactor_loop_iteration_seconds", "Time an event loop spent on one batch of events", 0 },
+};
+
+static MetricsShard* shards = NULL;            // Every shard ever created, pushed lock-free
+static __thread MetricsShard* threadShard = NULL; // Shard of the calling thread
+static pthread_key_t shardKey;                 // Gives a shard back when its thread exits
+static pthread_once_t shardKeyOnce = PTHREAD_ONCE_INIT;
+
+static CounterInfo userCounters[MAX_USER_COUNTERS]; // Application counters
+static char userNames[MAX_USER_COUNTERS][COUNTER_NAME_MAX + 1];
+static char userHelp[MAX_USER_COUNTERS][COUNTER_HELP_MAX + 1];
+static int userCounterCount = 0;               // Published with release once an entry is filled
+static pthread_mutex_t userCounterMutex = PTHREAD_MUTEX_INITIALIZER; // Serializes registrations
+
+static int adminSocket = -1;                   // Listening admin socket, -1 when not serving
+static pthread_t adminThread;                  // Thread answering the admin socket
+static char adminPath[sizeof(((struct sockaddr_un*)0)->sun_path)]; // Path unlinked when the admin stops
+static struct stat adminFile;                  // Socket file bound at adminPath; a restarted server may have replaced it
+
+// Helper function run when a thread exits: its shard keeps its counts and goes to the next new thread
+static void releaseShard(void* shard) {
+    __atomic_store_n(&((MetricsShard*)shard)->inUse, 0, __ATOMIC_RELEASE);
+}
+
+// Helper function to create the key whose destructor releases shards
+static void createShardKey() {
+    pthread_key_create(&shardKey, releaseShard);
+}
+
+// Helper function to return the calling thread's shard, claiming or creating one the first time
+static MetricsShard* localShard() {
+    if (threadShard != NULL) return threadShard;
+    pthread_once(&shardKeyOnce, createShardKey);
+    MetricsShard* shard;
+    for (shard = __atomic_load_n(&shards, __ATOMIC_ACQUIRE); shard != NULL; shard = shard->next) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&shard->inUse, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) break;
+    }
+    if (shard == NULL) {
+        shard = (MetricsShard*)calloc(1, sizeof(MetricsShard));
+        if (shard == NULL) return NULL; // Not counted rather than failing the caller
+        shard->inUse = 1;
+        shard->next = __atomic_load_n(&shards, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&shards, &shard->next, shard, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {}
+    }
+    pthread_setspecific(shardKey, shard);
+    threadShard = shard;
+    return shard;
+}
+
+// Helper function to add to a cell only the owning thread writes; readers may load it at any time
+static void addToCell(uint64_t* cell, uint64_t delta) {
+    __atomic_store_n(cell, __atomic_load_n(cell, __ATOMIC_RELAXED) + delta, __ATOMIC_RELAXED);
+}
+
+// Function to add to a proactor counter
+void metricsAdd(ProactorMetric metric, int64_t delta) {
+    MetricsShard* shard = localShard();
+    if (shard != NULL) addToCell((uint64_t*)&shard->counters[metric], (uint64_t)delta); // Wraps like the signed sum
+}
+
+// Function to record a duration
+void metricsObserve(ProactorHistogram histogram, uint64_t nanoseconds) {
+    MetricsShard* shard = localShard();
+    if (shard == NULL) return;
+    uint64_t microseconds = nanoseconds / 1000;
+    int bucket = microseconds == 0 ? 0 : 64 - __builtin_clzll(microseconds); // Smallest i with the duration below 2^i us
+    if (bucket >= HISTOGRAM_BUCKETS) bucket = HISTOGRAM_BUCKETS - 1;
+    addToCell(&shard->buckets[histogram][bucket], 1);
+    addToCell(&shard->sums[histogram], nanoseconds);
+}
+
+// Function to read the monotonic clock
+uint64_t metricsNow() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+// Helper function to add up one counter over every shard
+static int64_t sumCounter(int index) {
+    int64_t sum = 0;
+    for (MetricsShard* shard = __atomic_load_n(&shards, __ATOMIC_ACQUIRE); shard != NULL; shard = shard->next) {
+        sum += __atomic_load_n(&shard->counters[index], __ATOMIC_RELAXED);
+    }
+    return sum;
+}
+
+// Structure representing text being formatted into a caller's buffer
+typedef struct {
+    char* buffer;     // Destination, may be NULL
+    size_t capacity;  // Size of buffer
+    size_t length;    // Length of the full text so far, even past capacity
+} MetricsText;
+
+// Helper function to append formatted text, counting what does not fit
+static void appendText(MetricsText* text, const char* format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+    size_t room = text->length < text->capacity ? text->capacity - text->length : 0;
+    int written = vsnprintf(room > 0 ? text->buffer + text->length : NULL, room, format, arguments);
+    va_end(arguments);
+    if (written > 0) text->length += (size_t)written;
+}
+
+// Helper function to append one counter or gauge
+static void appendCounter(MetricsText* text, const CounterInfo* info, int64_t value) {
+    const char* type = info->isGauge ? "gauge" : "counter";
+    appendText(text, "# HELP %s %s\n# TYPE %s %s\n%s %lld\n", info->name, info->help, info->name, type, info->name, (long long)value);
+}
+
+// Helper function to append one histogram added up over every shard
+static void appendHistogram(MetricsText* text, int histogram) {
+    const CounterInfo* info = &proactorHistograms[histogram];
+    uint64_t buckets[HISTOGRAM_BUCKETS] = { 0 };
+    uint64_t sum = 0;
+    for (MetricsShard* shard = __atomic_load_n(&shards, __ATOMIC_ACQUIRE); shard != NULL; shard = shard->next) {
+        for (int i = 0; i < HISTOGRAM_BUCKETS; i++) buckets[i] += __atomic_load_n(&shard->buckets[histogram][i], __ATOMIC_RELAXED);
+        sum += __atomic_load_n(&shard->sums[histogram], __ATOMIC_RELAXED);
+    }
+    appendText(text, "# HELP %s %s\n# TYPE %s histogram\n", info->name, info->help, info->name);
+    uint64_t cumulative = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS - 1; i++) {
+        cumulative += buckets[i];
+        appendText(text, "%s_bucket{le=\"%.6f\"} %llu\n", info->name, (double)(1ULL << i) / 1e6, (unsigned long long)cumulative);
+    }
+    cumulative += buckets[HISTOGRAM_BUCKETS - 1];
+    appendText(text, "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %.9f\n%s_count %llu\n", info->name, (unsigned long long)cumulative,
+               info->name, sum / 1e9, info->name, (unsigned long long)cumulative);
+}
+
+// Function to write a snapshot of every metric
+size_t proactorMetricsText(char* buffer, size_t capacity) {
+    MetricsText text = { buffer, capacity, 0 };
+    if (capacity > 0) buffer[0] = '\0';
+
+    // Gauges derived from the counters and from the registry
+    CounterInfo connections = { "proactor_connections", "Sockets currently registered", 1 };
+    appendCounter(&text, &connections, sumCounter(METRIC_REGISTRATIONS) - sumCounter(METRIC_RELEASES));
+    CounterInfo inboxDepth = { "proactor_inbox_depth", "Tasks posted to the event loops and not run yet", 1 };
+    appendCounter(&text, &inboxDepth, sumCounter(METRIC_TASKS_POSTED) - sumCounter(METRIC_TASKS_RUN));
+    size_t queuedBytes = 0, largestQueue = 0;
+    int largestSocket = -1, overWatermark = 0;
+    collectOutputQueueMetrics(&queuedBytes, &largestQueue, &largestSocket, &overWatermark);
+    CounterInfo queued = { "proactor_output_queued_bytes", "Bytes queued for all sockets that the kernel has not taken", 1 };
+    appendCounter(&text, &queued, (int64_t)queuedBytes);
+    CounterInfo largest = { "proactor_output_queue_largest_bytes", "Largest single output queue, the slowest consumer", 1 };
+    appendCounter(&text, &largest, (int64_t)largestQueue);
+    CounterInfo largestOwner = { "proactor_output_queue_largest_socket", "Socket owning the largest output queue (-1 if none)", 1 };
+    appendCounter(&text, &largestOwner, largestSocket);
+    CounterInfo over = { "proactor_output_queues_over_high_watermark", "Output queues past their high watermark", 1 };
+    appendCounter(&text, &over, overWatermark);
+
+    for (int i = 0; i < METRIC_COUNT; i++) appendCounter(&text, &proactorCounters[i], sumCounter(i));
+    for (int i = 0; i < HISTOGRAM_COUNT; i++) appendHistogram(&text, i);
+    int userCount = __atomic_load_n(&userCounterCount, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < userCount; i++) appendCounter(&text, &userCounters[i], sumCounter(METRIC_COUNT + i));
+    return text.length;
+}
+
+// Function to register an application counter
+int proactorRegisterCounter(const char* name, const char* help, int isGauge) {
+    if (name == NULL || name[0] == '\0' || strlen(name) > COUNTER_NAME_MAX) return -1;
+    pthread_mutex_lock(&userCounterMutex);
+    int id = userCounterCount;
+    if (id < MAX_USER_COUNTERS) {
+        strncpy(userNames[id], name, COUNTER_NAME_MAX);
+        strncpy(userHelp[id], help != NULL ? help : name, COUNTER_HELP_MAX);
+        userCounters[id] = (CounterInfo){ userNames[id], userHelp[id], isGauge };
+        __atomic_store_n(&userCounterCount, id + 1, __ATOMIC_RELEASE); // Readers only look at filled entries
+    }
+    pthread_mutex_unlock(&userCounterMutex);
+    return id < MAX_USER_COUNTERS ? id : -1;
+}
+
+// Function to add to an application counter
+void proactorCounterAdd(int counter, long delta) {
+    if (counter < 0 || counter >= __atomic_load_n(&userCounterCount, __ATOMIC_ACQUIRE)) return;
+    MetricsShard* shard = localShard();
+    if (shard != NULL) addToCell((uint64_t*)&shard->counters[METRIC_COUNT + counter], (uint64_t)(int64_t)delta);
+}
+
+// Helper function to write a whole buffer to a blocking socket
+static void writeAll(int socket, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(socket, data, length);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return; // The reader went away or timed out
+        data += written;
+        length -= (size_t)written;
+    }
+}
+
+// Thread function answering the admin socket with one snapshot per connection
+static void* serveAdmin(void* arg) {
+    int listener = (int)(intptr_t)arg;
+    size_t capacity = 16384; // Grown when a snapshot does not fit
+    char* buffer = (char*)malloc(capacity);
+    while (buffer != NULL) {
+        int client = accept(listener, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break; // Shut down by stopMetricsAdmin
+        }
+        struct timeval timeout = { .tv_sec = ADMIN_SEND_TIMEOUT_SECONDS };
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        size_t length;
+        while ((length = proactorMetricsText(buffer, capacity)) >= capacity) {
+            char* grown = (char*)realloc(buffer, length * 2);
+            if (grown == NULL) break;
+            buffer = grown;
+            capacity = length * 2;
+        }
+        writeAll(client, buffer, length < capacity ? length : strlen(buffer));
+        close(client);
+    }
+    free(buffer);
+    return NULL;
+}
+
+// Function to start serving the metrics on a Unix domain socket
+int proactorStartAdmin(const char* path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (adminSocket != -1 || path == NULL || strlen(path) >= sizeof(address.sun_path)) return -1;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) {
+        perror("Error creating admin socket");
+        return -1;
+    }
+    unlink(path); // A socket file left behind by an earlier run would make bind fail
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 16) < 0) {
+        perror("Error binding admin socket");
+        close(listener);
+        return -1;
+    }
+    if (pthread_create(&adminThread, NULL, serveAdmin, (void*)(intptr_t)listener) != 0) {
+        perror("Error creating admin thread");
+        close(listener);
+        unlink(path);
+        return -1;
+    }
+    strncpy(adminPath, path, sizeof(adminPath) - 1);
+    if (stat(path, &adminFile) < 0) memset(&adminFile, 0, sizeof(adminFile));
+    adminSocket = listener;
+    return 0;
+}
+
+// Function to stop the admin socket
+void stopMetricsAdmin() {
+    if (adminSocket == -1) return;
+    shutdown(adminSocket, SHUT_RDWR); // Makes the blocked accept fail
+    pthread_join(adminThread, NULL);
+    close(adminSocket);
+    struct stat current;
+    if (stat(adminPath, &current) == 0 && current.st_ino == adminFile.st_ino && current.st_dev == adminFile.st_dev) {
+        unlink(adminPath); // Only our own file: the process that took over during a hot restart keeps its socket
+    }
+    adminSocket = -1;
+}
@@ -0,0 +1,56 @@
+#ifndef PROACTOR_METRICS_H
+#define PROACTOR_METRICS_H
+
+#include <stddef.h>  // For size_t
+#include <stdint.h>  // For uint64_t
+
+// Internal instrumentation of the proactor. Every thread updates its own shard of counters and
+// histograms without locking or atomic read-modify-writes; proactorMetricsText adds the shards
+// up when somebody asks. The exported functions are declared in proactor.h.
+
+// Counters kept by the proactor itself
+typedef enum {
+    METRIC_REGISTRATIONS,        // Sockets registered
+    METRIC_RELEASES,             // Registrations removed
+    METRIC_ACCEPTED,             // Connections accepted by the loop listeners
+    METRIC_CALLBACKS,            // Callbacks run
+    METRIC_BYTES_RECEIVED,       // Bytes read by the proactor for completion callbacks
+    METRIC_MESSAGES_SENT,        // Sends handed to the proactor
+    METRIC_BYTES_SENT,           // Bytes the kernel took
+    METRIC_MESSAGES_DROPPED,     // Queued sends discarded by the drop-oldest policy
+    METRIC_SLOW_CONSUMER_DISCONNECTS, // Connections shut down by the disconnect policy
+    METRIC_PAUSED_SENDS,         // Sends that waited for a queue to drain
+    METRIC_TASKS_POSTED,         // Tasks posted to the event loop inboxes
+    METRIC_TASKS_RUN,            // Posted tasks the loops ran
+    METRIC_LOG_DROPPED,          // Log lines dropped on a full ring
+    METRIC_TIMERS_FIRED,         // Timer callbacks run by the loops
+    METRIC_IDLE_TIMEOUTS,        // Connections shut down after their idle timeout
+    METRIC_HEARTBEATS,           // Heartbeats queued on quiet connections
+    METRIC_POOL_SLABS,           // Slabs the memory pool took from the heap
+    METRIC_POOL_LARGE_ALLOCATIONS, // Pool requests too large for a size class, passed to malloc
+    METRIC_COUNT
+} ProactorMetric;
+
+// Latency histograms kept by the proactor
+typedef enum {
+    HISTOGRAM_CALLBACK,          // Time spent in one callback
+    HISTOGRAM_LOOP_ITERATION,    // Time an event loop spends handling one batch of events
+    HISTOGRAM_COUNT
+} ProactorHistogram;
+
+// Adds delta to a counter in the calling thread's shard
+void metricsAdd(ProactorMetric metric, int64_t delta);
+
+// Records a duration in nanoseconds in the calling thread's shard
+void metricsObserve(ProactorHistogram histogram, uint64_t nanoseconds);
+
+// Returns a monotonic timestamp in nanoseconds for timing with metricsObserve
+uint64_t metricsNow();
+
+// Stops the admin socket if it runs; called by cleanupProactor
+void stopMetricsAdmin();
+
+// Defined in proactor.c: sums up the output queues of every registration for a snapshot
+void collectOutputQueueMetrics(size_t* queuedBytes, size_t* largestQueue, int* largestSocket, int* overWatermark);
+
+#endif // PROACTOR_METRICS_H
@@ -0,0 +1,276 @@
+#include "roomTable.h"      // Include the room table header
+#include "broadcastGroup.h" // Include the broadcast groups holding each room's members
+#include <pthread.h>        // Include for the reader-writer lock
+#include <stdint.h>         // Include for uint64_t
+#include <stdlib.h>         // Include for malloc, realloc and free
+#include <string.h>         // Include for memcmp and memcpy
+
+#define ROOM_TABLE_INITIAL_BUCKETS 64 // Hash buckets of a new table; doubled when rooms outnumber them
+
+// Structure representing one room
+typedef struct Room {
+    struct Room* next;        // Next room in the same bucket
+    uint64_t hash;            // Hash of the name
+    int references;           // The table's reference plus one per send using the room
+    int memberCount;          // Subscribers, changed with the table lock held for writing
+    BroadcastGroup* members;  // Subscribers and the formats they receive
+    size_t nameLength;        // Length of the name
+    char name[];              // Room name (not NUL-terminated)
+} Room;
+
+// Structure representing the rooms one socket is subscribed to
+typedef struct Subscriptions {
+    Room** rooms;  // Subscribed rooms
+    int count;     // Number of rooms
+    int capacity;  // Allocated size of rooms
+} Subscriptions;
+
+// Structure representing the table
+struct RoomTable {
+    pthread_rwlock_t lock;        // Shared by sends, exclusive for subscription changes
+    Room** buckets;               // Hash buckets of rooms
+    size_t bucketCount;           // Number of buckets, a power of two
+    int roomCount;                // Number of rooms
+    Subscriptions* subscriptions; // Subscription index, indexed by socket
+    int subscriptionCapacity;     // Number of sockets the index covers
+};
+
+// Helper function to hash a room name (FNV-1a)
+static uint64_t hashName(const char* name, size_t nameLength) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < nameLength; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Helper function to find a room; called with the table lock held
+static Room* findRoom(RoomTable* table, const char* name, size_t nameLength, uint64_t hash) {
+    for (Room* room = table->buckets[hash & (table->bucketCount - 1)]; room != NULL; room = room->next) {
+        if (room->hash == hash && room->nameLength == nameLength && memcmp(room->name, name, nameLength) == 0) return room;
+    }
+    return NULL;
+}
+
+// Helper function to drop a reference, freeing the room with the last one
+static void releaseRoom(Room* room) {
+    if (__atomic_sub_fetch(&room->references, 1, __ATOMIC_ACQ_REL) != 0) return;
+    destroyBroadcastGroup(room->members);
+    free(room);
+}
+
+// Helper function to double the buckets; called with the table lock held for writing
+static void growBuckets(RoomTable* table) {
+    size_t bucketCount = table->bucketCount * 2;
+    Room** buckets = (Room**)calloc(bucketCount, sizeof(Room*));
+    if (buckets == NULL) return; // Keep the longer chains
+    for (size_t i = 0; i < table->bucketCount; i++) {
+        Room* room = table->buckets[i];
+        while (room != NULL) {
+            Room* next = room->next;
+            room->next = buckets[room->hash & (bucketCount - 1)];
+            buckets[room->hash & (bucketCount - 1)] = room;
+            room = next;
+        }
+    }
+    free(table->buckets);
+    table->buckets = buckets;
+    table->bucketCount = bucketCount;
+}
+
+// Helper function to create a room and link it into the table; called with the table lock held for writing
+static Room* addRoom(RoomTable* table, const char* name, size_t nameLength, uint64_t hash) {
+    Room* room = (Room*)malloc(sizeof(Room) + nameLength);
+    if (room == NULL) return NULL;
+    room->members = createBroadcastGroup();
+    if (room->members == NULL) {
+        free(room);
+        return NULL;
+    }
+    room->hash = hash;
+    room->references = 1; // Owned by the table
+    room->memberCount = 0;
+    room->nameLength = nameLength;
+    memcpy(room->name, name, nameLength);
+    if ((size_t)table->roomCount >= table->bucketCount) growBuckets(table);
+    room->next = table->buckets[hash & (table->bucketCount - 1)];
+    table->buckets[hash & (table->bucketCount - 1)] = room;
+    table->roomCount++;
+    return room;
+}
+
+// Helper function to unlink an empty room; sends still using it keep it alive until they finish
+static void removeRoom(RoomTable* table, Room* room) {
+    Room** link = &table->buckets[room->hash & (table->bucketCount - 1)];
+    while (*link != room) link = &(*link)->next;
+    *link = room->next;
+    table->roomCount--;
+    releaseRoom(room);
+}
+
+// Helper function to return a socket's subscriptions, growing the index if allocate is set
+static Subscriptions* socketSubscriptions(RoomTable* table, int socket, int allocate) {
+    if (socket < 0) return NULL;
+    if (socket >= table->subscriptionCapacity) {
+        if (!allocate) return NULL;
+        int capacity = table->subscriptionCapacity * 2 > socket ? table->subscriptionCapacity * 2 : socket + 1;
+        Subscriptions* grown = (Subscriptions*)realloc(table->subscriptions, (size_t)capacity * sizeof(Subscriptions));
+        if (grown == NULL) return NULL;
+        memset(grown + table->subscriptionCapacity, 0, (size_t)(capacity - table->subscriptionCapacity) * sizeof(Subscriptions));
+        table->subscriptions = grown;
+        table->subscriptionCapacity = capacity;
+    }
+    return &table->subscriptions[socket];
+}
+
+// Helper function to find a room in a socket's subscriptions
+static int findSubscription(const Subscriptions* subscriptions, const Room* room) {
+    for (int i = 0; i < subscriptions->count; i++) {
+        if (subscriptions->rooms[i] == room) return i;
+    }
+    return -1;
+}
+
+// Helper function to take a socket out of a room, removing the room once it is empty
+static void leaveRoom(RoomTable* table, Room* room, int socket) {
+    broadcastGroupRemove(room->members, socket);
+    if (--room->memberCount == 0) removeRoom(table, room);
+}
+
+// Function to create a table
+RoomTable* createRoomTable() {
+    RoomTable* table = (RoomTable*)calloc(1, sizeof(RoomTable));
+    if (table == NULL) return NULL;
+    table->bucketCount = ROOM_TABLE_INITIAL_BUCKETS;
+    table->buckets = (Room**)calloc(table->bucketCount, sizeof(Room*));
+    if (table->buckets == NULL) {
+        free(table);
+        return NULL;
+    }
+    pthread_rwlock_init(&table->lock, NULL);
+    return table;
+}
+
+// Function to free a table
+void destroyRoomTable(RoomTable* table) {
+    if (table == NULL) return;
+    for (size_t i = 0; i < table->bucketCount; i++) {
+        Room* room = table->buckets[i];
+        while (room != NULL) {
+            Room* next = room->next;
+            releaseRoom(room);
+            room = next;
+        }
+    }
+    for (int i = 0; i < table->subscriptionCapacity; i++) free(table->subscriptions[i].rooms);
+    free(table->subscriptions);
+    free(table->buckets);
+    pthread_rwlock_destroy(&table->lock);
+    free(table);
+}
+
+// Function to subscribe a socket to a room
+int roomTableSubscribe(RoomTable* table, const char* name, size_t nameLength, int socket, int format) {
+    if (nameLength == 0 || nameLength > ROOM_NAME_MAX) return -1;
+    uint64_t hash = hashName(name, nameLength);
+
+    pthread_rwlock_wrlock(&table->lock);
+    Subscriptions* subscriptions = socketSubscriptions(table, socket, 1);
+    Room* room = findRoom(table, name, nameLength, hash);
+    if (subscriptions == NULL || (room != NULL && findSubscription(subscriptions, room) >= 0)) {
+        pthread_rwlock_unlock(&table->lock);
+        return -1; // Out of memory or already subscribed
+    }
+    if (subscriptions->count == subscriptions->capacity) {
+        int capacity = subscriptions->capacity == 0 ? 4 : subscriptions->capacity * 2;
+        Room** grown = (Room**)realloc(subscriptions->rooms, (size_t)capacity * sizeof(Room*));
+        if (grown == NULL) {
+            pthread_rwlock_unlock(&table->lock);
+            return -1;
+        }
+        subscriptions->rooms = grown;
+        subscriptions->capacity = capacity;
+    }
+    if (room == NULL) room = addRoom(table, name, nameLength, hash); // First subscriber creates the room
+    if (room == NULL || broadcastGroupAddWithFormat(room->members, socket, format) != 0) {
+        if (room != NULL && room->memberCount == 0) removeRoom(table, room);
+        pthread_rwlock_unlock(&table->lock);
+        return -1;
+    }
+    room->memberCount++;
+    subscriptions->rooms[subscriptions->count++] = room;
+    pthread_rwlock_unlock(&table->lock);
+    return 0;
+}
+
+// Function to unsubscribe a socket from a room
+int roomTableUnsubscribe(RoomTable* table, const char* name, size_t nameLength, int socket) {
+    uint64_t hash = hashName(name, nameLength);
+    pthread_rwlock_wrlock(&table->lock);
+    Subscriptions* subscriptions = socketSubscriptions(table, socket, 0);
+    Room* room = findRoom(table, name, nameLength, hash);
+    int index = subscriptions != NULL && room != NULL ? findSubscription(subscriptions, room) : -1;
+    if (index < 0) {
+        pthread_rwlock_unlock(&table->lock);
+        return -1; // Not subscribed
+    }
+    subscriptions->rooms[index] = subscriptions->rooms[--subscriptions->count]; // Order does not matter
+    leaveRoom(table, room, socket);
+    pthread_rwlock_unlock(&table->lock);
+    return 0;
+}
+
+// Function to unsubscribe a socket from all its rooms
+void roomTableUnsubscribeAll(RoomTable* table, int socket) {
+    pthread_rwlock_wrlock(&table->lock);
+    Subscriptions* subscriptions = socketSubscriptions(table, socket, 0);
+    if (subscriptions != NULL) {
+        for (int i = 0; i < subscriptions->count; i++) leaveRoom(table, subscriptions->rooms[i], socket);
+        free(subscriptions->rooms); // The descriptor may be reused by a connection with other interests
+        memset(subscriptions, 0, sizeof(*subscriptions));
+    }
+    pthread_rwlock_unlock(&table->lock);
+}
+
+// Function to change the format a socket receives in all its rooms
+void roomTableSetFormat(RoomTable* table, int socket, int format) {
+    pthread_rwlock_rdlock(&table->lock); // Subscriptions only change under the write lock
+    Subscriptions* subscriptions = socketSubscriptions(table, socket, 0);
+    for (int i = 0; subscriptions != NULL && i < subscriptions->count; i++) {
+        broadcastGroupSetFormat(subscriptions->rooms[i]->members, socket, format);
+    }
+    pthread_rwlock_unlock(&table->lock);
+}
+
+// Function to count a socket's subscriptions
+int roomTableSubscriptions(RoomTable* table, int socket) {
+    pthread_rwlock_rdlock(&table->lock);
+    Subscriptions* subscriptions = socketSubscriptions(table, socket, 0);
+    int count = subscriptions != NULL ? subscriptions->count : 0;
+    pthread_rwlock_unlock(&table->lock);
+    return count;
+}
+
+// Function to count the rooms
+int roomTableSize(RoomTable* table) {
+    pthread_rwlock_rdlock(&table->lock);
+    int count = table->roomCount;
+    pthread_rwlock_unlock(&table->lock);
+    return count;
+}
+
+// Function to send to the members of a room
+int roomTableSend(RoomTable* table, const char* name, size_t nameLength, int exceptSocket,
+                  ProactorMessage* const* messages, int formatCount) {
+    uint64_t hash = hashName(name, nameLength);
+    pthread_rwlock_rdlock(&table->lock);
+    Room* room = findRoom(table, name, nameLength, hash);
+    if (room != NULL) __atomic_add_fetch(&room->references, 1, __ATOMIC_RELAXED); // Keeps it alive after removal
+    pthread_rwlock_unlock(&table->lock);
+    if (room == NULL) return -1;
+
+    int delivered = broadcastGroupSendFormats(room->members, exceptSocket, messages, formatCount); // No table lock held
+    releaseRoom(room);
+    return delivered;
+}
@@ -0,0 +1,48 @@
+#ifndef ROOM_TABLE_H
+#define ROOM_TABLE_H
+
+#include <stddef.h>         // For size_t
+#include "proactor.h"       // For PROACTOR_API and ProactorMessage
+
+// Named rooms (topics), each with its own broadcast group, so a message costs as much as the
+// room it is sent to rather than every connected socket. Rooms are created by their first
+// subscription and removed with their last one. A per-socket index of subscriptions lets a
+// socket be moved out of all its rooms, or switched to another message format, at once.
+// Sends look rooms up under a shared lock and fan out with no lock held.
+typedef struct RoomTable RoomTable;
+
+// Longest room name accepted
+#define ROOM_NAME_MAX 64
+
+// Creates an empty table, or returns NULL when out of memory
+PROACTOR_API RoomTable* createRoomTable();
+
+// Frees the table and every room; no other thread may use it any more
+PROACTOR_API void destroyRoomTable(RoomTable* table);
+
+// Subscribes a registered socket to a room, creating the room if needed. The socket receives
+// variant number format of roomTableSend. Returns 0 on success and -1 if the name is empty or
+// too long, the socket is already subscribed, or memory runs out.
+PROACTOR_API int roomTableSubscribe(RoomTable* table, const char* name, size_t nameLength, int socket, int format);
+
+// Unsubscribes a socket from a room. Returns 0 on success and -1 if it was not subscribed.
+PROACTOR_API int roomTableUnsubscribe(RoomTable* table, const char* name, size_t nameLength, int socket);
+
+// Unsubscribes a socket from every room it is in; used when the connection closes
+PROACTOR_API void roomTableUnsubscribeAll(RoomTable* table, int socket);
+
+// Changes the message variant a socket receives in all its rooms
+PROACTOR_API void roomTableSetFormat(RoomTable* table, int socket, int format);
+
+// Returns the number of rooms a socket is subscribed to
+PROACTOR_API int roomTableSubscriptions(RoomTable* table, int socket);
+
+// Returns the number of rooms
+PROACTOR_API int roomTableSize(RoomTable* table);
+
+// Queues messages[format] for every member of a room except exceptSocket (see broadcastGroupSendFormats).
+// Returns the number of members a message was handed to, or -1 if there is no such room.
+PROACTOR_API int roomTableSend(RoomTable* table, const char* name, size_t nameLength, int exceptSocket,
+                               ProactorMessage* const* messages, int formatCount);
+
+#endif // ROOM_TABLE_H
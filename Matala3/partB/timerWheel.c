@@ -0,0 +1,115 @@
+#include "timerWheel.h" // Include the timer wheel header
+#include <string.h>     // Include for memset
+
+// Helper function to push a node on a list whose head is *head
+static void pushNode(TimerNode** head, TimerNode* node, int slot) {
+    node->next = *head;
+    if (node->next != NULL) node->next->previous = &node->next;
+    *head = node;
+    node->previous = head;
+    node->slot = slot;
+}
+
+// Helper function to put a node in the slot matching expiry; expiry must not be before the wheel's clock.
+// The level is the highest group of bits in which expiry differs from the clock, so the timer is seen
+// again exactly when the clock reaches that group's value.
+static void placeNode(TimerWheel* wheel, TimerNode* node, uint64_t expiry) {
+    uint64_t difference = expiry ^ wheel->now;
+    int level = difference == 0 ? 0 : (63 - __builtin_clzll(difference)) / TIMER_WHEEL_BITS;
+    int index = (int)((expiry >> (level * TIMER_WHEEL_BITS)) & (TIMER_WHEEL_SLOTS - 1));
+    if (level >= TIMER_WHEEL_LEVELS) { // Due in the next turn of the last level, or even later
+        level = TIMER_WHEEL_LEVELS - 1;
+        int shift = level * TIMER_WHEEL_BITS;
+        if (expiry - wheel->now < (1ULL << (shift + TIMER_WHEEL_BITS))) {
+            index = (int)((expiry >> shift) & (TIMER_WHEEL_SLOTS - 1)); // A slot at or behind the clock's stands for the next turn
+        } else {
+            index = (int)(((wheel->now >> shift) - 1) & (TIMER_WHEEL_SLOTS - 1)); // Park it almost a turn away and look again then
+        }
+    }
+    int slot = level * TIMER_WHEEL_SLOTS + index;
+    pushNode(&wheel->slots[slot], node, slot);
+    wheel->occupied[level] |= 1ULL << index;
+}
+
+// Helper function to unlink every node of a slot and return them as a list linked through next
+static TimerNode* takeSlot(TimerWheel* wheel, int level, int index) {
+    int slot = level * TIMER_WHEEL_SLOTS + index;
+    TimerNode* list = wheel->slots[slot];
+    wheel->slots[slot] = NULL;
+    wheel->occupied[level] &= ~(1ULL << index);
+    return list;
+}
+
+// Function to prepare an empty wheel
+void timerWheelInit(TimerWheel* wheel, uint64_t now) {
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now = now;
+}
+
+// Function to add a timer
+void timerWheelAdd(TimerWheel* wheel, TimerNode* node, uint64_t expiry) {
+    node->expiry = expiry > wheel->now ? expiry : wheel->now + 1; // The current tick has already been handled
+    placeNode(wheel, node, node->expiry);
+}
+
+// Function to remove a timer in constant time
+void timerWheelRemove(TimerWheel* wheel, TimerNode* node) {
+    if (node->previous == NULL) return; // Not linked
+    *node->previous = node->next;
+    if (node->next != NULL) node->next->previous = node->previous;
+    if (node->slot >= 0 && wheel->slots[node->slot] == NULL) {
+        wheel->occupied[node->slot / TIMER_WHEEL_SLOTS] &= ~(1ULL << (node->slot % TIMER_WHEEL_SLOTS)); // Slot emptied
+    }
+    node->previous = NULL;
+    node->next = NULL;
+}
+
+// Function to check whether a timer is linked
+int timerWheelLinked(const TimerNode* node) {
+    return node->previous != NULL;
+}
+
+// Function to find the next tick the wheel has work at
+uint64_t timerWheelNextTick(const TimerWheel* wheel) {
+    uint64_t next = UINT64_MAX;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        uint64_t bits = wheel->occupied[level];
+        if (bits == 0) continue;
+        int shift = level * TIMER_WHEEL_BITS;
+        int current = (int)((wheel->now >> shift) & (TIMER_WHEEL_SLOTS - 1)); // Slot the clock is in, already handled
+        uint64_t ahead = current == TIMER_WHEEL_SLOTS - 1 ? 0 : bits & (~0ULL << (current + 1));
+        uint64_t lap = (wheel->now >> (shift + TIMER_WHEEL_BITS)) << (shift + TIMER_WHEEL_BITS); // Start of this turn of the level
+        uint64_t tick = ahead != 0 ? lap | ((uint64_t)__builtin_ctzll(ahead) << shift)
+                                   : (lap + (1ULL << (shift + TIMER_WHEEL_BITS))) | ((uint64_t)__builtin_ctzll(bits) << shift); // Parked for the next turn
+        if (tick < next) next = tick;
+    }
+    return next;
+}
+
+// Function to advance the clock, jumping straight from one tick with work to the next
+void timerWheelAdvance(TimerWheel* wheel, uint64_t now) {
+    uint64_t tick;
+    while ((tick = timerWheelNextTick(wheel)) <= now) {
+        wheel->now = tick;
+        // Move the timers of every higher slot starting at this tick down, the highest level first
+        for (int level = TIMER_WHEEL_LEVELS - 1; level >= 1; level--) {
+            int shift = level * TIMER_WHEEL_BITS;
+            if (tick & ((1ULL << shift) - 1)) continue; // Not the start of a slot of this level
+            TimerNode* list = takeSlot(wheel, level, (int)((tick >> shift) & (TIMER_WHEEL_SLOTS - 1)));
+            while (list != NULL) {
+                TimerNode* next = list->next;
+                placeNode(wheel, list, list->expiry);
+                list = next;
+            }
+        }
+        // Hand the timers due now over; ones parked beyond the wheel go back on it
+        TimerNode* list = takeSlot(wheel, 0, (int)(tick & (TIMER_WHEEL_SLOTS - 1)));
+        while (list != NULL) {
+            TimerNode* next = list->next;
+            if (list->expiry > tick) placeNode(wheel, list, list->expiry);
+            else pushNode(&wheel->expired, list, -1);
+            list = next;
+        }
+    }
+    if (now > wheel->now) wheel->now = now;
+}
@@ -0,0 +1,50 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h> // For uint64_t
+
+// Hierarchical timer wheel: TIMER_WHEEL_LEVELS levels of 64 slots, level n holding the timers due
+// within 64^(n+1) ticks. Adding and removing a timer are O(1); a timer moves down one level each
+// time its slot comes up, so it is touched at most once per level before it expires. A bitmap of
+// the occupied slots of every level finds the next due slot without scanning, so an idle wheel
+// costs nothing however far the clock jumps. Not thread-safe: the owner serializes every call.
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 6 // With millisecond ticks the wheel spans more than two years
+
+// Link embedded in every timer
+typedef struct TimerNode {
+    struct TimerNode* next;      // Next timer in the same slot or in the expired list
+    struct TimerNode** previous; // Pointer that points at this node, NULL while not linked
+    uint64_t expiry;             // Tick the timer is due at
+    int slot;                    // Index into slots, -1 in the expired list
+} TimerNode;
+
+// Wheel state; the caller allocates it and calls timerWheelInit
+typedef struct TimerWheel {
+    uint64_t now;                // Last tick advanced to
+    TimerNode* slots[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS]; // Timers by level and slot
+    uint64_t occupied[TIMER_WHEEL_LEVELS]; // Bit s of level n is set while slot s holds timers
+    TimerNode* expired;          // Timers taken off the wheel by timerWheelAdvance, in no particular order
+} TimerWheel;
+
+// Prepares an empty wheel whose clock starts at now
+void timerWheelInit(TimerWheel* wheel, uint64_t now);
+
+// Links a timer due at expiry; one due now or earlier expires on the next advance
+void timerWheelAdd(TimerWheel* wheel, TimerNode* node, uint64_t expiry);
+
+// Unlinks a timer from its slot or from the expired list; does nothing if it is not linked
+void timerWheelRemove(TimerWheel* wheel, TimerNode* node);
+
+// Returns non-zero while a timer is on the wheel or in the expired list
+int timerWheelLinked(const TimerNode* node);
+
+// Moves the clock to now and every timer that came due to the expired list
+void timerWheelAdvance(TimerWheel* wheel, uint64_t now);
+
+// Returns the tick something has to happen at (a timer expiring or moving down a level),
+// or UINT64_MAX when the wheel is empty
+uint64_t timerWheelNextTick(const TimerWheel* wheel);
+
+#endif // TIMER_WHEEL_H
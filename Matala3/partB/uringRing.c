@@ -0,0 +1,112 @@
+#include "uringRing.h"   // Include the ring header
+#include <string.h>      // Include for memset
+#include <unistd.h>      // Include for syscall and close
+#include <errno.h>       // Include for errno values
+#include <sys/mman.h>    // Include for mmap used to map the rings
+#include <sys/syscall.h> // Include for the io_uring system call numbers
+
+// Function to create and map the ring
+int uringSetup(UringRing* ring, unsigned submissionEntries, unsigned completionEntries) {
+    struct io_uring_params params;
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE; // Completions outnumber submissions: every socket keeps a recv posted
+    params.cq_entries = completionEntries;
+
+    ring->ringDescriptor = (int)syscall(__NR_io_uring_setup, submissionEntries, &params);
+    if (ring->ringDescriptor < 0) return -1; // Kernel without io_uring, or io_uring disabled
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) {
+        close(ring->ringDescriptor); // Too old a kernel: keep the mapping code simple and never lose completions
+        errno = ENOSYS;
+        return -1;
+    }
+
+    // Map the submission and completion rings, which share one mapping
+    size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->ringMapSize = sqSize > cqSize ? sqSize : cqSize;
+    ring->ringMap = mmap(NULL, ring->ringMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->ringDescriptor, IORING_OFF_SQ_RING);
+    if (ring->ringMap == MAP_FAILED) {
+        close(ring->ringDescriptor);
+        return -1;
+    }
+
+    // Map the submission entries themselves
+    ring->sqesMapSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqesMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->ringDescriptor, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        munmap(ring->ringMap, ring->ringMapSize);
+        close(ring->ringDescriptor);
+        return -1;
+    }
+
+    char* base = (char*)ring->ringMap;
+    ring->sqHead = (unsigned*)(base + params.sq_off.head);
+    ring->sqTail = (unsigned*)(base + params.sq_off.tail);
+    ring->sqMask = (unsigned*)(base + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned*)(base + params.sq_off.array);
+    ring->sqEntries = params.sq_entries;
+    ring->cqHead = (unsigned*)(base + params.cq_off.head);
+    ring->cqTail = (unsigned*)(base + params.cq_off.tail);
+    ring->cqMask = (unsigned*)(base + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(base + params.cq_off.cqes);
+    return 0;
+}
+
+// Function to reserve the next submission entry
+struct io_uring_sqe* uringGetSqe(UringRing* ring) {
+    unsigned tail = *ring->sqTail;
+    if (tail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) >= ring->sqEntries) {
+        if (uringSubmit(ring) < 0) return NULL; // Make room by handing the queue to the kernel
+        if (tail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) >= ring->sqEntries) return NULL;
+    }
+    unsigned index = tail & *ring->sqMask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sqArray[index] = index;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE); // Publish the entry to the kernel
+    ring->pendingSubmissions++;
+    return sqe;
+}
+
+// Function to submit every pending entry in one io_uring_enter call
+int uringSubmit(UringRing* ring) {
+    while (ring->pendingSubmissions > 0) {
+        int submitted = (int)syscall(__NR_io_uring_enter, ring->ringDescriptor, ring->pendingSubmissions, 0, 0, NULL, 0);
+        if (submitted < 0) {
+            if (errno == EINTR) continue; // Interrupted, try again
+            if (errno == EAGAIN || errno == EBUSY) return 0; // Kernel is busy; the entries stay queued
+            return -1;
+        }
+        ring->pendingSubmissions -= (unsigned)submitted;
+        return submitted;
+    }
+    return 0;
+}
+
+// Function to look at the oldest completion
+struct io_uring_cqe* uringPeekCqe(UringRing* ring) {
+    unsigned head = *ring->cqHead;
+    if (head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) return NULL; // Nothing completed
+    return &ring->cqes[head & *ring->cqMask];
+}
+
+// Function to release the oldest completion back to the kernel
+void uringCqeSeen(UringRing* ring) {
+    __atomic_store_n(ring->cqHead, *ring->cqHead + 1, __ATOMIC_RELEASE);
+}
+
+// Function to attach an eventfd that is signalled on every completion
+int uringRegisterEventfd(UringRing* ring, int eventDescriptor) {
+    return (int)syscall(__NR_io_uring_register, ring->ringDescriptor, IORING_REGISTER_EVENTFD, &eventDescriptor, 1);
+}
+
+// Function to release the ring
+void uringTeardown(UringRing* ring) {
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED) munmap(ring->sqes, ring->sqesMapSize);
+    if (ring->ringMap != NULL && ring->ringMap != MAP_FAILED) munmap(ring->ringMap, ring->ringMapSize);
+    close(ring->ringDescriptor);
+    memset(ring, 0, sizeof(*ring));
+}
@@ -0,0 +1,45 @@
+#ifndef URING_RING_H
+#define URING_RING_H
+
+#include <stddef.h>         // For size_t
+#include <linux/io_uring.h> // For the io_uring structures and opcodes
+
+// Minimal io_uring ring built on the raw system calls, so the proactor does not depend on liburing.
+// The submission side is not thread-safe; callers serialize uringGetSqe/uringSubmit themselves.
+typedef struct UringRing {
+    int ringDescriptor;           // Descriptor returned by io_uring_setup
+    unsigned *sqHead, *sqTail;    // Submission queue indexes shared with the kernel
+    unsigned *sqMask, *sqArray;   // Submission queue mask and index array
+    unsigned sqEntries;           // Number of submission queue entries
+    struct io_uring_sqe* sqes;    // Submission queue entries
+    unsigned *cqHead, *cqTail;    // Completion queue indexes shared with the kernel
+    unsigned *cqMask;             // Completion queue mask
+    struct io_uring_cqe* cqes;    // Completion queue entries
+    void* ringMap;                // Mapping holding both rings (IORING_FEAT_SINGLE_MMAP)
+    size_t ringMapSize;           // Size of ringMap
+    size_t sqesMapSize;           // Size of the sqes mapping
+    unsigned pendingSubmissions;  // Entries filled but not yet handed to the kernel
+} UringRing;
+
+// Creates a ring with the given number of submission and completion entries. Returns 0 or -1 with errno set.
+int uringSetup(UringRing* ring, unsigned submissionEntries, unsigned completionEntries);
+
+// Returns a zeroed submission entry, submitting pending ones first when the queue is full; NULL on failure
+struct io_uring_sqe* uringGetSqe(UringRing* ring);
+
+// Hands every pending submission entry to the kernel with one system call. Returns the number submitted or -1.
+int uringSubmit(UringRing* ring);
+
+// Returns the oldest unseen completion entry, or NULL when the completion queue is empty
+struct io_uring_cqe* uringPeekCqe(UringRing* ring);
+
+// Marks the entry returned by uringPeekCqe as consumed
+void uringCqeSeen(UringRing* ring);
+
+// Makes the kernel signal the eventfd whenever a completion is posted. Returns 0 or -1.
+int uringRegisterEventfd(UringRing* ring, int eventDescriptor);
+
+// Unmaps the rings and closes the ring descriptor
+void uringTeardown(UringRing* ring);
+
+#endif // URING_RING_H
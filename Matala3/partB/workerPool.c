@@ -0,0 +1,201 @@
+#include "workerPool.h" // Include the worker pool header
+#include <pthread.h>    // Include for POSIX threads
+#include <stdio.h>      // Include for perror
+#include <stdlib.h>     // Include for malloc and free
+#include <unistd.h>     // Include for sysconf
+
+#define INITIAL_DEQUE_CAPACITY 64 // Initial number of task slots per worker deque
+
+// Structure representing one queued task
+typedef struct WorkerTask {
+    WorkerTaskFunction function; // Function to run
+    void* argument;              // Argument passed to the function
+} WorkerTask;
+
+// Structure representing a worker and its double-ended task queue.
+// The owner takes tasks from the front while thieves take them from the back.
+typedef struct Worker {
+    pthread_mutex_t dequeMutex; // Mutex protecting the deque
+    WorkerTask* tasks;          // Ring buffer of tasks
+    int capacity;               // Number of slots in the ring buffer
+    int head;                   // Index of the front task
+    int count;                  // Number of queued tasks
+    pthread_t thread;           // Thread running the worker
+    struct WorkerPool* pool;    // Pool the worker belongs to
+    int index;                  // Position of the worker in the pool
+} Worker;
+
+// Structure representing the whole pool
+struct WorkerPool {
+    Worker* workers;            // Array of workers
+    int workerCount;            // Number of workers
+    unsigned int nextWorker;    // Round-robin cursor used by submitWorkerTask
+    int queuedTasks;            // Tasks queued on all deques together
+    int idleWorkers;            // Workers sleeping on wakeCondition
+    int stopping;               // Set when the pool is being destroyed
+    pthread_mutex_t sleepMutex; // Mutex paired with wakeCondition
+    pthread_cond_t wakeCondition; // Condition idle workers sleep on
+};
+
+// Helper function to append a task to the back of a deque, growing it when full
+static int pushTask(Worker* worker, WorkerTask task) {
+    pthread_mutex_lock(&worker->dequeMutex);
+    if (worker->count == worker->capacity) {
+        int newCapacity = worker->capacity * 2; // Double the ring buffer
+        WorkerTask* newTasks = (WorkerTask*)malloc(newCapacity * sizeof(WorkerTask));
+        if (newTasks == NULL) {
+            pthread_mutex_unlock(&worker->dequeMutex);
+            return -1; // Out of memory
+        }
+        for (int i = 0; i < worker->count; i++) {
+            newTasks[i] = worker->tasks[(worker->head + i) % worker->capacity]; // Unwrap the ring
+        }
+        free(worker->tasks);
+        worker->tasks = newTasks;
+        worker->capacity = newCapacity;
+        worker->head = 0;
+    }
+    worker->tasks[(worker->head + worker->count) % worker->capacity] = task; // Store at the back
+    worker->count++;
+    pthread_mutex_unlock(&worker->dequeMutex);
+    return 0;
+}
+
+// Helper function to take a task from the front (owner) or the back (thief) of a deque
+static int takeTask(Worker* worker, WorkerTask* task, int fromBack) {
+    int taken = 0;
+    pthread_mutex_lock(&worker->dequeMutex);
+    if (worker->count > 0) {
+        if (fromBack) {
+            *task = worker->tasks[(worker->head + worker->count - 1) % worker->capacity];
+        } else {
+            *task = worker->tasks[worker->head];
+            worker->head = (worker->head + 1) % worker->capacity;
+        }
+        worker->count--;
+        taken = 1;
+    }
+    pthread_mutex_unlock(&worker->dequeMutex);
+    return taken;
+}
+
+// Helper function to find work: first on the worker's own deque, then on its neighbours'
+static int findTask(Worker* self, WorkerTask* task) {
+    WorkerPool* pool = self->pool;
+    if (takeTask(self, task, 0)) return 1; // Own work first, oldest task first
+    for (int offset = 1; offset < pool->workerCount; offset++) {
+        Worker* victim = &pool->workers[(self->index + offset) % pool->workerCount];
+        if (takeTask(victim, task, 1)) return 1; // Steal the newest task of a busy worker
+    }
+    return 0;
+}
+
+// Thread function executed by every worker
+static void* workerThread(void* arg) {
+    Worker* self = (Worker*)arg;
+    WorkerPool* pool = self->pool;
+    WorkerTask task;
+
+    while (1) {
+        if (findTask(self, &task)) {
+            __atomic_sub_fetch(&pool->queuedTasks, 1, __ATOMIC_SEQ_CST);
+            task.function(task.argument); // Run the task outside every lock
+            continue;
+        }
+
+        // Nothing to run or steal: sleep until a task is submitted
+        pthread_mutex_lock(&pool->sleepMutex);
+        __atomic_add_fetch(&pool->idleWorkers, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&pool->queuedTasks, __ATOMIC_SEQ_CST) == 0 && !pool->stopping) {
+            pthread_cond_wait(&pool->wakeCondition, &pool->sleepMutex);
+        }
+        __atomic_sub_fetch(&pool->idleWorkers, 1, __ATOMIC_SEQ_CST);
+        int finished = pool->stopping && __atomic_load_n(&pool->queuedTasks, __ATOMIC_SEQ_CST) == 0;
+        pthread_mutex_unlock(&pool->sleepMutex);
+        if (finished) return NULL; // Shutting down and every task has run
+    }
+}
+
+// Function to create the worker pool
+WorkerPool* createWorkerPool(int workerCount) {
+    if (workerCount <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN); // One worker per online core by default
+        workerCount = cores > 0 ? (int)cores : 1;
+    }
+
+    WorkerPool* pool = (WorkerPool*)calloc(1, sizeof(WorkerPool));
+    if (pool == NULL) return NULL;
+    pool->workers = (Worker*)calloc(workerCount, sizeof(Worker));
+    if (pool->workers == NULL) {
+        free(pool);
+        return NULL;
+    }
+    pool->workerCount = workerCount;
+    pthread_mutex_init(&pool->sleepMutex, NULL);
+    pthread_cond_init(&pool->wakeCondition, NULL);
+
+    // Prepare every deque before any thread can start stealing from it
+    for (int i = 0; i < workerCount; i++) {
+        Worker* worker = &pool->workers[i];
+        pthread_mutex_init(&worker->dequeMutex, NULL);
+        worker->tasks = (WorkerTask*)malloc(INITIAL_DEQUE_CAPACITY * sizeof(WorkerTask));
+        worker->capacity = INITIAL_DEQUE_CAPACITY;
+        worker->pool = pool;
+        worker->index = i;
+        if (worker->tasks == NULL) {
+            perror("Error allocating worker deque");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < workerCount; i++) {
+        if (pthread_create(&pool->workers[i].thread, NULL, workerThread, &pool->workers[i]) != 0) {
+            perror("Error creating worker thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return pool;
+}
+
+// Function to queue a task on the pool
+int submitWorkerTask(WorkerPool* pool, WorkerTaskFunction function, void* argument) {
+    WorkerTask task = { function, argument };
+    unsigned int index = __atomic_fetch_add(&pool->nextWorker, 1, __ATOMIC_RELAXED) % pool->workerCount;
+    if (pushTask(&pool->workers[index], task) != 0) return -1;
+
+    // Publish the task before looking for sleepers so no wake-up can be lost
+    __atomic_add_fetch(&pool->queuedTasks, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->idleWorkers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->sleepMutex);
+        pthread_cond_signal(&pool->wakeCondition);
+        pthread_mutex_unlock(&pool->sleepMutex);
+    }
+    return 0;
+}
+
+// Function to report the number of workers
+int workerPoolSize(const WorkerPool* pool) {
+    return pool->workerCount;
+}
+
+// Function to stop the workers and free the pool
+void destroyWorkerPool(WorkerPool* pool) {
+    if (pool == NULL) return;
+
+    // Tell the workers to leave once the deques are empty
+    pthread_mutex_lock(&pool->sleepMutex);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->wakeCondition);
+    pthread_mutex_unlock(&pool->sleepMutex);
+
+    for (int i = 0; i < pool->workerCount; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    for (int i = 0; i < pool->workerCount; i++) {
+        pthread_mutex_destroy(&pool->workers[i].dequeMutex);
+        free(pool->workers[i].tasks);
+    }
+    pthread_cond_destroy(&pool->wakeCondition);
+    pthread_mutex_destroy(&pool->sleepMutex);
+    free(pool->workers);
+    free(pool);
+}
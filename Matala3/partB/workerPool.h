@@ -0,0 +1,23 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+// Function type for tasks executed by the worker pool
+typedef void (*WorkerTaskFunction)(void*);
+
+// Opaque fixed-size pool of worker threads with per-worker work-stealing deques
+typedef struct WorkerPool WorkerPool;
+
+// Creates a pool with the given number of workers (0 or less means one per online core)
+WorkerPool* createWorkerPool(int workerCount);
+
+// Queues a task on the next worker's deque; idle workers steal it if that worker is busy.
+// Returns 0 on success and -1 if the task could not be queued.
+int submitWorkerTask(WorkerPool* pool, WorkerTaskFunction function, void* argument);
+
+// Returns the number of worker threads in the pool
+int workerPoolSize(const WorkerPool* pool);
+
+// Runs every task still queued, stops the workers and frees the pool
+void destroyWorkerPool(WorkerPool* pool);
+
+#endif // WORKER_POOL_H
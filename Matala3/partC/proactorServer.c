@@ -1,3 +1,4 @@
+#define _GNU_SOURCE      // For close_range
 #include <stdio.h>       // Standard input/output library
 #include <stdlib.h>      // Standard library for memory allocation, process control, etc.
 #include <unistd.h>      // POSIX operating system API
@@ -5,128 +6,660 @@
 #include <sys/socket.h>  // Socket API
 #include <netinet/in.h>  // Internet address family
 #include <pthread.h>     // POSIX threads library
-#include "/home/roy/Desktop/OperationS3/partB/proactor.h" // Include the proactor header file
+#include <signal.h>      // Signal masks for the shutdown and restart signals
+#include <sys/signalfd.h> // Signals read as a descriptor by the main loop
+#include <poll.h>        // Waiting on the listener and the signals together
+#include <fcntl.h>       // Descriptor flags of the listener and the handoff socket
+#include <errno.h>       // Error numbers of accept and poll
+#include <limits.h>      // PATH_MAX for the path of the running executable
+#include <time.h>        // Monotonic clock for the drain deadline
+#include <stdint.h>      // Fixed-size fields of the handoff records
+#include <sys/wait.h>    // Reaping a restarted server that failed to start
+#include "proactor.h"    // Include the proactor library header
+#include "broadcastGroup.h" // Include the recipient snapshots used for broadcasting
+#include "chatFrame.h"   // Include the framing of the messages exchanged with the clients
+#include "proactorLog.h"  // Include the buffered logging that keeps stdout off the hot path
+#include "memoryPool.h"  // Include the slab pool the per-client state comes from
 
 #define PORT 8080        // Define the port number for server to listen on
-#define MAX_CLIENTS 100  // Maximum number of clients that can be connected
-#define BUFFER_SIZE 1024 // Define buffer size for messages
-
-int client_sockets[MAX_CLIENTS]; // Array to store client socket descriptors
-int num_clients = 0;             // Counter for the number of connected clients
-pthread_mutex_t client_list_mutex = PTHREAD_MUTEX_INITIALIZER; // Mutex for thread-safe client list operations
-
-// Function to add a new client socket to the list
-void add_client_socket(int client_socket) {
-    pthread_mutex_lock(&client_list_mutex); // Lock the mutex for safe operation
-    if (num_clients < MAX_CLIENTS) {
-        client_sockets[num_clients++] = client_socket; // Add new client socket to the list
-    } else {
-        printf("Max clients reached. Cannot add more.\n"); // Print message if max clients reached
+#define OUTPUT_HIGH_WATERMARK (256 * 1024) // Unsent bytes a client may fall behind before the slow-consumer policy applies
+#define OUTPUT_LOW_WATERMARK (64 * 1024)   // Backlog a paused sender waits for
+#define MAX_MESSAGE_SIZE 4096 // Longest message text accepted from a client
+#define ADMIN_SOCKET_PATH "/tmp/proactorServer.sock" // Unix socket answering with the metrics, e.g. nc -U
+
+// Dead peers: a client that stays silent gets a ping, and one that stays silent for the idle timeout is dropped
+#ifndef HEARTBEAT_INTERVAL_MS
+#define HEARTBEAT_INTERVAL_MS 30000 // Silence after which a client is pinged
+#endif
+#ifndef IDLE_TIMEOUT_MS
+#define IDLE_TIMEOUT_MS 90000       // Silence after which a client is disconnected
+#endif
+
+// Shutdown: SIGTERM or SIGINT drains and exits, SIGUSR2 hands every connection to a freshly started copy of the server
+#define DRAIN_TIMEOUT_MS 5000     // Time queued output gets to reach the clients before they are closed
+#define HANDOFF_TIMEOUT_MS 10000  // Time a restarted server gets to start up and ask for the connections
+#define HANDOFF_ENV "CHAT_HANDOFF_FD" // Environment variable telling a restarted server where its connections come from
+#define HANDOFF_FD 3              // Descriptor the restarted server receives the handoff socket on
+#define HANDOFF_READY 'R'         // Byte the restarted server sends once it is ready to take over
+#define HANDOFF_LISTENER 1        // Handoff record carrying the listening socket
+#define HANDOFF_CLIENT 2          // Handoff record carrying a client and what it sent that was not handled yet
+
+#define FORMAT_LINE 0    // Message variant for clients reading newline-terminated text
+#define FORMAT_FRAMED 1  // Message variant for clients reading length-prefixed frames
+
+BroadcastGroup* clients; // Connected clients and the format each reads; broadcasts use a snapshot and never lock the list
+ProactorMessage* ping_messages[2]; // Heartbeat in each format, indexed by FORMAT_*
+ProactorMessage* pong_messages[2]; // Answer to a client's ping in each format
+
+// Application metrics reported next to the proactor's own on the admin socket
+int clients_gauge = -1;           // Connected clients
+int messages_received_counter = -1; // Text messages received
+int broadcasts_counter = -1;      // Messages broadcast, announcements included
+
+// Per-client state the proactor hands back to the callback as the registration context
+typedef struct client_state {
+    int socket;              // Client socket
+    ChatFrameParser parser;  // Splits what the client sends into messages, across reads
+    struct client_state* prev; // Neighbours in the list of live clients
+    struct client_state* next;
+} client_state;
+
+// Record sent ahead of every descriptor handed to a restarted server
+typedef struct {
+    int kind;            // HANDOFF_LISTENER or HANDOFF_CLIENT
+    int mode;            // CHAT_MODE_* the client's parser settled on
+    uint32_t pending_len; // Bytes of an unfinished message following the record
+} handoff_record;
+
+// Live clients, so a shutdown can find them; the broadcast group only knows their sockets
+client_state* client_list = NULL;
+pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER; // Guards client_list and the two flags below
+int draining = 0;     // New connections are refused while the server shuts down
+int handing_off = 0;  // New connections go straight to the restarted server
+int handoff_fd = -1;  // Socket connecting the old and the restarted server during a hot restart
+int server_fd = -1;   // Listener of the single-loop mode, -1 in multi-reactor mode
+
+// Function to add a new client socket to the list; the list grows with the clients, so only running out of memory refuses one.
+// Returns -1 when the client could not be added.
+int add_client_socket(int client_socket, int format) {
+    if (broadcastGroupAddWithFormat(clients, client_socket, format) < 0) { // Add new client socket to the list; a new client reads lines until it sends a frame
+        proactorLog(PROACTOR_LOG_WARN, "Could not add client %d to the list\n", client_socket); // Print message if the list cannot grow
+        return -1;
     }
-    pthread_mutex_unlock(&client_list_mutex); // Unlock the mutex
+    proactorCounterAdd(clients_gauge, 1);
+    return 0;
 }
 
 // Function to remove a client socket from the list
 void remove_client_socket(int client_socket) {
-    pthread_mutex_lock(&client_list_mutex); // Lock the mutex for safe operation
-    for (int i = 0; i < num_clients; i++) {
-        if (client_sockets[i] == client_socket) {
-            client_sockets[i] = client_sockets[num_clients - 1]; // Replace the socket with the last in the list
-            num_clients--; // Decrement the client count
-            break; // Exit the loop
-        }
+    if (broadcastGroupRemove(clients, client_socket) == 0) proactorCounterAdd(clients_gauge, -1); // Broadcasts in progress keep their snapshot
+}
+
+// Function to link a client into the list of live clients; called with clients_mutex held
+void link_client(client_state* client) {
+    client->prev = NULL;
+    client->next = client_list;
+    if (client_list != NULL) client_list->prev = client;
+    client_list = client;
+}
+
+// Function to unlink a client from the list of live clients
+void unlink_client(client_state* client) {
+    pthread_mutex_lock(&clients_mutex);
+    if (client->prev != NULL) client->prev->next = client->next;
+    else client_list = client->next;
+    if (client->next != NULL) client->next->prev = client->prev;
+    pthread_mutex_unlock(&clients_mutex);
+}
+
+// Function to find the state of a live client by its socket
+client_state* find_client(int socket) {
+    pthread_mutex_lock(&clients_mutex);
+    client_state* client = client_list;
+    while (client != NULL && client->socket != socket) client = client->next;
+    pthread_mutex_unlock(&clients_mutex);
+    return client;
+}
+
+// Function to free the state of a client that is no longer registered
+void free_client(client_state* client) {
+    chatFrameParserDestroy(&client->parser);
+    memoryPoolFree(client);
+}
+
+// Function to broadcast a message to all clients except the sender.
+// The text is copied once; line clients get it as a line, framed clients get a frame header in front of the same bytes.
+void broadcast_message(int sender_socket, int type, const char* message, size_t message_len) {
+    char prefix[48]; // Buffer for the "Client N: " prefix
+    int prefix_len;
+    if (type == CHAT_FRAME_JOIN) {
+        prefix_len = snprintf(prefix, sizeof(prefix), "Client %d joined the chat", sender_socket); // Announce the join
+        message_len = 0;
+    } else if (type == CHAT_FRAME_SIGNOUT) {
+        prefix_len = snprintf(prefix, sizeof(prefix), "Client %d left the chat", sender_socket); // Announce the sign-out
+        message_len = 0;
+    } else {
+        prefix_len = snprintf(prefix, sizeof(prefix), "Client %d: ", sender_socket); // Format the prefix
+    }
+    struct iovec parts[3] = { // Prefix, message and line end, sent together without being joined
+        { .iov_base = prefix, .iov_len = prefix_len },
+        { .iov_base = (void*)message, .iov_len = message_len },
+        { .iov_base = "\n", .iov_len = 1 }
+    };
+    ProactorMessage* payload = createProactorMessage(parts, 2); // One copy shared by every framed recipient
+    ProactorMessage* variants[2]; // Indexed by FORMAT_*
+    variants[FORMAT_LINE] = createProactorMessage(parts, 3); // And one shared by every line recipient
+    unsigned char header[CHAT_FRAME_HEADER_SIZE];
+    variants[FORMAT_FRAMED] = payload == NULL ? NULL :
+        createFramedProactorMessage(header, chatFrameEncodeHeader(header, type, proactorMessageLength(payload)), payload);
+    if (variants[FORMAT_LINE] == NULL || variants[FORMAT_FRAMED] == NULL) {
+        perror("createProactorMessage"); // Print error message if allocation fails
+    } else {
+        broadcastGroupSendFormats(clients, sender_socket, variants, 2); // Queue it for the other clients
+        proactorCounterAdd(broadcasts_counter, 1);
     }
-    pthread_mutex_unlock(&client_list_mutex); // Unlock the mutex
+    releaseProactorMessage(payload); // The output queues keep their own references
+    releaseProactorMessage(variants[FORMAT_LINE]);
+    releaseProactorMessage(variants[FORMAT_FRAMED]);
 }
 
-// Function to broadcast a message to all clients except the sender
-void broadcast_message(int sender_socket, const char* message) {
-    pthread_mutex_lock(&client_list_mutex); // Lock the mutex for safe operation
-    for (int i = 0; i < num_clients; i++) {
-        if (client_sockets[i] != sender_socket) {
-            char full_message[BUFFER_SIZE]; // Buffer to store the full message
-            snprintf(full_message, BUFFER_SIZE, "Client %d: %s", sender_socket, message); // Format the message
-            write(client_sockets[i], full_message, strlen(full_message)); // Send the message to client
-        }
+// Function to act on one message a client sent
+void handle_client_message(void* context, int type, const char* message, size_t message_len) {
+    client_state* client = (client_state*)context;
+    if (type == CHAT_FRAME_PING) { // The client checks that the server is alive
+        proactorSendMessage(client->socket, pong_messages[client->parser.mode == CHAT_MODE_FRAMED ? FORMAT_FRAMED : FORMAT_LINE]);
+        return;
+    }
+    if (type != CHAT_FRAME_TEXT && type != CHAT_FRAME_JOIN && type != CHAT_FRAME_SIGNOUT) return; // This server has no rooms
+    if (type == CHAT_FRAME_TEXT) {
+        proactorLog(PROACTOR_LOG_INFO, "Received message from Client %d: %.*s\n", client->socket, (int)message_len, message); // Print the message
+        proactorCounterAdd(messages_received_counter, 1);
     }
-    pthread_mutex_unlock(&client_list_mutex); // Unlock the mutex
+    broadcast_message(client->socket, type, message, message_len); // Broadcast the message to other clients
 }
 
-// Callback function to handle socket activity
-void socketCallback(int sockfd) {
-    while (1) {
-        char buffer[BUFFER_SIZE]; // Buffer for storing received messages
-        int readBytes = read(sockfd, buffer, BUFFER_SIZE); // Read data from socket
-        if (readBytes <= 0) {
-            printf("Client %d disconnected or error occurred\n", sockfd); // Print disconnect message
-            remove_client_socket(sockfd); // Remove client from list
-            close(sockfd); // Close the client socket
-            break; // Exit the loop
-        } else {
-            buffer[readBytes] = '\0'; // Null-terminate the received message
-            printf("Received message from Client %d: %s\n", sockfd, buffer); // Print the message
-            broadcast_message(sockfd, buffer); // Broadcast the message to other clients
+// Callback function run by the proactor with the bytes it read from a client
+void socketCallback(ProactorEventInfo* info) {
+    client_state* client = (client_state*)info->context;
+    if (info->data_len > 0) {
+        int previous_mode = client->parser.mode;
+        if (chatFrameParserFeed(&client->parser, info->data, info->data_len, handle_client_message, client) < 0) {
+            proactorLog(PROACTOR_LOG_WARN, "Client %d broke the protocol\n", info->socket); // Print protocol error
+            shutdown(info->socket, SHUT_RDWR); // The hang-up that follows removes and closes the client
+        }
+        if (previous_mode == CHAT_MODE_UNKNOWN && client->parser.mode == CHAT_MODE_FRAMED) {
+            broadcastGroupSetFormat(clients, info->socket, FORMAT_FRAMED); // The client speaks frames, so send it frames
+            setSocketIdleTimeout(info->socket, IDLE_TIMEOUT_MS, HEARTBEAT_INTERVAL_MS, ping_messages[FORMAT_FRAMED]); // And frame its pings
         }
     }
+    if (info->events & (PROACTOR_EVENT_HANGUP | PROACTOR_EVENT_ERROR)) {
+        proactorLog(PROACTOR_LOG_INFO, "Client %d disconnected or error occurred\n", info->socket); // Print disconnect message
+        remove_client_socket(info->socket); // Remove client from list; the proactor closes the socket
+        unlink_client(client);
+        free_client(client); // Free the client's state
+    }
 }
 
-// Wrapper function for pthread_create compatibility
-void *socketCallbackWrapper(void *arg) {
-    int sockfd = (int)(intptr_t)arg; // Convert argument back to socket descriptor
-    socketCallback(sockfd); // Call the socket callback function
-    return NULL; // Return NULL as required by pthread_create
+// Function to start serving a client, new or handed over by the server this one replaced: mode and the
+// unfinished message pending are what its parser had reached. Called with clients_mutex held.
+void start_client(int new_socket, int mode, const char* pending, size_t pending_len) {
+    client_state* client = memoryPoolAlloc(sizeof(client_state)); // State freed by the hang-up callback
+    if (client == NULL) {
+        perror("memoryPoolAlloc"); // Print error message if allocation fails
+        close(new_socket); // Close the client socket
+        return;
+    }
+    client->socket = new_socket;
+    chatFrameParserInit(&client->parser, MAX_MESSAGE_SIZE);
+    client->parser.mode = mode;
+    if (pending_len > 0 && chatFrameParserFeed(&client->parser, pending, pending_len, handle_client_message, client) < 0) {
+        free_client(client); // Cannot happen with what the previous server buffered, but never trust it
+        close(new_socket);
+        return;
+    }
+    int format = mode == CHAT_MODE_FRAMED ? FORMAT_FRAMED : FORMAT_LINE;
+    if (add_client_socket(new_socket, format) < 0) { // Add before registering, so the hang-up callback always finds it
+        free_client(client); // A client left out of the list would never receive a broadcast: refuse it
+        close(new_socket); // Close the client socket
+        return;
+    }
+    link_client(client);
+
+    // Let the proactor read the client and run the callback with the received bytes
+    if (registerSocketWithContext(new_socket, socketCallback, client,
+                                  PROACTOR_COMPLETION | PROACTOR_CLOSE_ON_HANGUP) < 0) {
+        perror("registerSocketWithContext"); // Print error message if registration fails
+        remove_client_socket(new_socket); // Forget the client again
+        client_list = client->next; // Still first: the mutex is held
+        if (client_list != NULL) client_list->prev = NULL;
+        free_client(client);
+        close(new_socket); // Close the client socket
+        return;
+    }
+    // Ping the client when it goes quiet and drop it when it stays quiet, so half-open connections are reclaimed
+    setSocketIdleTimeout(new_socket, IDLE_TIMEOUT_MS, HEARTBEAT_INTERVAL_MS, ping_messages[format]);
 }
 
-int main() {
-    int server_fd, new_socket; // Socket descriptors for the server and new client
-    struct sockaddr_in address; // Structure for the server address
-    int addrlen = sizeof(address); // Length of the server address
+// Function to send a descriptor to the restarted server, with the record describing it and the bytes that follow it
+int send_handoff(int kind, int descriptor, int mode, const char* pending, size_t pending_len) {
+    handoff_record record = { .kind = kind, .mode = mode, .pending_len = (uint32_t)pending_len };
+    struct iovec parts[2] = {
+        { .iov_base = &record, .iov_len = sizeof(record) },
+        { .iov_base = (void*)pending, .iov_len = pending_len }
+    };
+    char control[CMSG_SPACE(sizeof(int))]; // Room for one descriptor
+    memset(control, 0, sizeof(control));
+    struct msghdr message = { .msg_iov = parts, .msg_iovlen = pending_len > 0 ? 2 : 1,
+                              .msg_control = control, .msg_controllen = sizeof(control) };
+    struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS; // The kernel duplicates the descriptor into the receiving process
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(header), &descriptor, sizeof(int));
+    while (sendmsg(handoff_fd, &message, MSG_NOSIGNAL) < 0) {
+        if (errno == EINTR) continue;
+        perror("sendmsg"); // Print error message if the restarted server went away
+        return -1;
+    }
+    return 0;
+}
+
+// Function to take over a connection accepted by the main loop or by one of the reactors
+void accept_client(int new_socket, void* context) {
+    (void)context; // Unused
+    pthread_mutex_lock(&clients_mutex); // Held until the client is listed, so a shutdown sees every client it has to handle
+    if (draining) {
+        pthread_mutex_unlock(&clients_mutex);
+        close(new_socket); // Shutting down: refuse the client
+        return;
+    }
+    if (handing_off) {
+        pthread_mutex_unlock(&clients_mutex);
+        send_handoff(HANDOFF_CLIENT, new_socket, CHAT_MODE_UNKNOWN, NULL, 0); // The restarted server serves it
+        close(new_socket); // Our copy of the descriptor
+        return;
+    }
+    proactorLog(PROACTOR_LOG_INFO, "Client %d connected\n", new_socket); // Print message indicating new client connected
+    start_client(new_socket, CHAT_MODE_UNKNOWN, NULL, 0);
+    pthread_mutex_unlock(&clients_mutex);
+}
 
-    // Initialize Proactor
-    initializeProactor();
+// Function to create a heartbeat message in both formats
+void create_heartbeat(ProactorMessage* variants[2], int type, const char* line) {
+    struct iovec part = { .iov_base = (void*)line, .iov_len = strlen(line) };
+    unsigned char header[CHAT_FRAME_HEADER_SIZE];
+    variants[FORMAT_LINE] = createProactorMessage(&part, 1);
+    part.iov_base = header; // An empty frame of the given type
+    part.iov_len = chatFrameEncodeHeader(header, type, 0);
+    variants[FORMAT_FRAMED] = createProactorMessage(&part, 1);
+    if (variants[FORMAT_LINE] == NULL || variants[FORMAT_FRAMED] == NULL) {
+        perror("createProactorMessage"); // Print error message if allocation fails
+        exit(EXIT_FAILURE); // Exit with failure status
+    }
+}
+
+// Function to read the slow-consumer policy from the command line
+int parse_overflow_policy(int argc, char* argv[]) {
+    if (argc < 2 || strcmp(argv[1], "disconnect") == 0) return PROACTOR_OVERFLOW_DISCONNECT; // Default policy
+    if (strcmp(argv[1], "drop-oldest") == 0) return PROACTOR_OVERFLOW_DROP_OLDEST;
+    if (strcmp(argv[1], "pause") == 0) return PROACTOR_OVERFLOW_PAUSE;
+    fprintf(stderr, "Usage: %s [disconnect|drop-oldest|pause] [reactors] [adminSocket]\n", argv[0]); // Print usage on a bad argument
+    exit(EXIT_FAILURE); // Exit with failure status
+}
+
+// Function to create a notice in both formats: a line, or a text frame
+void create_notice(ProactorMessage* variants[2], const char* text) {
+    struct iovec parts[2] = {
+        { .iov_base = (void*)text, .iov_len = strlen(text) },
+        { .iov_base = "\n", .iov_len = 1 }
+    };
+    unsigned char header[CHAT_FRAME_HEADER_SIZE];
+    variants[FORMAT_LINE] = createProactorMessage(parts, 2);
+    ProactorMessage* payload = createProactorMessage(parts, 1);
+    variants[FORMAT_FRAMED] = payload == NULL ? NULL :
+        createFramedProactorMessage(header, chatFrameEncodeHeader(header, CHAT_FRAME_TEXT, proactorMessageLength(payload)), payload);
+    releaseProactorMessage(payload); // The framed variant keeps its own reference
+}
+
+// Function to open the listener of the single-loop mode
+int open_listener() {
+    int listener; // Socket descriptor for the server
+    struct sockaddr_in address; // Structure for the server address
+    int enable = 1; // Lets a restarted server bind while connections of the previous one linger in TIME_WAIT
 
     // Creating socket file descriptor
-    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
+    if ((listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
         perror("socket failed"); // Print error message if socket creation fails
         exit(EXIT_FAILURE); // Exit with failure status
     }
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
 
     // Set server address parameters
+    memset(&address, 0, sizeof(address));
     address.sin_family = AF_INET; // Set address family to Internet
     address.sin_addr.s_addr = INADDR_ANY; // Allow any IP to connect
     address.sin_port = htons(PORT); // Set the port number (convert to network byte order)
 
     // Bind the server socket to the specified address
-    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+    if (bind(listener, (struct sockaddr *)&address, sizeof(address)) < 0) {
         perror("bind failed"); // Print error message if bind fails
         exit(EXIT_FAILURE); // Exit with failure status
     }
 
     // Listen for incoming connections
-    if (listen(server_fd, 3) < 0) {
+    if (listen(listener, SOMAXCONN) < 0) {
         perror("listen"); // Print error message if listen fails
         exit(EXIT_FAILURE); // Exit with failure status
     }
+    return listener;
+}
+
+// Function to stop accepting: closes the single loop's listener or the reactors' listeners
+void stop_listening() {
+    if (server_fd != -1) {
+        close(server_fd);
+        server_fd = -1;
+    } else {
+        proactorStopListening(); // What the backlogs still hold goes through accept_client one last time
+    }
+}
+
+// Function to set a flag that keeps new clients off the list and return the sockets of the listed ones
+int freeze_clients(int* flag, int** sockets) {
+    pthread_mutex_lock(&clients_mutex);
+    *flag = 1;
+    int count = 0;
+    for (client_state* client = client_list; client != NULL; client = client->next) count++;
+    *sockets = malloc((count + 1) * sizeof(int));
+    if (*sockets == NULL) {
+        perror("malloc"); // Print error message if allocation fails
+        exit(EXIT_FAILURE); // Exit with failure status
+    }
+    count = 0;
+    for (client_state* client = client_list; client != NULL; client = client->next) (*sockets)[count++] = client->socket;
+    pthread_mutex_unlock(&clients_mutex);
+    return count;
+}
+
+// Function to return the milliseconds left until a deadline of the monotonic clock, 0 once it passed
+unsigned int milliseconds_left(const struct timespec* deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long left = (deadline->tv_sec - now.tv_sec) * 1000L + (deadline->tv_nsec - now.tv_nsec) / 1000000L;
+    return left > 0 ? (unsigned int)left : 0;
+}
+
+// Function to take a client away from the proactor once its output was written; returns its state, or NULL
+// if it hung up meanwhile (its callback frees it). *complete tells whether all of its output was written.
+client_state* detach_client(int socket, unsigned int timeout_ms, int* complete) {
+    int result = detachSocket(socket, timeout_ms);
+    if (result < 0) return NULL;
+    client_state* client = find_client(socket);
+    if (client == NULL) return NULL;
+    unlink_client(client);
+    remove_client_socket(socket);
+    *complete = result == 0;
+    return client;
+}
+
+// Function to shut the server down without losing what the clients were sent: stop accepting, stop reading,
+// tell every client, give their output queues time to drain, close them and exit
+void drain_and_exit() {
+    proactorLog(PROACTOR_LOG_INFO, "Shutting down, draining the clients\n");
+    int* sockets;
+    int count = freeze_clients(&draining, &sockets);
+    stop_listening();
+    for (int i = 0; i < count; i++) pauseSocketInput(sockets[i], DRAIN_TIMEOUT_MS); // Nothing they send is relayed anymore
+
+    ProactorMessage* notices[2]; // Indexed by FORMAT_*
+    create_notice(notices, "Server is shutting down");
+    if (notices[FORMAT_LINE] != NULL && notices[FORMAT_FRAMED] != NULL) broadcastGroupSendFormats(clients, -1, notices, 2);
+    releaseProactorMessage(notices[FORMAT_LINE]);
+    releaseProactorMessage(notices[FORMAT_FRAMED]);
+    proactorSync(); // The reactors queued their share of the notice and of earlier broadcasts
+
+    struct timespec deadline; // One timeout for all of them, however many clients there are
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += DRAIN_TIMEOUT_MS / 1000;
+    int unflushed = 0;
+    for (int i = 0; i < count; i++) {
+        int complete;
+        client_state* client = detach_client(sockets[i], milliseconds_left(&deadline), &complete);
+        if (client == NULL) continue;
+        if (!complete) unflushed++;
+        close(client->socket);
+        free_client(client);
+    }
+    free(sockets);
+    proactorLog(PROACTOR_LOG_INFO, "Closed %d clients, %d with output left unsent\n", count, unflushed);
+    cleanupProactor(); // Clean up resources used by Proactor
+    proactorLogStop();
+    exit(EXIT_SUCCESS);
+}
+
+// Function to start a new copy of the server that receives the handoff socket as HANDOFF_FD; returns its pid or -1
+pid_t start_successor(const char* path, char* argv[], int child_end) {
+    extern char** environ;
+    static char variable[32]; // HANDOFF_ENV=HANDOFF_FD
+    snprintf(variable, sizeof(variable), "%s=%d", HANDOFF_ENV, HANDOFF_FD);
+    int count = 0;
+    while (environ[count] != NULL) count++;
+    char** envp = malloc((count + 2) * sizeof(char*)); // Built before forking: the child may only call async-signal-safe functions
+    if (envp == NULL) {
+        perror("malloc"); // Print error message if allocation fails
+        return -1;
+    }
+    int used = 0;
+    for (int i = 0; i < count; i++) {
+        if (strncmp(environ[i], HANDOFF_ENV "=", strlen(HANDOFF_ENV) + 1) != 0) envp[used++] = environ[i];
+    }
+    envp[used++] = variable;
+    envp[used] = NULL;
+
+    pid_t child = fork();
+    if (child == 0) {
+        if (child_end != HANDOFF_FD) dup2(child_end, HANDOFF_FD); // The copy does not close on exec
+        else fcntl(HANDOFF_FD, F_SETFD, 0);
+        close_range(HANDOFF_FD + 1, ~0U, 0); // Client sockets must not stay open in the new server behind its back
+        execve(path, argv, envp); // The signals stay blocked until the new server reads them from its own signalfd
+        _exit(127);
+    }
+    if (child < 0) perror("fork"); // Print error message if the process cannot be created
+    free(envp);
+    return child;
+}
+
+// Function to hand every connection to a new copy of the server, which may be a new build, and exit.
+// Returns only if the new server did not start, and then keeps serving.
+void hot_restart(const char* path, char* argv[]) {
+    int ends[2]; // Our end and the new server's end of the handoff socket
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, ends) < 0) { // Keeps records apart, one descriptor each
+        perror("socketpair"); // Print error message if the socket cannot be created
+        return;
+    }
+    proactorLog(PROACTOR_LOG_INFO, "Restarting %s\n", path);
+    pid_t child = start_successor(path, argv, ends[1]);
+    close(ends[1]);
+    struct pollfd ready = { .fd = ends[0], .events = POLLIN };
+    char reply = 0;
+    if (child < 0 || poll(&ready, 1, HANDOFF_TIMEOUT_MS) <= 0 || read(ends[0], &reply, 1) != 1 || reply != HANDOFF_READY) {
+        proactorLog(PROACTOR_LOG_ERROR, "Restarted server did not start, keeping the connections\n");
+        close(ends[0]);
+        if (child > 0) {
+            kill(child, SIGKILL); // Whatever it got to, it has no connections yet
+            waitpid(child, NULL, 0);
+        }
+        return;
+    }
+    handoff_fd = ends[0];
 
-    printf("Server started on port %d\n", PORT); // Print server start message
+    // The new server accepts from now on: hand it the single loop's listener, or let the reactors' close
+    int* sockets;
+    int count = freeze_clients(&handing_off, &sockets);
+    if (server_fd != -1) send_handoff(HANDOFF_LISTENER, server_fd, 0, NULL, 0); // Its backlog goes along with it
+    stop_listening();
 
+    // Stop reading every client first, so no client is relayed by one server after a neighbour moved to the other
+    for (int i = 0; i < count; i++) pauseSocketInput(sockets[i], HANDOFF_TIMEOUT_MS);
+    proactorSync(); // Broadcasts still on their way to the reactors are queued before the output is flushed
+    int moved = 0;
+    for (int i = 0; i < count; i++) {
+        int complete;
+        client_state* client = detach_client(sockets[i], DRAIN_TIMEOUT_MS, &complete);
+        if (client == NULL) continue;
+        // Half a message was lost if the output did not drain, so such a client is closed rather than moved
+        if (complete && send_handoff(HANDOFF_CLIENT, client->socket, client->parser.mode,
+                                     client->parser.pending, client->parser.pendingLength) == 0) moved++;
+        close(client->socket); // The new server holds its own copy
+        free_client(client);
+    }
+    free(sockets);
+    proactorLog(PROACTOR_LOG_INFO, "Handed %d of %d clients to process %d\n", moved, count, (int)child);
+    cleanupProactor(); // Clean up resources used by Proactor
+    close(handoff_fd); // The new server sees the end of the handoff
+    proactorLogStop();
+    exit(EXIT_SUCCESS);
+}
+
+// Function to take over the connections of the server being replaced; returns the listener it handed over, or -1
+int adopt_handoff(int descriptor) {
+    static char pending[2 * MAX_MESSAGE_SIZE]; // Unfinished message of a client, never longer than a message and its header
+    char reply = HANDOFF_READY;
+    if (write(descriptor, &reply, 1) != 1) { // Tells the old server we are listening and ready for the connections
+        perror("write"); // Print error message if the old server went away
+        close(descriptor);
+        return -1;
+    }
+    int listener = -1, adopted = 0;
     while (1) {
-        // Accept a new client connection
-        if ((new_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t *)&addrlen)) < 0) {
-            perror("accept"); // Print error message if accept fails
-            continue; // Continue to the next iteration
+        handoff_record record;
+        struct iovec parts[2] = {
+            { .iov_base = &record, .iov_len = sizeof(record) },
+            { .iov_base = pending, .iov_len = sizeof(pending) }
+        };
+        char control[CMSG_SPACE(sizeof(int))]; // Room for one descriptor
+        struct msghdr message = { .msg_iov = parts, .msg_iovlen = 2, .msg_control = control, .msg_controllen = sizeof(control) };
+        ssize_t received = recvmsg(descriptor, &message, MSG_CMSG_CLOEXEC);
+        if (received < 0 && errno == EINTR) continue;
+        if (received < 0) perror("recvmsg"); // Print error message if the handoff broke off
+        if (received <= 0) break; // The old server handed over everything and exited
+        int passed = -1;
+        struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+        if (header != NULL && header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) memcpy(&passed, CMSG_DATA(header), sizeof(int));
+        if (passed == -1) continue;
+        if ((size_t)received < sizeof(record) || record.pending_len != (size_t)received - sizeof(record) || (message.msg_flags & MSG_TRUNC)) {
+            close(passed); // Malformed record
+        } else if (record.kind == HANDOFF_LISTENER && listener == -1) {
+            listener = passed;
+        } else if (record.kind == HANDOFF_CLIENT) {
+            pthread_mutex_lock(&clients_mutex);
+            start_client(passed, record.mode, pending, record.pending_len);
+            pthread_mutex_unlock(&clients_mutex);
+            adopted++;
+        } else {
+            close(passed);
         }
+    }
+    close(descriptor);
+    proactorLog(PROACTOR_LOG_INFO, "Took over %d clients from the previous server\n", adopted);
+    return listener;
+}
 
-        printf("Client %d connected\n", new_socket); // Print message indicating new client connected
-        add_client_socket(new_socket); // Add new client socket to the list
+int main(int argc, char* argv[]) {
+    int new_socket; // Socket descriptor for a new client
 
-        // Create a thread for each client
-        pthread_t thread; // Declare a thread variable
-        pthread_create(&thread, NULL, socketCallbackWrapper, (void *)(intptr_t)new_socket); // Create a thread for the client
+    // Initialize Proactor, refusing to run against a library built from another major version
+    if (proactorVersion() / 10000 != PROACTOR_VERSION_MAJOR) {
+        fprintf(stderr, "libproactor version %d does not match header version %d\n", proactorVersion(), PROACTOR_VERSION);
+        exit(EXIT_FAILURE);
     }
+    int overflow_policy = parse_overflow_policy(argc, argv); // What to do with a client that falls behind
 
-    // Cleanup
-    cleanupProactor(); // Clean up resources used by Proactor
+    // Block the shutdown and restart signals before any thread starts, so only the main loop receives them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    int signal_fd = signalfd(-1, &signals, SFD_CLOEXEC);
+    if (signal_fd < 0) {
+        perror("signalfd"); // Print error message if the descriptor cannot be created
+        exit(EXIT_FAILURE); // Exit with failure status
+    }
+    char executable_path[PATH_MAX]; // Started again on a hot restart; a deploy replaces the file at this path
+    ssize_t path_len = readlink("/proc/self/exe", executable_path, sizeof(executable_path) - 1);
+    executable_path[path_len > 0 ? path_len : 0] = '\0';
+    const char* handoff = getenv(HANDOFF_ENV); // Set when a running server started us to take over its connections
+    int inherited_fd = handoff != NULL ? atoi(handoff) : -1;
+    unsetenv(HANDOFF_ENV);
+
+    // Log through per-thread buffers written out in batches, so a client never waits for stdout
+    int log_level = proactorLogLevelFromName(getenv("LOG_LEVEL")); // debug, info, warn or error
+    if (log_level >= 0) proactorLogSetLevel(log_level);
+    if (proactorLogStart(STDOUT_FILENO, 0) < 0) fprintf(stderr, "Logging directly to stdout\n");
+    int reactors = argc > 2 ? atoi(argv[2]) : 0; // With N > 0, N event loops each accept on their own SO_REUSEPORT listener
+    ProactorConfig config = { .eventLoops = reactors }; // 0 keeps the default single loop
+    initializeProactorWithConfig(&config);
+    setDefaultOutputLimits(OUTPUT_HIGH_WATERMARK, OUTPUT_LOW_WATERMARK, overflow_policy); // Bound every client's backlog
+    clients = createBroadcastGroup(); // Create the client list
+    if (clients == NULL) {
+        perror("createBroadcastGroup"); // Print error message if allocation fails
+        exit(EXIT_FAILURE); // Exit with failure status
+    }
+    create_heartbeat(ping_messages, CHAT_FRAME_PING, "/ping\n"); // Shared by every client's idle timeout
+    create_heartbeat(pong_messages, CHAT_FRAME_PONG, "/pong\n");
+
+    // Serve the metrics on a local socket; the chat keeps working without it
+    clients_gauge = proactorRegisterCounter("chat_clients", "Connected chat clients", 1);
+    messages_received_counter = proactorRegisterCounter("chat_messages_received_total", "Text messages received from clients", 0);
+    broadcasts_counter = proactorRegisterCounter("chat_broadcasts_total", "Messages broadcast to the other clients", 0);
+    const char* admin_path = argc > 3 ? argv[3] : ADMIN_SOCKET_PATH;
+    if (proactorStartAdmin(admin_path) == 0) proactorLog(PROACTOR_LOG_INFO, "Metrics available on %s\n", admin_path);
 
-    return 0; // Return success status
+    // Multi-reactor mode: the loops accept in parallel and serve the clients they accepted
+    if (reactors > 0) {
+        if (proactorListen(PORT, accept_client, NULL) < 0) {
+            fprintf(stderr, "Could not listen on port %d\n", PORT); // The reason was printed by the library
+            exit(EXIT_FAILURE); // Exit with failure status
+        }
+        proactorLog(PROACTOR_LOG_INFO, "Server started on port %d with %d reactors\n", PORT, proactorLoopCount()); // Print server start message
+    }
+
+    // Hot restart: listen alongside the old server, then take over its listener and clients
+    if (inherited_fd >= 0) {
+        int listener = adopt_handoff(inherited_fd);
+        if (reactors > 0 && listener != -1) close(listener); // The reactors have their own
+        else server_fd = listener;
+    }
+    if (reactors == 0) {
+        if (server_fd == -1) server_fd = open_listener();
+        fcntl(server_fd, F_SETFL, fcntl(server_fd, F_GETFL) | O_NONBLOCK); // A connection reset before accept must not block the loop
+        proactorLog(PROACTOR_LOG_INFO, "Server started on port %d\n", PORT); // Print server start message
+    }
+
+    // SIGTERM or SIGINT drains the clients and exits, SIGUSR2 restarts the executable without dropping them
+    struct pollfd watched[2] = { { .fd = signal_fd, .events = POLLIN }, { .fd = server_fd, .events = POLLIN } };
+    while (1) {
+        if (poll(watched, server_fd != -1 ? 2 : 1, -1) < 0) { // The reactors accept by themselves
+            if (errno == EINTR) continue;
+            perror("poll"); // Print error message if waiting fails
+            exit(EXIT_FAILURE); // Exit with failure status
+        }
+        if (watched[0].revents & POLLIN) {
+            struct signalfd_siginfo signal_info;
+            if (read(signal_fd, &signal_info, sizeof(signal_info)) != sizeof(signal_info)) continue;
+            if (signal_info.ssi_signo == SIGUSR2) hot_restart(executable_path, argv); // Returns only if the restart failed
+            else drain_and_exit();
+            continue;
+        }
+        if (server_fd != -1 && (watched[1].revents & POLLIN)) {
+            // Accept a new client connection
+            if ((new_socket = accept(server_fd, NULL, NULL)) < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNABORTED) perror("accept"); // Print error message if accept fails
+                continue; // Continue to the next iteration
+            }
+            accept_client(new_socket, NULL); // Register the client with the proactor
+        }
+    }
 }
@@ -19,9 +19,39 @@
 #include <openssl/evp.h>
 #include <stdbool.h>
 #include <sys/stat.h>
+#include <ctype.h>
 
 #define PORT_NUMBER "8080"  // the port users will be connecting to
 #define BUFFER_SIZE 1024
+#define HEAD_MAX 8192 // longest response head (status line and headers) accepted
+
+// states of a response parser
+#define RESPONSE_HEAD 0       // reading the status line and the headers
+#define RESPONSE_BODY 1       // reading a body of known length
+#define RESPONSE_UNTIL_CLOSE 2 // reading a body that ends when the server closes the connection
+#define RESPONSE_CHUNK_SIZE 3 // reading the size line of the next chunk
+#define RESPONSE_CHUNK_DATA 4 // reading the data of a chunk
+#define RESPONSE_CHUNK_END 5  // reading the "\r\n" after the data of a chunk
+#define RESPONSE_TRAILER 6    // reading trailer lines up to the blank line
+#define RESPONSE_DONE 7       // the whole response arrived
+
+#define CONNECTIONS_PER_HOST 4 // kept-alive connections the list handler opens to one host
+#define PIPELINE_DEPTH 16      // requests sent ahead of their responses on one connection
+
+// incremental parser of one response: the head, then a base64 body framed by
+// Content-Length or chunked transfer encoding, decoded into out_fd as it arrives
+typedef struct {
+    int state;
+    char head[HEAD_MAX];
+    size_t head_len;
+    int status;
+    long long remaining; // body bytes left, in the body or in the current chunk
+    long line_len;       // characters of the current trailer line, -1 while skipping a chunk extension
+    char pending[4];     // base64 characters of a group split between reads
+    size_t pending_len;
+    int out_fd;
+    int close;           // the head said "Connection: close": nothing more comes on this connection
+} response_parser;
 
 // Function to calculate the length of a decoded Base64 string
 int calculate_decoded_length(const char* b64input, size_t len) {
@@ -98,6 +128,165 @@ int decode_base64(char* b64message, char** buffer, size_t* length) {
     return 0; // Indicate success
 }
 
+void init_response(response_parser *parser, int out_fd) {
+    memset(parser, 0, sizeof(*parser));
+    parser->state = RESPONSE_HEAD;
+    parser->out_fd = out_fd;
+}
+
+// decode the complete base64 groups of the body data and write them to the file,
+// keeping a group split between reads for the next one
+int write_body(response_parser *parser, const char *data, size_t len) {
+    char group[BUFFER_SIZE];
+    while (len > 0) {
+        size_t group_len = parser->pending_len;
+        memcpy(group, parser->pending, group_len);
+        size_t take = len < sizeof(group) - group_len ? len : sizeof(group) - group_len;
+        memcpy(group + group_len, data, take);
+        group_len += take;
+        data += take;
+        len -= take;
+        size_t whole = group_len - group_len % 4;
+        parser->pending_len = group_len - whole;
+        memcpy(parser->pending, group + whole, parser->pending_len);
+        if (whole == 0 || parser->status != 200) {
+            continue; // the body of an error is not a file
+        }
+        char* decodedContent;
+        size_t decodedLength = whole;
+        if (decode_base64(group, &decodedContent, &decodedLength) != 0) {
+            return -1;
+        }
+        if (write(parser->out_fd, decodedContent, decodedLength) < 0) {
+            free(decodedContent);
+            return -1;
+        }
+        free(decodedContent);
+    }
+    return 0;
+}
+
+// parse the head once the blank line ending it arrived
+int parse_response_head(response_parser *parser) {
+    parser->head[parser->head_len] = '\0';
+    if (sscanf(parser->head, "HTTP/%*d.%*d %d", &parser->status) != 1) {
+        return -1;
+    }
+    parser->state = RESPONSE_UNTIL_CLOSE; // no framing header: the body ends with the connection
+    char *line = strstr(parser->head, "\r\n");
+    while (line != NULL && line[2] != '\0') {
+        line += 2;
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            parser->remaining = atoll(line + 15);
+            parser->state = parser->remaining > 0 ? RESPONSE_BODY : RESPONSE_DONE;
+        }
+        else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0 && strstr(line, "chunked") != NULL) {
+            parser->state = RESPONSE_CHUNK_SIZE;
+        }
+        else if (strncasecmp(line, "Connection:", 11) == 0) {
+            const char *value = line + 11;
+            while (*value == ' ' || *value == '\t') {
+                value++;
+            }
+            parser->close = strncasecmp(value, "close", 5) == 0;
+        }
+        line = strstr(line, "\r\n");
+    }
+    return 0;
+}
+
+// feed received data to the parser; returns 1 once the response is complete,
+// 0 while more is expected and -1 for a malformed response.
+// used is set to the bytes of this response: on a kept-alive connection the next one follows
+int feed_response(response_parser *parser, const char *data, size_t len, size_t *used) {
+    size_t i = 0;
+    while (i < len && parser->state != RESPONSE_DONE) {
+        if (parser->state == RESPONSE_HEAD) {
+            if (parser->head_len == HEAD_MAX - 1) {
+                return -1;
+            }
+            parser->head[parser->head_len++] = data[i++];
+            if (parser->head_len >= 4 && memcmp(parser->head + parser->head_len - 4, "\r\n\r\n", 4) == 0) {
+                if (parse_response_head(parser) < 0) {
+                    return -1;
+                }
+            }
+        }
+        else if (parser->state == RESPONSE_BODY || parser->state == RESPONSE_CHUNK_DATA || parser->state == RESPONSE_UNTIL_CLOSE) {
+            size_t part = len - i;
+            if (parser->state != RESPONSE_UNTIL_CLOSE && (long long)part > parser->remaining) {
+                part = parser->remaining;
+            }
+            if (write_body(parser, data + i, part) < 0) {
+                return -1;
+            }
+            i += part;
+            if (parser->state == RESPONSE_UNTIL_CLOSE) {
+                continue;
+            }
+            parser->remaining -= part;
+            if (parser->remaining == 0) {
+                parser->state = parser->state == RESPONSE_BODY ? RESPONSE_DONE : RESPONSE_CHUNK_END;
+            }
+        }
+        else {
+            char c = data[i++];
+            if (parser->state == RESPONSE_CHUNK_SIZE) {
+                if (c == '\n') {
+                    parser->state = parser->remaining > 0 ? RESPONSE_CHUNK_DATA : RESPONSE_TRAILER;
+                    parser->line_len = 0;
+                }
+                else if (isxdigit((unsigned char)c) && parser->line_len >= 0) {
+                    parser->remaining = parser->remaining * 16 + (isdigit((unsigned char)c) ? c - '0' : tolower((unsigned char)c) - 'a' + 10);
+                }
+                else if (c != '\r') {
+                    parser->line_len = -1; // a chunk extension, ignored
+                }
+            }
+            else if (parser->state == RESPONSE_CHUNK_END) {
+                if (c == '\n') {
+                    parser->state = RESPONSE_CHUNK_SIZE;
+                    parser->remaining = 0;
+                    parser->line_len = 0;
+                }
+            }
+            else if (c == '\n') { // RESPONSE_TRAILER
+                if (parser->line_len == 0) {
+                    parser->state = RESPONSE_DONE;
+                }
+                parser->line_len = 0;
+            }
+            else if (c != '\r') {
+                parser->line_len++;
+            }
+        }
+    }
+    *used = i;
+    return parser->state == RESPONSE_DONE;
+}
+
+// called when the server closed the connection; returns 1 if the response was complete
+int finish_response(response_parser *parser) {
+    if (parser->state == RESPONSE_UNTIL_CLOSE) {
+        parser->state = RESPONSE_DONE;
+    }
+    return parser->state == RESPONSE_DONE;
+}
+
+// a kept-alive connection of the list handler's pool and the files requested on it;
+// the server answers pipelined requests in order, so one parser takes the responses in turn
+typedef struct {
+    char host[BUFFER_SIZE];
+    int fd;
+    int *files;   // indices of the files fetched on this connection, in request order
+    int count;
+    int sent;     // requests written so far
+    int received; // responses completed so far
+    int out_fd;   // file the current response is written to
+    int closed;   // the server closed the connection or said it would: no more requests go out on it
+    response_parser parser;
+} pooled_connection;
+
 // get sockaddr, IPv4 or IPv6:
 void *get_address(struct sockaddr *sa)
 {
@@ -119,12 +308,15 @@ bool ends_with(const char *str, const char *suffix)
     return strncmp(str + len_str - len_suffix, suffix, len_suffix) == 0;
 }
 
-bool handle_response(char *line) {
-    if (strstr(line, "500 Internal Server Error") != NULL) {
+bool handle_response(int status) {
+    if (status == 200) {
         printf("Success: File found.\n");
-    } else if (strstr(line, "404 Not Found") != NULL) {
+    } else if (status == 404) {
         printf("Failure: File not found.\n");
         return false;
+    } else {
+        printf("Failure: Server answered %d.\n", status);
+        return false;
     }
     return true;
 }
@@ -135,7 +327,7 @@ void handle_file_download(char * file_path, int sock_fd) {
     int numbytes;
     char buffer [BUFFER_SIZE];
     printf("Requesting file: %s\n", file_path);
-    snprintf(buffer, BUFFER_SIZE, "GET %s\r\n\r\n", file_path);
+    snprintf(buffer, BUFFER_SIZE, "GET %s HTTP/1.1\r\n\r\n", file_path);
     if (write(sock_fd, buffer, strlen(buffer)) < 0) {
         perror("Error: Failed to send GET request");
         exit(1);
@@ -155,35 +347,39 @@ void handle_file_download(char * file_path, int sock_fd) {
             }
         }
     }
-    int file_fd = open(file_path, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    int file_fd = open(file_path, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
     if (file_fd < 0) {
         perror("Error: Failed to open file");
         exit(1);
     }
-    while (1) {
+    free(dir);
+    response_parser parser;
+    init_response(&parser, file_fd);
+    int done = 0;
+    while (!done) {
         numbytes = recv(sock_fd, buffer, BUFFER_SIZE, 0);
         if (numbytes < 0) {
             perror("Error: Failed to receive data");
             exit(1);
         }
         if (numbytes == 0) {
+            if (!finish_response(&parser)) {
+                fprintf(stderr, "Error: Connection closed before the end of the file\n");
+                exit(1);
+            }
             break;
         }
-        if (!handle_response(buffer)) {
-            return;
-        }
-        char* decodedContent;
-        size_t decodedLength = numbytes;
-        if(decode_base64((char*)buffer, &decodedContent, &decodedLength) != 0){
-            perror("Error: Failed to decode file content");
-            exit(1);
-        }
-        if (write(file_fd, decodedContent, decodedLength) < 0) {
-            perror("Error: Failed to write to file");
+        size_t used;
+        done = feed_response(&parser, buffer, numbytes, &used);
+        if (done < 0) {
+            fprintf(stderr, "Error: Failed to decode file content\n");
             exit(1);
         }
     }
     close(file_fd);
+    if (!handle_response(parser.status)) {
+        return;
+    }
     printf("File downloaded successfully.\n");
 }
 
@@ -258,110 +454,252 @@ int establish_socket_connection(const char *line) {
     return sockfd;
 }
 
+// open a downloaded file for writing, creating its directory if needed
+int open_download(const char *path) {
+    char *dir = strdup(path);
+    char *last_slash = strrchr(dir, '/');
+    if (last_slash) {
+        *last_slash = '\0';
+        if (mkdir(dir, 0777) < 0 && errno != EEXIST) {
+            perror("Error: Failed to create directory");
+            exit(1);
+        }
+    }
+    free(dir);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        perror("Error: Failed to create file");
+        exit(1);
+    }
+    return fd;
+}
+
+// write the next request of a pooled connection; the last one asks the server to close it
+void send_next_request(pooled_connection *conn, char **paths) {
+    char buffer[3 * BUFFER_SIZE]; // room for a path and a host of a list line
+    char *path = paths[conn->files[conn->sent]];
+    printf("Sending GET request for: %s\n", path);
+    snprintf(buffer, sizeof(buffer), "GET %s HTTP/1.1\r\nHost: %s\r\n%s\r\n", path, conn->host,
+             conn->sent == conn->count - 1 ? "Connection: close\r\n" : "");
+    // no SIGPIPE if the server closed meanwhile: the files are asked for again on a new connection
+    if (send(conn->fd, buffer, strlen(buffer), MSG_NOSIGNAL) < 0) {
+        perror("Error: Failed to write to socket");
+        conn->closed = 1;
+        return;
+    }
+    conn->sent++;
+}
+
+// get ready for the response to the next request of a pooled connection
+void start_next_response(pooled_connection *conn, char **paths) {
+    conn->out_fd = open_download(paths[conn->files[conn->received]]);
+    init_response(&conn->parser, conn->out_fd);
+}
+
+// the current response of a pooled connection is complete: pipeline another request in its place,
+// unless the server is closing the connection (after an error, say) and drops what was pipelined behind it
+void finish_download(pooled_connection *conn, char **paths) {
+    close(conn->out_fd);
+    handle_response(conn->parser.status);
+    conn->received++;
+    if (conn->parser.close) {
+        conn->closed = 1;
+    }
+    if (conn->sent < conn->count && !conn->closed) {
+        send_next_request(conn, paths);
+    }
+    if (conn->received < conn->count) {
+        start_next_response(conn, paths);
+    }
+}
+
+// the server closed a pooled connection: ask for the files it did not answer on a new one.
+// every reopen follows at least one answered or failed file, so a server that keeps closing cannot loop forever
+void reopen_connection(pooled_connection *conn, char **paths, struct pollfd *pfd) {
+    close(conn->fd);
+    conn->closed = 0;
+    conn->fd = establish_socket_connection(conn->host);
+    pfd->fd = conn->fd;
+    if (conn->fd < 0) {
+        fprintf(stderr, "Error: Could not reconnect, %d files not downloaded\n", conn->count - conn->received);
+        close(conn->out_fd);
+        conn->received = conn->count;
+        return;
+    }
+    conn->sent = conn->received; // the requests pipelined behind the last response were dropped
+    while (conn->sent < conn->count && conn->sent - conn->received < PIPELINE_DEPTH && !conn->closed) {
+        send_next_request(conn, paths);
+    }
+}
+
 // list file handler
 // this function will sends a get request to the server for each line in the file
 // that represent a file path to be downloaded, and then download the file
-// using POLL for async IO
-// if the file is a regular file, it will be downloaded using the handle_file_download function
-// if not, it will be recursively downloaded using the list_file_handler function
+// using POLL for async IO.
+// the files of one host share a small pool of kept-alive connections, and the requests
+// on each connection are pipelined, so small files do not pay for a handshake each
 void handle_list_file(char *file_path) {
     int lines = count_lines(file_path);
     char buffer[BUFFER_SIZE];
     if (lines <= 0) {
         return;
     }
-    struct pollfd pfds[lines];
-    int file_fd = open(file_path, O_RDONLY);
-    if (file_fd < 0) {
+    FILE *file = fopen(file_path, "r");
+    if (!file) {
         perror("Error: Failed to open file");
         return;
     }
-    FILE *file = fopen(file_path, "r");
     char line[BUFFER_SIZE];
-    int files [BUFFER_SIZE];
-    int i = 0;
-    while (fgets(line, sizeof(line), file)) {
-        int sockfd = establish_socket_connection(line);
-        if (sockfd < 0) {
-            // Error creating socket
-            perror("Error: Failed to create socket");
-            exit(1);
-        }
-        pfds[i].fd = sockfd;
-        pfds[i].events = POLLIN;
-        // send the GET request
-        char *file_path = strstr(line, " ") + 1;
-        // if the file path ends with a newline, remove it
-        if (file_path[strlen(file_path) - 1] == '\n') {
-            file_path[strlen(file_path) - 1] = '\0';
-        }
-        else
-        {
-            file_path[strlen(file_path)] = '\0';
+    char **paths = malloc(lines * sizeof(char *));
+    pooled_connection *pool = calloc(lines, sizeof(pooled_connection)); // at most one connection per file
+    if (paths == NULL || pool == NULL) {
+        perror("Error: Failed to allocate the connection pool");
+        exit(1);
+    }
+    int files = 0;
+    int pool_size = 0;
+    while (files < lines && fgets(line, sizeof(line), file)) {
+        // a line is "host path"
+        line[strcspn(line, "\r\n")] = '\0';
+        char *space = strchr(line, ' ');
+        if (space == NULL) {
+            continue;
         }
-        
-
-        printf("Sending GET request for: %s\n", file_path);
-        snprintf(buffer, BUFFER_SIZE, "GET %s\r\n\r\n", file_path);
-        if (write(sockfd, buffer, strlen(buffer)) < 0) {
-            perror("Error: Failed to write to socket");
-            exit(1);
+        *space = '\0';
+        paths[files] = strdup(space + 1);
+
+        // the first files of a host get a connection each, the rest are spread over them in turn
+        int host_connections = 0;
+        int host_files = 0;
+        for (int c = 0; c < pool_size; c++) {
+            if (strcmp(pool[c].host, line) == 0) {
+                host_connections++;
+                host_files += pool[c].count;
+            }
         }
-        // make directory
-        char *dir = strdup(file_path);
-        char *last_slash = strrchr(dir, '/');
-        if (last_slash) {
-            *last_slash = '\0';
-            if (mkdir(dir, 0777) < 0 && errno != EEXIST) {
-                perror("Error: Failed to create directory");
+        pooled_connection *conn = NULL;
+        if (host_connections < CONNECTIONS_PER_HOST) {
+            conn = &pool[pool_size++];
+            snprintf(conn->host, sizeof(conn->host), "%s", line);
+            conn->fd = establish_socket_connection(line);
+            if (conn->fd < 0) {
+                perror("Error: Failed to create socket");
+                exit(1);
+            }
+            conn->files = malloc(lines * sizeof(int));
+            if (conn->files == NULL) {
+                perror("Error: Failed to allocate the connection pool");
                 exit(1);
             }
         }
-        files[i] = open(file_path, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
-        // create a new file for writing
-        // enable creating folders
-        if (files[i] < 0) {
-            perror("Error: Failed to create file");
-            exit(1);
+        else {
+            int slot = host_files % CONNECTIONS_PER_HOST;
+            for (int c = 0; c < pool_size; c++) {
+                if (strcmp(pool[c].host, line) == 0 && slot-- == 0) {
+                    conn = &pool[c];
+                    break;
+                }
+            }
         }
-        free(dir);
-        i++;
+        conn->files[conn->count++] = files++;
     }
     fclose(file);
-    while (poll(pfds, lines, 1000) > 0) {
-        for (int i = 0; i < lines; i++) {
-            if (pfds[i].revents & POLLIN) {
-                int numbytes = recv(pfds[i].fd, buffer, BUFFER_SIZE, 0);
-                if (numbytes > 0) {
-                    char * decodedContent;
-                    size_t decodedLength;
-                    decodedLength = numbytes;
-                    if(decode_base64((char*)buffer, &decodedContent, &decodedLength) != 0){
-                        perror("Error: Failed to decode file content");
-                        exit(1);
-                    }
-                    // write the response to the file
-                    if (write(files[i], decodedContent, decodedLength) < 0) {
-                        perror("Error: Failed to write to file");
-                        exit(1);
+
+    struct pollfd pfds[pool_size > 0 ? pool_size : 1];
+    for (int c = 0; c < pool_size; c++) {
+        // send the first requests ahead of their responses
+        while (pool[c].sent < pool[c].count && pool[c].sent < PIPELINE_DEPTH && !pool[c].closed) {
+            send_next_request(&pool[c], paths);
+        }
+        start_next_response(&pool[c], paths);
+        pfds[c].fd = pool[c].fd;
+        pfds[c].events = POLLIN;
+    }
+    int active = pool_size;
+    while (active > 0 && poll(pfds, pool_size, 1000) > 0) {
+        for (int c = 0; c < pool_size; c++) {
+            if (!(pfds[c].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            pooled_connection *conn = &pool[c];
+            int numbytes = recv(conn->fd, buffer, BUFFER_SIZE, 0);
+            if (numbytes < 0 && errno == EINTR) {
+                continue;
+            }
+            if (numbytes <= 0) {
+                // the server closed the connection
+                conn->closed = 1;
+                if (finish_response(&conn->parser)) {
+                    finish_download(conn, paths);
+                }
+                else if (conn->received < conn->count) {
+                    fprintf(stderr, "Error: Connection closed before the end of a file\n");
+                    close(conn->out_fd);
+                    conn->received++; // that file failed, the rest are asked for again
+                    if (conn->received < conn->count) {
+                        start_next_response(conn, paths);
                     }
                 }
-                else if (numbytes == 0) {
-                    // close the socket
-                    close(pfds[i].fd);
-                    pfds[i].fd = -1;
+            }
+            // the responses arrive in the order of the requests, possibly several in one read
+            size_t offset = 0;
+            while (numbytes > 0 && offset < (size_t)numbytes && conn->received < conn->count && !conn->closed) {
+                size_t used;
+                int done = feed_response(&conn->parser, buffer + offset, numbytes - offset, &used);
+                if (done < 0) {
+                    fprintf(stderr, "Error: Failed to decode file content\n");
+                    exit(1);
+                }
+                offset += used;
+                if (done) {
+                    finish_download(conn, paths);
                 }
             }
+            if (conn->closed && conn->received < conn->count) {
+                reopen_connection(conn, paths, &pfds[c]);
+            }
+            if (conn->received == conn->count) {
+                // every file of this connection arrived: close the socket
+                close(conn->fd);
+                pfds[c].fd = -1;
+                active--;
+            }
         }
     }
 
     // Close all sockets
-    for (int i = 0; i < lines; i++) {
-        if (pfds[i].fd >= 0) {
-            close(pfds[i].fd);
+    for (int c = 0; c < pool_size; c++) {
+        if (pfds[c].fd >= 0) {
+            close(pfds[c].fd);
+            close(pool[c].out_fd);
         }
-        close(files[i]);
+        free(pool[c].files);
     }
+    for (int i = 0; i < files; i++) {
+        free(paths[i]);
+    }
+    free(pool);
+    free(paths);
+}
+
+// read until len bytes arrived or the file ended, so every chunk but the last is full
+// and the encoded body matches the declared length; returns the bytes read, -1 on error
+ssize_t read_full(int fd, char *buf, size_t len) {
+    size_t total = 0;
+    while (total < len) {
+        ssize_t n = read(fd, buf + total, len - total);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += n;
+    }
+    return total;
 }
 
 // post request handler
@@ -375,8 +713,19 @@ void handle_post_request (char * local_file_path, char * remote_path, int sock_f
         exit(1);
     }
 
+    // Declare the length of the encoded body: every full chunk encodes to 4 characters per 3 bytes, the last one is padded
+    struct stat file_stat;
+    if (fstat(file, &file_stat) == -1) {
+        perror("Error: Failed to stat file");
+        exit(1);
+    }
+    long long left = file_stat.st_size; // bytes the declared length covers
+    long long full_chunks = file_stat.st_size / (BUFFER_SIZE - 1);
+    long long last_chunk = file_stat.st_size % (BUFFER_SIZE - 1);
+    long long encoded_length = full_chunks * 4 * ((BUFFER_SIZE - 1 + 2) / 3) + 4 * ((last_chunk + 2) / 3);
+
     // Prepare and send the POST request line
-    snprintf(buffer, BUFFER_SIZE, "POST %s\r\n", remote_path);
+    snprintf(buffer, BUFFER_SIZE, "POST %s HTTP/1.1\r\nContent-Length: %lld\r\n\r\n", remote_path, encoded_length);
     if (write(sock_fd, buffer, strlen(buffer)) < 0) {
         perror("Error: Failed to write initial POST line to socket");
         close(file);
@@ -385,8 +734,16 @@ void handle_post_request (char * local_file_path, char * remote_path, int sock_f
 
     // Initialize buffer for reading file content
     char fileBuffer[BUFFER_SIZE];
-    size_t bytesRead;
-    while ((bytesRead = read(file, fileBuffer, BUFFER_SIZE - 1)) > 0) {
+    ssize_t bytesRead;
+    while (left > 0) {
+        bytesRead = read_full(file, fileBuffer, left < BUFFER_SIZE - 1 ? left : BUFFER_SIZE - 1);
+        if (bytesRead <= 0) {
+            // the body would fall short of its declared length: give up, the server discards the partial upload
+            fprintf(stderr, "Error: Failed to read %s to its end\n", local_file_path);
+            close(file);
+            exit(1);
+        }
+        left -= bytesRead;
         size_t encodedSize;
         char* encodedContent;
         fileBuffer[bytesRead] = '\0'; // Null-terminate the buffer
@@ -406,14 +763,26 @@ void handle_post_request (char * local_file_path, char * remote_path, int sock_f
         free(encodedContent);
     }
 
-    // Send the final CRLF to indicate the end of the request
-    if (write(sock_fd, "\r\n\r\n", 4) < 0) {
-        perror("Error: Failed to write final CRLF to socket");
-        close(file);
-        exit(1);
+    close(file); // Close the file after sending all chunks; the declared length ends the request
+
+    // Read the status the server answers with
+    response_parser parser;
+    init_response(&parser, -1);
+    int done = 0;
+    while (!done) {
+        int numbytes = recv(sock_fd, buffer, BUFFER_SIZE, 0);
+        if (numbytes <= 0) {
+            done = finish_response(&parser) ? 1 : -1;
+        } else {
+            size_t used;
+            done = feed_response(&parser, buffer, numbytes, &used);
+        }
+    }
+    if (done < 0 || parser.status != 200) {
+        printf("Failure: Server answered %d.\n", parser.status);
+    } else {
+        printf("File uploaded successfully.\n");
     }
-
-    close(file); // Close the file after sending all chunks
 }
 
 int main(int argc, char *argv[]) {
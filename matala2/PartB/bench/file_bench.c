@@ -0,0 +1,261 @@
+#define _GNU_SOURCE // Include for strcasestr
+#include <stdio.h> // Include for printf and perror
+#include <stdlib.h> // Include for malloc, qsort and atoi
+#include <string.h> // Include for memset and strlen
+#include <unistd.h> // Include for close
+#include <errno.h> // Include for EINTR
+#include <time.h> // Include for clock_gettime
+#include <pthread.h> // Include for the client threads
+#include <netdb.h> // Include for getaddrinfo
+#include <sys/socket.h> // Include for socket functions and definitions
+
+// Closed-loop load generator for the file server: every connection thread sends one GET on a fresh
+// connection, reads the reply until the server closes it, and starts over. Reports requests per second
+// and latency percentiles, so the server can be compared with the fork-per-connection model it replaced.
+// With a pipeline depth, every thread keeps one connection open instead and has that many GETs in flight on it.
+
+#define DEFAULT_CONNECTIONS 32 // Concurrent clients
+#define DEFAULT_SECONDS 5 // Length of the run
+#define DEFAULT_PORT "8080" // Port of the file server
+#define MAX_PIPELINE 256 // Most requests in flight on a kept-alive connection
+
+// Structure representing the work and results of one client thread
+typedef struct {
+    struct addrinfo *address; // Server to connect to
+    const char *request; // GET request sent on every connection
+    int pipeline; // Requests in flight on one kept-alive connection, 0 for a connection per request
+    double stop_time; // Time the thread stops starting requests
+    double *latencies; // Latency of every completed request, in microseconds
+    size_t count; // Entries in latencies
+    size_t capacity; // Allocated entries in latencies
+    long errors; // Requests that failed
+    long long bytes; // Reply bytes received
+    pthread_t thread; // Thread running the client
+} client_thread;
+
+// Function to return the monotonic clock in seconds
+double now_seconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Function to run one request; returns the reply bytes, or -1 on failure
+long long run_request(client_thread *client) {
+    static __thread char buffer[64 * 1024]; // Reply data is only counted
+    int sock = socket(client->address->ai_family, client->address->ai_socktype, client->address->ai_protocol);
+    if (sock == -1) return -1;
+    if (connect(sock, client->address->ai_addr, client->address->ai_addrlen) == -1) {
+        close(sock);
+        return -1;
+    }
+    size_t len = strlen(client->request);
+    if (send(sock, client->request, len, MSG_NOSIGNAL) != (ssize_t)len) {
+        close(sock);
+        return -1;
+    }
+    long long total = 0;
+    while (1) { // The server closes the connection once the file was sent
+        ssize_t received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received < 0) {
+            total = -1;
+            break;
+        }
+        if (received == 0) break;
+        total += received;
+    }
+    close(sock);
+    return total;
+}
+
+// Function to record a completed request
+void record_request(client_thread *client, double start, long long received) {
+    if (client->count == client->capacity) {
+        client->capacity = client->capacity ? client->capacity * 2 : 4096;
+        client->latencies = (double *)realloc(client->latencies, client->capacity * sizeof(double));
+        if (client->latencies == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    client->latencies[client->count++] = (now_seconds() - start) * 1e6;
+    client->bytes += received;
+}
+
+// Function to return the body length a response head declares, -1 if it declares none
+long long declared_length(const char *head) {
+    const char *header = strcasestr(head, "\r\nContent-Length:");
+    return header != NULL ? atoll(header + 17) : -1;
+}
+
+// Function to run requests on one kept-alive connection, keeping client->pipeline of them in flight
+// until the end of the run; returns -1 when the connection failed
+int run_pipeline(client_thread *client) {
+    static __thread char buffer[64 * 1024];
+    static __thread char head[4096];
+    double starts[MAX_PIPELINE]; // Send times of the requests in flight, oldest first
+    int sock = socket(client->address->ai_family, client->address->ai_socktype, client->address->ai_protocol);
+    if (sock == -1) return -1;
+    if (connect(sock, client->address->ai_addr, client->address->ai_addrlen) == -1) {
+        close(sock);
+        return -1;
+    }
+    size_t len = strlen(client->request);
+    int in_flight = 0, oldest = 0;
+    size_t head_len = 0; // Head of the response being read
+    long long body_left = -1; // Body bytes of that response still to come, -1 while its head is read
+    while (1) {
+        while (in_flight < client->pipeline && now_seconds() < client->stop_time) { // Top the pipeline up
+            if (send(sock, client->request, len, MSG_NOSIGNAL) != (ssize_t)len) break;
+            starts[(oldest + in_flight++) % MAX_PIPELINE] = now_seconds();
+        }
+        if (in_flight == 0) break; // The run is over
+        ssize_t received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) break;
+        for (ssize_t i = 0; i < received; ) {
+            if (body_left < 0) { // Collect the head up to its blank line
+                if (head_len == sizeof(head) - 1) goto failed;
+                head[head_len++] = buffer[i++];
+                head[head_len] = '\0';
+                if (head_len < 4 || memcmp(head + head_len - 4, "\r\n\r\n", 4) != 0) continue;
+                body_left = declared_length(head);
+                if (body_left < 0 || strncmp(head, "HTTP/1.1 200", 12) != 0) goto failed;
+            } else {
+                long long part = received - i < body_left ? received - i : body_left;
+                i += part;
+                body_left -= part;
+            }
+            if (body_left == 0) { // The response is complete
+                record_request(client, starts[oldest], declared_length(head));
+                oldest = (oldest + 1) % MAX_PIPELINE;
+                in_flight--;
+                head_len = 0;
+                body_left = -1;
+            }
+        }
+    }
+failed:
+    close(sock);
+    client->errors += in_flight;
+    return in_flight > 0 ? -1 : 0;
+}
+
+// Thread function sending requests back to back until the end of the run
+void *run_client(void *arg) {
+    client_thread *client = (client_thread *)arg;
+    while (now_seconds() < client->stop_time) {
+        if (client->pipeline > 0) { // Reconnects only when the connection failed
+            run_pipeline(client);
+            continue;
+        }
+        double start = now_seconds();
+        long long received = run_request(client);
+        if (received <= 0) { // An empty reply is a failure too: the file exists
+            client->errors++;
+            continue;
+        }
+        record_request(client, start, received);
+    }
+    return NULL;
+}
+
+// Function to compare two latencies for qsort
+int compare_latencies(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Function to return a percentile of sorted latencies
+double percentile(const double *sorted, size_t count, double fraction) {
+    if (count == 0) return 0;
+    size_t index = (size_t)(fraction * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <host> <path> [connections] [seconds] [port] [pipeline]\n", argv[0]);
+        exit(1);
+    }
+    int connections = argc > 3 ? atoi(argv[3]) : DEFAULT_CONNECTIONS;
+    int seconds = argc > 4 ? atoi(argv[4]) : DEFAULT_SECONDS;
+    const char *port = argc > 5 ? argv[5] : DEFAULT_PORT;
+    int pipeline = argc > 6 ? atoi(argv[6]) : 0;
+    if (connections < 1 || seconds < 1) {
+        fprintf(stderr, "connections and seconds must be positive\n");
+        exit(1);
+    }
+    if (pipeline < 0 || pipeline > MAX_PIPELINE) {
+        fprintf(stderr, "pipeline must be between 0 and %d\n", MAX_PIPELINE);
+        exit(1);
+    }
+
+    struct addrinfo hints, *address;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int rv = getaddrinfo(argv[1], port, &hints, &address);
+    if (rv != 0) {
+        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(rv));
+        exit(1);
+    }
+    char request[1024];
+    if (pipeline > 0) snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s\r\n\r\n", argv[2], argv[1]);
+    else snprintf(request, sizeof(request), "GET %s\r\n\r\n", argv[2]);
+
+    client_thread *clients = (client_thread *)calloc(connections, sizeof(client_thread));
+    if (clients == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    double start = now_seconds();
+    for (int i = 0; i < connections; i++) {
+        clients[i].address = address;
+        clients[i].request = request;
+        clients[i].pipeline = pipeline;
+        clients[i].stop_time = start + seconds;
+        if (pthread_create(&clients[i].thread, NULL, run_client, &clients[i]) != 0) {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+
+    size_t total = 0;
+    long errors = 0;
+    long long bytes = 0;
+    for (int i = 0; i < connections; i++) {
+        pthread_join(clients[i].thread, NULL);
+        total += clients[i].count;
+        errors += clients[i].errors;
+        bytes += clients[i].bytes;
+    }
+    double elapsed = now_seconds() - start;
+
+    double *latencies = (double *)malloc((total + 1) * sizeof(double));
+    if (latencies == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    size_t filled = 0;
+    for (int i = 0; i < connections; i++) {
+        memcpy(latencies + filled, clients[i].latencies, clients[i].count * sizeof(double));
+        filled += clients[i].count;
+        free(clients[i].latencies);
+    }
+    qsort(latencies, total, sizeof(double), compare_latencies);
+
+    printf("requests      %zu in %.2f s with %d connections, %ld errors\n", total, elapsed, connections, errors);
+    printf("requests/sec  %.0f\n", total / elapsed);
+    printf("throughput    %.1f MiB/s\n", bytes / elapsed / (1024 * 1024));
+    printf("latency (us)  p50 %.0f  p90 %.0f  p99 %.0f  p99.9 %.0f  max %.0f\n",
+           percentile(latencies, total, 0.50), percentile(latencies, total, 0.90),
+           percentile(latencies, total, 0.99), percentile(latencies, total, 0.999),
+           total > 0 ? latencies[total - 1] : 0);
+
+    free(latencies);
+    free(clients);
+    freeaddrinfo(address);
+    return 0;
+}
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE // Include for the open file description locks (F_OFD_SETLK), splice and F_SETPIPE_SZ
 #include <openssl/bio.h> // Include for OpenSSL BIO functions (Basic I/O abstract interface)
 #include <openssl/evp.h> // Include for OpenSSL's high-level cryptographic functions (EVP)
 #include <string.h> // Include for string handling functions, such as strlen
@@ -8,157 +9,113 @@
 #include <netinet/in.h> // Include for Internet Protocol family, such as sockaddr_in
 #include <sys/socket.h> // Include for socket functions and definitions
 #include <sys/types.h> // Include for system data types, such as socket types
-#include <sys/wait.h> // Include for process control, such as waitpid
 #include <signal.h> // Include for signal handling, such as signal function
 #include <errno.h> // Include for error number definitions, useful for error handling
 #include <arpa/inet.h> // Include for functions related to internet operations (inet_ntop, inet_pton)
 #include <netdb.h> // Include for network database operations (getnameinfo, getaddrinfo)
 #include <fcntl.h> // Include for file control options (fcntl function)
 #include <sys/stat.h> // Include for file status (used for mkdir function)
+#include <sys/epoll.h> // Include for the event loops multiplexing every connection
+#include <pthread.h> // Include for the fixed set of event loop threads
+#include <sys/sendfile.h> // Include for sendfile, which sends a file without copying it through user space
+#include <netinet/tcp.h> // Include for TCP_CORK
+#include <time.h> // Include for the monotonic clock idle connections are timed with
 
 #define PORT "8080" // Define the port number for the server
 #define BACKLOG 100 // Define the maximum number of pending connections
+#define MAX_EVENTS 64 // Events handled per epoll_wait call
+#define REQUEST_MAX 8192 // Longest request head (request line and headers) accepted
+#define IO_BUFFER_SIZE (64 * 1024) // Bytes moved between a file and a socket at a time
+#define LOCK_RETRY_MS 10 // How often a GET waiting for a file write-locked by another process tries again
+#define IDLE_TIMEOUT_MS 30000 // A connection whose client neither sends nor reads for this long is closed
+#define IDLE_SWEEP_MS 1000 // How often a loop with open connections looks for idle ones
+#define TRANSFER_CHUNK (4 * 1024 * 1024) // Most bytes one sendfile or splice call is asked to move
+#define PIPE_SIZE (1024 * 1024) // Capacity asked for the pipe of the splice path
+#define RECEIVE_BUFFER_SIZE (1024 * 1024) // Upload data received at a time, into a buffer every loop reuses
+#define LENGTH_HEADER "Content-Length:" // Header declaring the length of a body; also accepted after an original-form POST line
+#define CHUNK_HEADER_SPACE 10 // Room kept before chunk data for its size line: 8 hex digits and "\r\n"
+#define CHUNK_SIZE_DIGITS 15 // Most hex digits accepted in the size of a received chunk
 
-// Function to handle client requests
-void handle_client(int socket_client, char *home_path) {
-    char *encoded_str;
-    char buffer[1024]; // Buffer to store data from client
-    char msg[1024]; // Buffer to store messages to be sent to client
-    struct flock fl = { // File lock structure
-        .l_type = F_WRLCK, // Type of lock: Write lock
-        .l_whence = SEEK_SET, // Relative to the start of the file
-        .l_start = 0, // Start of the lock
-        .l_len = 0, // Length of the lock (0 = until EOF)
-    };
-
-    int len = recv(socket_client, buffer, sizeof(buffer) - 1, 0); // Receive data from client
-    buffer[len] = '\0'; // Null-terminate the received string
-    printf("Received Request: %s\n", buffer);
-    
-    // Check if the request starts with "POST"
-    if (strncmp(buffer, "POST", 4) == 0) {
-        // Extract the file path from the request
-        char *path = strtok(buffer + 5, "\r\n"); // Extract the path from the request
-        // Construct the complete file path including the home directory
-        char *file_path = (char *)malloc(strlen(home_path) + strlen(path) + 1); // Allocate memory for the file path
-        sprintf(file_path, "%s%s", home_path, path); // Concatenate the home path with the file path
-        printf("Requested File Path: %s\n", file_path);
-        
-        // Create the directory structure if necessary
-        char *dir_path = strdup(file_path); // Duplicate the file path
-        char *last_slash = strrchr(dir_path, '/'); // Find the last '/' character
-        if (last_slash != NULL) {
-            *last_slash = '\0'; // Set it to null to get the directory path
-            mkdir(dir_path, 0755); // Create the directory with permissions
-        }
-        free(dir_path); // Free the directory path
-        
-        // Open the file for writing
-        int fd = open(file_path, O_WRONLY | O_CREAT, 0644); // Open or create the file
-        
-        // Return an error if the file could not be opened
-        if (fd == -1) {
-            sprintf(msg, "HTTP/1.1 404 Not Found\r\n\r\n"); // Prepare the error message
-            send(socket_client, msg, strlen(msg), 0); // Send the error message to the client
-            free(file_path); // Free the file path
-            exit(1); // Exit with error
-        }
-        
-        // Acquire a write lock on the file
-        if (fcntl(fd, F_SETLK, &fl) == -1) {
-            sprintf(msg, "HTTP/1.1 500 Internal Server Error\r\n\r\n"); // Prepare the error message
-            send(socket_client, msg, strlen(msg), 0); // Send the error message to the client
-            free(file_path); // Free the file path
-            exit(1); // Exit with error
-        }
+// Methods of a request
+#define METHOD_NONE 0 // The request line has not arrived yet
+#define METHOD_GET 1
+#define METHOD_POST 2
 
-        // Process and write data to the file
-        char *data = buffer + 5 + strlen(path) + 2; // Move data pointer to start of content
-        len = len - (data - buffer); // Adjust len based on the new start position
-        
-        while (1) {
-            // Ensure null termination before processing
-            data[len] = '\0';
-            
-            // Check for end of data
-            if ((len >= 4) && strcmp(data + len - 4, "\r\n\r\n") == 0) {
-                len -= 4; // Adjust length to exclude "\r\n\r\n"
-                data[len] = '\0'; // Null-terminate the data
-                write(fd, data, strlen(data)); // Write the data to the file
-                break; // Break the loop
-            }
-            else {
-                write(fd, data, strlen(data)); // Write the data to the file
-                len = recv(socket_client, buffer, sizeof(buffer) - 1, 0); // Receive more data
-                data = buffer; // Reset pointer to the start of the buffer for new data
-                data[len] = '\0'; // Null-terminate the received data
-            }
-        }
+// States of the decoder of a POST body sent with chunked transfer encoding
+#define CHUNK_SIZE 0      // Reading the hex size of the next chunk
+#define CHUNK_EXTENSION 1 // Skipping the rest of the size line
+#define CHUNK_DATA 2      // Storing the data of a chunk
+#define CHUNK_DATA_END 3  // Expecting the "\r\n" after the data of a chunk
+#define CHUNK_TRAILER 4   // Skipping trailer lines up to the blank line that ends the body
 
-        // Release the lock
-        fl.l_type = F_UNLCK; // Set the lock type to unlock
-        fcntl(fd, F_SETLK, &fl); // Release the lock
-        
-        // Clean up and send response to client
-        free(file_path); // Free the file path
-        close(fd); // Close the file
-        
-        sprintf(msg, "HTTP/1.1 200 OK\r\n\r\n"); // Prepare the success message
-        send(socket_client, msg, strlen(msg), 0); // Send the success message to the client
-    }
-    else if (strncmp(buffer, "GET", 3) == 0) {
-        // Extract the file path from the request
-        char *path = strtok(buffer + 4, "\r\n\r\n"); // Extract the path from the request
-        
-        // Construct the complete file path including the home directory
-        char *file_path = (char *)malloc(strlen(home_path) + strlen(path) + 1); // Allocate memory for the file path
-        sprintf(file_path, "%s%s", home_path, path); // Concatenate the home path with the file path        
-        
-        // Open the file for reading
-        int fd = open(file_path, O_RDONLY); // Open the file for reading
-        
-        // Return an error if the file could not be opened
-        if (fd == -1) {
-            sprintf(msg, "HTTP/1.1 404 Not Found\r\n\r\n"); // Prepare the error message
-            perror("open"); // Print the error message to stderr
-            send(socket_client, msg, strlen(msg), 0); // Send the error message to the client
-            free(file_path); // Free the file path
-            exit(1); // Exit with error
-        }
-        
-        // Put a read lock on the file
-        fl.l_type = F_RDLCK; // Set the lock type to read lock
-        if (fcntl(fd, F_SETLKW, &fl) == -1) {
-            sprintf(msg, "HTTP/1.1 500 Internal Server Error\r\n\r\n"); // Prepare the error message
-            perror("fcntl"); // Print the error message to stderr
-            send(socket_client, msg, strlen(msg), 0); // Send the error message to the client
-            free(file_path); // Free the file path
-            exit(1); // Exit with error
-        }
-        
-        // Read and send file contents
-        while (1) {
-            len = read(fd, buffer, sizeof(buffer)); // Read data from the file
-            if (len <= 0) break; // Break the loop if end of file or error
-            send(socket_client, buffer, len, 0); // Send the data to the client
-        }
+// Ways a GET sends its file, each the fallback of the one before
+#define TRANSFER_SENDFILE 0 // sendfile from the page cache to the socket
+#define TRANSFER_SPLICE 1   // splice from the file into a pipe and from the pipe to the socket
+#define TRANSFER_COPY 2     // read into the connection's buffer and send it
+#define TRANSFER_UNSUPPORTED 2 // Returned by a way that cannot send this file (the others return 1, 0 or -1)
 
-        // Release the lock
-        fl.l_type = F_UNLCK; // Set the lock type to unlock
-        fcntl(fd, F_SETLK, &fl); // Release the lock
-        
-        // Clean up and close the file
-        free(file_path); // Free the file path
-        close(fd); // Close the file
-    }
-    else {
-        // Handle invalid request
-        sprintf(msg, "HTTP/1.1 500 Internal Server Error\r\n\r\n"); // Prepare the error message
-        printf("Invalid request received\n"); // Print to stdout
-        send(socket_client, msg, strlen(msg), 0); // Send the error message to the client
-        exit(1); // Exit with error
-    }
-}
+// States of a connection
+#define STATE_REQUEST 0 // Reading the request head
+#define STATE_RECEIVE 1 // Storing the body of a POST until its declared length, its last chunk or its terminator
+#define STATE_LOCKED 2  // A GET waiting for another process to release its write lock on the file
+#define STATE_SEND 3    // Sending the reply, then the file of a GET
+
+// Structure representing one client connection, owned by the event loop that accepted it
+typedef struct connection {
+    int socket; // Client socket
+    int state; // STATE_*
+    int file; // File being sent or received, -1 if none
+    char request[REQUEST_MAX]; // Request head received so far; its lines are cut into strings as they are parsed
+    size_t request_len; // Bytes in request
+    size_t parsed; // Bytes of request already split into lines
+    int method; // METHOD_*
+    char *path; // Requested path, inside request
+    int http; // Non-zero for a request line with an HTTP version: the reply carries headers too
+    int headers; // Non-zero when header lines follow the request line
+    long long content_length; // Declared body length, -1 if none
+    int chunked; // Non-zero for a body sent with chunked transfer encoding
+    int error; // Status a malformed header fails the request with, 0 if none
+    int keep_alive; // Non-zero when the connection stays open for the next request once the reply is out
+    char head[256]; // Status line and headers of the reply, when they are built for it
+    const char *reply; // Status message or head sent before the file, NULL for none
+    size_t reply_sent; // Bytes of reply already sent
+    char buffer[IO_BUFFER_SIZE]; // File data on its way to the client, or body data on its way to the file
+    size_t buffer_len; // Bytes in buffer
+    size_t buffer_sent; // Bytes of buffer already sent
+    int terminator_matched; // Bytes of "\r\n\r\n" matched at the end of the body received so far
+    int file_done; // Non-zero once the whole file was read
+    int transfer; // TRANSFER_* used for the file of a GET
+    off_t offset; // Bytes of the file sent so far
+    off_t file_size; // Size of the file when the GET started, -1 if not a regular file
+    int pipe_fds[2]; // Pipe of the splice path, -1 until it is needed
+    size_t pipe_len; // Bytes waiting in the pipe
+    char *temp_path; // Temporary file an upload is written to, NULL when not uploading
+    char *target_path; // File the temporary file replaces once the upload is complete
+    long long body_remaining; // Bytes of a declared body or of the current chunk still to come, -1 when "\r\n\r\n" ends the body
+    int chunk_state; // CHUNK_* of a chunked body
+    int chunk_digits; // Digits of the chunk size, or characters of the trailer line, read so far
+    int chunked_reply; // Non-zero when the file of a GET is sent in chunks, its size being unknown
+    int last_chunk_sent; // Non-zero once the empty chunk ending a chunked reply was queued
+    struct connection *next_waiting; // Next GET waiting for a lock on the same loop
+    long long last_active; // Time of the last event of the connection, in milliseconds
+    struct connection *older; // Neighbours in the loop's list of connections, ordered by last_active
+    struct connection *newer;
+} connection;
+
+// Structure representing one event loop thread
+typedef struct event_loop {
+    int epoll_fd; // epoll instance of the loop
+    int listener; // SO_REUSEPORT listener of the loop
+    connection *waiting; // GETs waiting for a file lock
+    connection *oldest; // Connection that was idle longest; the sweep starts here
+    connection *newest; // Connection that had an event last
+    long long now; // Time the last epoll_wait returned, in milliseconds
+    long long next_sweep; // Time of the next look for idle connections
+    char *receive_buffer; // RECEIVE_BUFFER_SIZE bytes of upload data
+    pthread_t thread; // Thread running the loop
+} event_loop;
+
+char *home_path; // Directory the requested paths are relative to
 
 // Function to extract the client's IP address
 void *get_in_addr(struct sockaddr *sa) {
@@ -168,31 +125,13 @@ void *get_in_addr(struct sockaddr *sa) {
     return &(((struct sockaddr_in6*)sa)->sin6_addr); // Return IPv6 address
 }
 
-// Function to handle SIGCHLD signal to prevent zombie processes
-void sigchld_handler(int s) {
-    int saved_errno = errno; // Save the current value of errno
-    while(waitpid(-1, NULL, WNOHANG) > 0); // Wait for all child processes
-    errno = saved_errno; // Restore errno
-}
-
-int main(int argc, char *argv[]) {
-    int socket_server, socket_client; // Socket descriptors for server and client
+// Function to open a non-blocking listener; every loop opens its own and the kernel spreads the connections
+int open_listener() {
     struct addrinfo hints, *serv_info, *p; // Structures for storing address information
-    struct sockaddr_storage client_addr; // Client's address
-    socklen_t addr_size; // Size of the client address
-    struct sigaction sa; // Structure for signal action
+    int socket_server = -1; // Socket descriptor of the listener
     int yes = 1; // Used for setsockopt
-    char ipstr[INET6_ADDRSTRLEN]; // String to store client's IP address
     int rv; // Return value for getaddrinfo
 
-    // Check if the correct number of arguments are passed
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <home_directory>\n", argv[0]);
-        exit(1);
-    }
-
-    char *home_path = argv[1]; // Get the home directory from command line arguments
-
     memset(&hints, 0, sizeof(hints)); // Clear the hints structure
     hints.ai_family = AF_UNSPEC; // Set the address family to unspecified
     hints.ai_socktype = SOCK_STREAM; // Set the socket type to stream
@@ -201,18 +140,19 @@ int main(int argc, char *argv[]) {
     // Get server's address information
     if ((rv = getaddrinfo(NULL, PORT, &hints, &serv_info)) != 0) {
         fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(rv));
-        return 1;
+        exit(1);
     }
 
     // Loop through all results and bind to the first we can
     for (p = serv_info; p != NULL; p = p->ai_next) {
-        socket_server = socket(p->ai_family, p->ai_socktype, p->ai_protocol); // Create a socket
+        socket_server = socket(p->ai_family, p->ai_socktype | SOCK_NONBLOCK, p->ai_protocol); // Create a socket
         if (socket_server == -1) {
             perror("server: socket");
             continue;
         }
 
-        if (setsockopt(socket_server, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(int)) == -1) {
+        if (setsockopt(socket_server, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(int)) == -1 ||
+            setsockopt(socket_server, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(int)) == -1) {
             perror("setsockopt");
             exit(1);
         }
@@ -237,38 +177,839 @@ int main(int argc, char *argv[]) {
         perror("listen");
         exit(1);
     }
+    return socket_server;
+}
 
-    // Set up the signal handler to reap zombie processes
-    sa.sa_handler = sigchld_handler; // Point to the handler function
-    sigemptyset(&sa.sa_mask); // Clear the mask
-    sa.sa_flags = SA_RESTART; // Automatically restart system calls
-    if (sigaction(SIGCHLD, &sa, NULL) == -1) {
-        perror("sigaction");
-        exit(1);
+// Function to change the events a connection is watched for
+void watch_connection(event_loop *loop, connection *conn, uint32_t events) {
+    struct epoll_event event = { .events = events, .data.ptr = conn };
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, conn->socket, &event) == -1) {
+        perror("epoll_ctl");
     }
+}
 
-    printf("Server is waiting for connections on port %s...\n", PORT);
+// Function to return the time of the monotonic clock in milliseconds
+long long monotonic_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-    // Main accept() loop
-    while (1) {
-        addr_size = sizeof(client_addr); // Set the size of the client address
-        socket_client = accept(socket_server, (struct sockaddr *)&client_addr, &addr_size); // Accept a connection
-        if (socket_client == -1) {
-            perror("accept");
+// Function to take a connection off the loop's list of connections
+void unlink_connection(event_loop *loop, connection *conn) {
+    if (conn->older != NULL) conn->older->newer = conn->newer;
+    else loop->oldest = conn->newer;
+    if (conn->newer != NULL) conn->newer->older = conn->older;
+    else loop->newest = conn->older;
+}
+
+// Function to mark a connection active now, moving it to the new end of the loop's list
+void touch_connection(event_loop *loop, connection *conn) {
+    conn->last_active = loop->now;
+    if (loop->newest == conn) return;
+    if (conn->older != NULL || loop->oldest == conn) unlink_connection(loop, conn); // A new connection is not listed yet
+    conn->older = loop->newest;
+    conn->newer = NULL;
+    if (loop->newest != NULL) loop->newest->newer = conn;
+    else loop->oldest = conn;
+    loop->newest = conn;
+}
+
+// Function to close a connection and free everything it holds
+void close_connection(event_loop *loop, connection *conn) {
+    unlink_connection(loop, conn);
+    if (conn->state == STATE_LOCKED) { // Take it off the list of waiting GETs
+        connection **link = &loop->waiting;
+        while (*link != conn) link = &(*link)->next_waiting;
+        *link = conn->next_waiting;
+    }
+    if (conn->file != -1) close(conn->file); // Closing the descriptor releases its lock
+    if (conn->temp_path != NULL) { // An upload that did not complete leaves the old file in place
+        unlink(conn->temp_path);
+        free(conn->temp_path);
+        free(conn->target_path);
+    }
+    if (conn->pipe_fds[0] != -1) {
+        close(conn->pipe_fds[0]);
+        close(conn->pipe_fds[1]);
+    }
+    close(conn->socket); // Also removes it from the epoll instance
+    free(conn);
+}
+
+// Function to send a reply with nothing after it
+void send_reply(event_loop *loop, connection *conn, const char *reply) {
+    conn->reply = reply;
+    conn->reply_sent = 0;
+    conn->state = STATE_SEND;
+    conn->file_done = 1; // Nothing follows the reply
+    conn->buffer_len = conn->buffer_sent = 0;
+    watch_connection(loop, conn, EPOLLOUT);
+}
+
+// Function to return the reason phrase of a status code
+const char *status_text(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 411: return "Length Required";
+    case 431: return "Request Header Fields Too Large";
+    case 501: return "Not Implemented";
+    default: return "Internal Server Error";
+    }
+}
+
+// Function to return the Connection header of a reply
+const char *connection_header(connection *conn) {
+    return conn->keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+}
+
+// Function to send a status without a body. After an error the rest of the stream cannot be trusted, nor after a POST
+// refused before its body was read, so the connection closes once it is out.
+// A request in the original form gets the bare status line it always got, which only knew 200, 404 and 500.
+void send_status(event_loop *loop, connection *conn, int status) {
+    if (status != 200 && status != 404) conn->keep_alive = 0;
+    if (conn->method == METHOD_POST && conn->state != STATE_RECEIVE) conn->keep_alive = 0; // Its body was never read
+    if (conn->http) {
+        snprintf(conn->head, sizeof(conn->head), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\n%s\r\n", status, status_text(status), connection_header(conn));
+    } else {
+        if (status != 200 && status != 404) status = 500;
+        snprintf(conn->head, sizeof(conn->head), "HTTP/1.1 %d %s\r\n\r\n", status, status_text(status));
+    }
+    send_reply(loop, conn, conn->head);
+}
+
+// Function to build the path of a requested file in the home directory; the caller frees it
+char *build_file_path(const char *path) {
+    char *file_path = (char *)malloc(strlen(home_path) + strlen(path) + 1); // Allocate memory for the file path
+    if (file_path == NULL) {
+        perror("malloc");
+        return NULL;
+    }
+    sprintf(file_path, "%s%s", home_path, path); // Concatenate the home path with the file path
+    return file_path;
+}
+
+// Function to take the read lock a GET needs; returns 0 once locked, 1 while another process write-locks the file, -1 on error.
+// Uploads to this server are renamed into place and take no lock; the read lock only keeps out other programs
+// that rewrite the file in place under a write lock.
+int lock_for_reading(int fd) {
+    struct flock fl = { .l_type = F_RDLCK, .l_whence = SEEK_SET, .l_start = 0, .l_len = 0, .l_pid = 0 };
+    if (fcntl(fd, F_OFD_SETLK, &fl) == 0) return 0;
+    return (errno == EAGAIN || errno == EACCES) ? 1 : -1;
+}
+
+// Function to write all of a buffer to a file
+void write_file(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len); // Write the data to the file
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            perror("write");
+            return;
+        }
+        data += written;
+        len -= written;
+    }
+}
+
+// Function to store body data of a POST, stopping at the "\r\n\r\n" that ends it; returns 1 once it was found.
+// The bytes that may start the terminator are held back, so it is found however the reads split it.
+int store_terminated_body(connection *conn, const char *data, size_t len) {
+    static const char terminator[] = "\r\n\r\n";
+    size_t held = conn->terminator_matched; // Held back by earlier reads: the start of the terminator
+    size_t end = len; // Bytes of data the stream is examined up to
+    int found = 0;
+    const char *cr = memchr(data, '\r', len); // No terminator can start before the first "\r"
+    if (held == 0 && cr == NULL) {
+        write_file(conn->file, data, len);
+        return 0;
+    }
+    for (size_t i = held == 0 ? (size_t)(cr - data) : 0; i < len; i++) {
+        if (data[i] == terminator[conn->terminator_matched]) conn->terminator_matched++;
+        else conn->terminator_matched = data[i] == '\r' ? 1 : 0; // A "\r" may start a new match
+        if (conn->terminator_matched == 4) {
+            end = i + 1;
+            found = 1;
+            break;
+        }
+    }
+    // Everything but the (possible) terminator at the end of held bytes followed by data[0..end) is file data
+    size_t file_len = held + end - conn->terminator_matched;
+    size_t from_held = held < file_len ? held : file_len;
+    write_file(conn->file, terminator, from_held); // Held bytes that turned out to be data
+    if (file_len > from_held) write_file(conn->file, data, file_len - from_held);
+    return found;
+}
+
+// Function to return the value of a hex digit, -1 for any other character
+int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Function to store body data of a POST sent in chunks; returns 1 once the last chunk arrived, -1 for a malformed body.
+// Only the framing is looked at byte by byte: the data of a chunk is written as it is. Sets used to the bytes of the body.
+int store_chunked_body(connection *conn, const char *data, size_t len, size_t *used) {
+    size_t i = 0;
+    while (i < len) {
+        if (conn->chunk_state == CHUNK_DATA) {
+            size_t part = len - i;
+            if ((long long)part > conn->body_remaining) part = conn->body_remaining;
+            write_file(conn->file, data + i, part);
+            conn->body_remaining -= part;
+            i += part;
+            if (conn->body_remaining == 0) conn->chunk_state = CHUNK_DATA_END;
             continue;
         }
+        char c = data[i++];
+        if (conn->chunk_state == CHUNK_SIZE) {
+            int digit = hex_digit(c);
+            if (digit >= 0) {
+                if (conn->chunk_digits == CHUNK_SIZE_DIGITS) return -1; // Larger than any file
+                conn->body_remaining = conn->body_remaining * 16 + digit;
+                conn->chunk_digits++;
+                continue;
+            }
+            if (conn->chunk_digits == 0) return -1; // No size
+            conn->chunk_state = CHUNK_EXTENSION; // The character is looked at as the rest of the line
+        }
+        if (conn->chunk_state == CHUNK_EXTENSION) {
+            if (c != '\n') continue; // Chunk extensions are ignored
+            conn->chunk_state = conn->body_remaining > 0 ? CHUNK_DATA : CHUNK_TRAILER; // The empty chunk is the last
+            conn->chunk_digits = 0;
+        } else if (conn->chunk_state == CHUNK_DATA_END) {
+            if (c == '\n') {
+                conn->chunk_state = CHUNK_SIZE;
+                conn->chunk_digits = 0;
+            } else if (c != '\r') {
+                return -1; // The chunk was longer than its size
+            }
+        } else if (c == '\n') { // CHUNK_TRAILER: trailer fields are ignored, a blank line ends the body
+            if (conn->chunk_digits == 0) {
+                *used = i; // What follows is the next request
+                return 1;
+            }
+            conn->chunk_digits = 0;
+        } else if (c != '\r') {
+            conn->chunk_digits++;
+        }
+    }
+    *used = len;
+    return 0;
+}
+
+// Function to store body data of a POST; returns 1 once the body is complete, -1 for a malformed body.
+// Sets used to the bytes that belonged to the body: past a declared length or the last chunk the next request starts.
+int store_body(connection *conn, const char *data, size_t len, size_t *used) {
+    if (conn->chunked) return store_chunked_body(conn, data, len, used);
+    *used = len;
+    if (conn->body_remaining < 0) return store_terminated_body(conn, data, len); // Only the original form has one
+    if ((long long)len > conn->body_remaining) len = conn->body_remaining;
+    *used = len;
+    write_file(conn->file, data, len);
+    conn->body_remaining -= len;
+    return conn->body_remaining == 0;
+}
+
+// Function to finish a POST once its body is complete: the temporary file atomically replaces the target
+void finish_post(event_loop *loop, connection *conn) {
+    close(conn->file); // Close the file
+    conn->file = -1;
+    int renamed = rename(conn->temp_path, conn->target_path); // Readers see the old file or the new one, never a partial one
+    if (renamed == -1) {
+        perror("rename");
+        unlink(conn->temp_path);
+    }
+    free(conn->temp_path);
+    free(conn->target_path);
+    conn->temp_path = conn->target_path = NULL;
+    if (renamed == -1) send_status(loop, conn, 500);
+    else send_status(loop, conn, 200); // Send the success message to the client
+}
+
+// Function to start a POST: create the temporary file the body is streamed to, reserve the declared
+// length on disk and store the part of the body that came with the request.
+// A length of -1 means the body ends with "\r\n\r\n", unless it is sent in chunks.
+void start_post(event_loop *loop, connection *conn, const char *body, size_t body_len, long long length) {
+    char *file_path = build_file_path(conn->path);
+    if (file_path == NULL) {
+        send_status(loop, conn, 500);
+        return;
+    }
+    printf("Requested File Path: %s\n", file_path);
+
+    // Create the directory structure if necessary
+    char *dir_path = strdup(file_path); // Duplicate the file path
+    char *last_slash = dir_path != NULL ? strrchr(dir_path, '/') : NULL; // Find the last '/' character
+    if (last_slash != NULL) {
+        *last_slash = '\0'; // Set it to null to get the directory path
+        mkdir(dir_path, 0755); // Create the directory with permissions
+    }
+    free(dir_path); // Free the directory path
+
+    // Write to a unique file next to the target, so a rename can replace it
+    char *temp_path = (char *)malloc(strlen(file_path) + sizeof(".upload-XXXXXX"));
+    if (temp_path != NULL) sprintf(temp_path, "%s.upload-XXXXXX", file_path);
+    conn->file = temp_path != NULL ? mkostemp(temp_path, O_CLOEXEC) : -1; // Create the file
+    if (conn->file == -1) {
+        free(temp_path);
+        free(file_path); // Free the file path
+        send_status(loop, conn, 404); // Return an error if the file could not be created
+        return;
+    }
+    fchmod(conn->file, 0644); // mkostemp creates it private
+    conn->temp_path = temp_path;
+    conn->target_path = file_path;
+
+    // Reserve the space up front: a full disk fails the upload now, and the file is laid out in one piece
+    if (length > 0 && fallocate(conn->file, 0, 0, length) == -1 && errno != EOPNOTSUPP) {
+        perror("fallocate");
+        send_status(loop, conn, 500); // The reply closes the connection, which removes the file
+        return;
+    }
+
+    conn->state = STATE_RECEIVE;
+    conn->terminator_matched = 0;
+    conn->body_remaining = conn->chunked ? 0 : length;
+    conn->chunk_state = CHUNK_SIZE;
+    conn->chunk_digits = 0;
+    size_t used = 0;
+    int stored = length == 0 && !conn->chunked ? 1 : store_body(conn, body, body_len, &used);
+    conn->parsed += used; // The body came from the request buffer
+    if (stored < 0) send_status(loop, conn, 400); // The reply closes the connection, which removes the file
+    else if (stored > 0) finish_post(loop, conn);
+}
+
+// Function to hold back partial TCP segments while a response is assembled, or send what is held back
+void set_cork(connection *conn, int on) {
+    if (setsockopt(conn->socket, IPPROTO_TCP, TCP_CORK, &on, sizeof(on)) == -1) perror("setsockopt");
+}
+
+// Function to start sending a file to a GET whose lock was granted
+void start_sending(event_loop *loop, connection *conn) {
+    struct stat file_stat;
+    conn->state = STATE_SEND;
+    conn->reply = NULL;
+    conn->buffer_len = conn->buffer_sent = 0;
+    conn->file_done = 0;
+    conn->transfer = TRANSFER_SENDFILE;
+    conn->offset = 0;
+    conn->file_size = fstat(conn->file, &file_stat) == 0 && S_ISREG(file_stat.st_mode) ? file_stat.st_size : -1;
+    conn->chunked_reply = conn->http && conn->file_size < 0; // A file of unknown size goes in chunks
+    conn->last_chunk_sent = 0;
+    if (conn->chunked_reply) {
+        conn->transfer = TRANSFER_COPY; // Only the copy path can frame the data
+        snprintf(conn->head, sizeof(conn->head), "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n%s\r\n", connection_header(conn));
+    } else if (conn->http) {
+        snprintf(conn->head, sizeof(conn->head), "HTTP/1.1 200 OK\r\nContent-Length: %lld\r\n%s\r\n", (long long)conn->file_size, connection_header(conn));
+    }
+    if (conn->http) conn->reply = conn->head; // The original form gets the file alone
+    conn->reply_sent = 0;
+    set_cork(conn, 1); // Whatever precedes the file leaves in full segments together with it
+    watch_connection(loop, conn, EPOLLOUT);
+}
+
+// Function to start a GET: open the file and lock it, or wait for the process holding a write lock on it
+void start_get(event_loop *loop, connection *conn) {
+    char *file_path = build_file_path(conn->path);
+    if (file_path == NULL) {
+        send_status(loop, conn, 500);
+        return;
+    }
+    conn->file = open(file_path, O_RDONLY | O_CLOEXEC); // Open the file for reading
+    if (conn->file == -1) {
+        perror("open"); // Print the error message to stderr
+        free(file_path); // Free the file path
+        send_status(loop, conn, 404); // Return an error if the file could not be opened
+        return;
+    }
+    free(file_path); // Free the file path
+
+    // Only files have contents to send: a regular file, or a FIFO or character device of unknown size sent in chunks.
+    // A directory opens too, but would pass for an empty file.
+    struct stat file_stat;
+    if (fstat(conn->file, &file_stat) == -1 ||
+        !(S_ISREG(file_stat.st_mode) || S_ISFIFO(file_stat.st_mode) || S_ISCHR(file_stat.st_mode))) {
+        close(conn->file);
+        conn->file = -1;
+        send_status(loop, conn, 404);
+        return;
+    }
+
+    int locked = lock_for_reading(conn->file); // Put a read lock on the file
+    if (locked < 0) {
+        perror("fcntl"); // Print the error message to stderr
+        send_status(loop, conn, 500);
+    } else if (locked > 0) { // Wait for the writer without holding up the loop
+        conn->state = STATE_LOCKED;
+        conn->next_waiting = loop->waiting;
+        loop->waiting = conn;
+        watch_connection(loop, conn, 0);
+    } else {
+        start_sending(loop, conn);
+    }
+}
+
+// Function to act on the request line; a version after the path ("GET path HTTP/1.1") marks the HTTP form,
+// whose headers follow up to a blank line. The original form is the method and the path alone, and the
+// connection closes after its reply; in the HTTP form it stays open unless HTTP/1.0 or "Connection: close" says otherwise.
+void parse_request_line(event_loop *loop, connection *conn, char *line) {
+    printf("Received Request: %s\n", line);
+    char *version = strrchr(line, ' ');
+    if (version != NULL && strncmp(version + 1, "HTTP/", 5) == 0) {
+        conn->keep_alive = strcmp(version + 1, "HTTP/1.0") != 0;
+        *version = '\0'; // Cut the version off the path
+        conn->http = conn->headers = 1;
+    }
+    if (strncmp(line, "GET ", 4) == 0) {
+        conn->method = METHOD_GET;
+        conn->path = line + 4;
+    } else if (strncmp(line, "POST ", 5) == 0) {
+        conn->method = METHOD_POST;
+        conn->path = line + 5;
+    } else {
+        printf("Invalid request received\n"); // Print to stdout
+        send_status(loop, conn, conn->http ? 501 : 500);
+    }
+}
+
+// Function to act on one header line of a request; the ones that do not frame the body are ignored
+void parse_header(connection *conn, char *line) {
+    char *colon = strchr(line, ':');
+    if (colon == NULL) {
+        conn->error = 400;
+        return;
+    }
+    char *value = colon + 1;
+    while (*value == ' ' || *value == '\t') value++; // Skip the whitespace around the value
+    char *value_end = value + strlen(value);
+    while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) *--value_end = '\0';
+
+    if (strncasecmp(line, LENGTH_HEADER, strlen(LENGTH_HEADER)) == 0) {
+        char *end;
+        errno = 0;
+        long long length = strtoll(value, &end, 10);
+        if (end == value || *end != '\0' || length < 0 || errno == ERANGE ||
+            (conn->content_length >= 0 && conn->content_length != length)) {
+            conn->error = 400; // Not a length, or two different ones
+        }
+        conn->content_length = length;
+    } else if (colon - line == 17 && strncasecmp(line, "Transfer-Encoding", 17) == 0) {
+        if (strcasecmp(value, "chunked") == 0) conn->chunked = 1;
+        else conn->error = 501; // No other coding is understood
+    } else if (colon - line == 10 && strncasecmp(line, "Connection", 10) == 0) {
+        if (strcasecmp(value, "close") == 0) conn->keep_alive = 0;
+        else if (strcasecmp(value, "keep-alive") == 0) conn->keep_alive = conn->http;
+    }
+}
+
+// Function to act on a request whose head is complete; the bytes after the head start the body of a POST.
+// A GET declaring a body is refused: the 400 closes the connection, so nothing behind it is taken for a request.
+void start_request(event_loop *loop, connection *conn) {
+    const char *body = conn->request + conn->parsed;
+    size_t body_len = conn->request_len - conn->parsed;
+    if (conn->error != 0) send_status(loop, conn, conn->error);
+    else if (conn->method == METHOD_GET && (conn->chunked || conn->content_length > 0)) send_status(loop, conn, 400); // Its body would be read as the next request
+    else if (conn->method == METHOD_GET) start_get(loop, conn);
+    else if (conn->chunked || conn->content_length >= 0) start_post(loop, conn, body, body_len, conn->content_length);
+    else send_status(loop, conn, 411); // Nothing would tell where the body ends
+}
+
+// Function to split the request head into lines as it arrives; every byte of it is looked at once, however the reads split it.
+// The original form starts at its request line, except that a POST's request line may be followed by
+// "Content-Length: N" and a blank line; a body in the original form is base64, which has no '-' or ':'.
+void parse_request(event_loop *loop, connection *conn) {
+    size_t header_len = strlen(LENGTH_HEADER);
+    while (conn->state == STATE_REQUEST) {
+        char *line = conn->request + conn->parsed;
+        size_t available = conn->request_len - conn->parsed;
+        int full = conn->request_len == sizeof(conn->request) - 1;
+        if (conn->method == METHOD_POST && !conn->headers) { // A body, or a length declaration before it
+            if (strncasecmp(line, LENGTH_HEADER, available < header_len ? available : header_len) != 0) {
+                start_post(loop, conn, line, available, -1); // The body ends with "\r\n\r\n"
+                return;
+            }
+            if (available < header_len) {
+                if (full) send_status(loop, conn, 500);
+                return; // Wait for the rest of the declaration
+            }
+            conn->headers = 1;
+        }
+
+        char *newline = memchr(line, '\n', available);
+        if (newline == NULL) {
+            if (full) send_status(loop, conn, conn->method == METHOD_NONE ? 500 : 431); // The line does not fit in the buffer
+            return;
+        }
+        size_t line_len = newline - line;
+        if (line_len > 0 && line[line_len - 1] == '\r') line_len--;
+        line[line_len] = '\0'; // Cut the line off what follows it
+        conn->parsed = newline + 1 - conn->request;
+
+        if (conn->method == METHOD_NONE) {
+            parse_request_line(loop, conn, line);
+            if (conn->method == METHOD_GET && !conn->headers) start_get(loop, conn);
+        } else if (line_len > 0) {
+            parse_header(conn, line);
+        } else {
+            start_request(loop, conn); // The blank line ends the head
+        }
+    }
+}
+
+// Function to read the request head of a connection; returns -1 when the connection has to be closed
+int read_request(event_loop *loop, connection *conn) {
+    ssize_t len = recv(conn->socket, conn->request + conn->request_len, sizeof(conn->request) - 1 - conn->request_len, 0);
+    if (len < 0) return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    if (len == 0) return -1; // The client left before sending a request
+    conn->request_len += len;
+    conn->request[conn->request_len] = '\0';
+    parse_request(loop, conn);
+    return 0;
+}
+
+// Function to receive body data of a POST; returns -1 when the connection has to be closed
+int receive_body(event_loop *loop, connection *conn) {
+    size_t wanted = RECEIVE_BUFFER_SIZE;
+    if (!conn->chunked && conn->body_remaining >= 0 && conn->body_remaining < (long long)wanted) wanted = conn->body_remaining;
+    ssize_t len = recv(conn->socket, loop->receive_buffer, wanted, 0);
+    if (len < 0) return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    if (len == 0) return -1; // The client left before the end of the body; the target file is untouched
+    size_t used;
+    int stored = store_body(conn, loop->receive_buffer, len, &used);
+    if (stored > 0 && used < (size_t)len) { // The client sent its next request behind a chunked body
+        if (len - used < sizeof(conn->request)) {
+            memcpy(conn->request, loop->receive_buffer + used, len - used);
+            conn->request_len = len - used;
+            conn->parsed = 0;
+        } else {
+            conn->keep_alive = 0; // More than a request head: give up on the connection after this reply
+        }
+    }
+    if (stored < 0) send_status(loop, conn, 400);
+    else if (stored > 0) finish_post(loop, conn);
+    return 0;
+}
+
+// Function to return how many bytes of the file the next sendfile or splice call should move
+size_t transfer_chunk(connection *conn) {
+    if (conn->file_size < 0 || conn->file_size - conn->offset > TRANSFER_CHUNK) return TRANSFER_CHUNK;
+    return conn->file_size - conn->offset;
+}
+
+// Function to end a transfer that stopped short of the length its head promised, or failed to read the file.
+// The head is out already, so only closing the connection can tell the client; returns -1 to close it.
+int cut_transfer(connection *conn) {
+    conn->keep_alive = 0;
+    return -1;
+}
+
+// Function to send the rest of a file with sendfile, which hands the page cache straight to the socket.
+// Returns 1 once the file was sent, 0 when the socket is full, -1 on error and TRANSFER_UNSUPPORTED.
+int send_with_sendfile(connection *conn) {
+    while (conn->file_size < 0 || conn->offset < conn->file_size) {
+        ssize_t sent = sendfile(conn->socket, conn->file, &conn->offset, transfer_chunk(conn));
+        if (sent > 0) continue;
+        if (sent == 0) return conn->file_size < 0 ? 1 : cut_transfer(conn); // End of file: its size was unknown, or it shrank meanwhile
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        if (errno == EINTR) continue;
+        if (errno == EINVAL || errno == ENOSYS) return TRANSFER_UNSUPPORTED; // A file the page cache cannot hand out
+        return -1; // EPIPE or ECONNRESET: the client is gone
+    }
+    return 1;
+}
+
+// Function to send the rest of a file by splicing it through a pipe, for files sendfile cannot send.
+// Returns like send_with_sendfile.
+int send_with_splice(connection *conn) {
+    if (conn->pipe_fds[0] == -1) {
+        if (pipe2(conn->pipe_fds, O_NONBLOCK | O_CLOEXEC) == -1) return TRANSFER_UNSUPPORTED;
+        fcntl(conn->pipe_fds[1], F_SETPIPE_SZ, PIPE_SIZE); // Fewer round trips; the default size is fine too
+    }
+    while (1) {
+        if (conn->pipe_len == 0) { // Refill the pipe from the file
+            if (conn->file_size >= 0 && conn->offset >= conn->file_size) return 1;
+            ssize_t moved = splice(conn->file, &conn->offset, conn->pipe_fds[1], NULL, transfer_chunk(conn), SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (moved == 0) return conn->file_size < 0 ? 1 : cut_transfer(conn); // End of file
+            if (moved < 0) {
+                if (errno == EINTR) continue;
+                return errno == EINVAL ? TRANSFER_UNSUPPORTED : -1;
+            }
+            conn->pipe_len = moved;
+        }
+        ssize_t sent = splice(conn->pipe_fds[0], NULL, conn->socket, NULL, conn->pipe_len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1; // EPIPE or ECONNRESET: the client is gone
+        }
+        conn->pipe_len -= sent;
+    }
+}
+
+// Function to read the next part of a file into the connection's buffer; returns the bytes read, 0 at the end
+// and -1 when the file could not be read to its end. In a chunked reply the data is framed as one chunk,
+// and the end of the file queues the empty chunk.
+ssize_t fill_buffer(connection *conn) {
+    size_t start = conn->chunked_reply ? CHUNK_HEADER_SPACE : 0; // Room for the size line
+    size_t room = sizeof(conn->buffer) - start - (conn->chunked_reply ? 2 : 0); // And for the "\r\n" after the data
+    if (conn->file_size >= 0 && conn->file_size - conn->offset < (off_t)room) room = conn->file_size - conn->offset; // No more than the declared length
+    ssize_t len = room > 0 ? pread(conn->file, conn->buffer + start, room, conn->offset) : 0; // Read data from the file
+    if (len < 0 && errno == ESPIPE) len = read(conn->file, conn->buffer + start, room); // Not seekable
+    if (len < 0 || (len == 0 && room > 0 && conn->file_size >= 0)) return cut_transfer(conn); // A read error, or the file shrank
+    conn->offset += len;
+    conn->buffer_sent = 0;
+    if (!conn->chunked_reply) {
+        conn->buffer_len = len;
+        return len;
+    }
+    if (len == 0) {
+        if (conn->last_chunk_sent) return 0;
+        conn->last_chunk_sent = 1;
+        memcpy(conn->buffer, "0\r\n\r\n", 5);
+        conn->buffer_len = 5;
+        return 5;
+    }
+    char size_line[CHUNK_HEADER_SPACE + 1];
+    int size_len = snprintf(size_line, sizeof(size_line), "%zx\r\n", (size_t)len);
+    conn->buffer_sent = start - size_len; // The size line ends right where the data starts
+    memcpy(conn->buffer + conn->buffer_sent, size_line, size_len);
+    memcpy(conn->buffer + start + len, "\r\n", 2);
+    conn->buffer_len = start + len + 2;
+    return len;
+}
+
+// Function to send the rest of a file through the connection's buffer, for files neither sendfile nor splice can send,
+// and for the chunks of a file whose size is unknown. Returns like send_with_sendfile.
+int send_with_copy(connection *conn) {
+    while (1) {
+        if (conn->buffer_sent == conn->buffer_len) { // Refill the buffer from the file
+            ssize_t filled = fill_buffer(conn);
+            if (filled <= 0) return filled == 0 ? 1 : -1;
+        }
+        ssize_t sent = send(conn->socket, conn->buffer + conn->buffer_sent, conn->buffer_len - conn->buffer_sent, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+        conn->buffer_sent += sent;
+    }
+}
+
+// Function to forget the request a connection served, keeping the bytes that followed it
+void reset_request(connection *conn) {
+    conn->state = STATE_REQUEST;
+    conn->method = METHOD_NONE;
+    conn->http = conn->headers = conn->chunked = conn->error = conn->keep_alive = 0;
+    conn->content_length = -1;
+    conn->reply = NULL;
+    size_t left = conn->request_len - conn->parsed; // Requests the client pipelined behind the last one
+    memmove(conn->request, conn->request + conn->parsed, left);
+    conn->request_len = left;
+    conn->request[left] = '\0';
+    conn->parsed = 0;
+}
+
+// Function to end a reply once all of it was sent and start on the next request of a kept-alive connection;
+// returns -1 when the connection has to be closed
+int end_reply(event_loop *loop, connection *conn) {
+    if (!conn->keep_alive) {
+        set_cork(conn, 0); // Send the last partial segment now
+        return -1; // The client reads until the connection closes
+    }
+    if (conn->file != -1) { // Releases the read lock of the GET
+        close(conn->file);
+        conn->file = -1;
+    }
+    reset_request(conn);
+    parse_request(loop, conn); // A pipelined request may be waiting in the buffer already
+    if (conn->state != STATE_SEND) set_cork(conn, 0); // Otherwise the next reply fills the last segment of this one
+    if (conn->state == STATE_REQUEST || conn->state == STATE_RECEIVE) watch_connection(loop, conn, EPOLLIN);
+    return 0;
+}
+
+// Function to send what a connection has to send, going on with the replies to requests pipelined behind it;
+// returns -1 when the connection has to be closed
+int send_data(event_loop *loop, connection *conn) {
+    while (conn->state == STATE_SEND) {
+        while (conn->reply != NULL && conn->reply[conn->reply_sent] != '\0') {
+            int more = conn->file_done ? 0 : MSG_MORE; // The reply and the start of the file share a segment
+            ssize_t sent = send(conn->socket, conn->reply + conn->reply_sent, strlen(conn->reply + conn->reply_sent), MSG_NOSIGNAL | more);
+            if (sent < 0) return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+            conn->reply_sent += sent;
+        }
+        if (!conn->file_done) {
+            int result;
+            while (1) {
+                if (conn->transfer == TRANSFER_SENDFILE) result = send_with_sendfile(conn);
+                else if (conn->transfer == TRANSFER_SPLICE) result = send_with_splice(conn);
+                else result = send_with_copy(conn);
+                if (result != TRANSFER_UNSUPPORTED || conn->transfer == TRANSFER_COPY) break;
+                conn->transfer++; // Fall back to the next way and carry on from the same offset
+            }
+            if (result != 1) return result;
+            conn->file_done = 1;
+        }
+        if (end_reply(loop, conn) < 0) return -1;
+    }
+    return 0;
+}
 
+// Function to accept the connections waiting on a loop's listener
+void accept_connections(event_loop *loop) {
+    struct sockaddr_storage client_addr; // Client's address
+    char ipstr[INET6_ADDRSTRLEN]; // String to store client's IP address
+    while (1) {
+        socklen_t addr_size = sizeof(client_addr); // Set the size of the client address
+        int socket_client = accept4(loop->listener, (struct sockaddr *)&client_addr, &addr_size, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (socket_client == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+            return;
+        }
         inet_ntop(client_addr.ss_family, get_in_addr((struct sockaddr *)&client_addr), ipstr, sizeof(ipstr)); // Get client's IP address
         printf("Incoming connection from: %s\n", ipstr); // Print client's IP address
 
-        if (!fork()) { // This is the child process
-            close(socket_server); // Child doesn't need the listener
-            handle_client(socket_client, home_path); // Handle the client request
-            close(socket_client); // Close the client socket
-            exit(0); // Exit the child process
+        connection *conn = (connection *)malloc(sizeof(connection));
+        if (conn == NULL) {
+            perror("malloc");
+            close(socket_client);
+            continue;
+        }
+        conn->socket = socket_client;
+        conn->file = -1;
+        conn->pipe_fds[0] = conn->pipe_fds[1] = -1;
+        conn->pipe_len = 0;
+        conn->temp_path = conn->target_path = NULL;
+        conn->request_len = conn->parsed = 0;
+        conn->older = conn->newer = NULL;
+        reset_request(conn);
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = conn };
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, socket_client, &event) == -1) {
+            perror("epoll_ctl");
+            close(socket_client);
+            free(conn);
+            continue;
+        }
+        touch_connection(loop, conn); // Listed from now on, so an idle client is closed too
+    }
+}
+
+// Function to retry the GETs waiting for another process to release its write lock on their file
+void retry_waiting(event_loop *loop) {
+    connection **link = &loop->waiting;
+    while (*link != NULL) {
+        connection *conn = *link;
+        int locked = lock_for_reading(conn->file);
+        if (locked == 1) {
+            link = &conn->next_waiting;
+            continue;
         }
+        *link = conn->next_waiting; // No longer waiting
+        if (locked == 0) {
+            start_sending(loop, conn);
+        } else {
+            perror("fcntl");
+            send_status(loop, conn, 500);
+        }
+    }
+}
 
-        close(socket_client); // Parent doesn't need the client socket
+// Function to close the connections whose client neither sent nor read anything for IDLE_TIMEOUT_MS,
+// so clients that open connections and go silent cannot hold their memory and descriptors forever.
+// A GET waiting for a lock is not idle: it waits for another process, not for its client.
+void close_idle_connections(event_loop *loop) {
+    while (loop->oldest != NULL && loop->now - loop->oldest->last_active >= IDLE_TIMEOUT_MS) {
+        connection *conn = loop->oldest;
+        if (conn->state == STATE_LOCKED) touch_connection(loop, conn); // Looked at again one timeout from now
+        else close_connection(loop, conn);
+    }
+    loop->next_sweep = loop->now + IDLE_SWEEP_MS;
+}
+
+// Thread function running one event loop: every transfer of the connections it accepted is multiplexed here
+void *run_event_loop(void *arg) {
+    event_loop *loop = (event_loop *)arg;
+    struct epoll_event events[MAX_EVENTS];
+    while (1) {
+        int timeout = loop->waiting != NULL ? LOCK_RETRY_MS : loop->oldest != NULL ? IDLE_SWEEP_MS : -1; // Nothing to time without connections
+        int count = epoll_wait(loop->epoll_fd, events, MAX_EVENTS, timeout);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            exit(1);
+        }
+        loop->now = monotonic_ms();
+        for (int i = 0; i < count; i++) {
+            connection *conn = (connection *)events[i].data.ptr;
+            if (conn == NULL) { // The listener
+                accept_connections(loop);
+                continue;
+            }
+            touch_connection(loop, conn); // The client sent something, read something, or left
+            int result = 0;
+            if (conn->state == STATE_REQUEST) result = read_request(loop, conn);
+            else if (conn->state == STATE_RECEIVE) result = receive_body(loop, conn);
+            else if (conn->state == STATE_SEND) result = send_data(loop, conn);
+            else if (events[i].events & (EPOLLHUP | EPOLLERR)) result = -1; // Waiting for a lock and the client is gone
+            if (result < 0) close_connection(loop, conn);
+        }
+        if (loop->waiting != NULL) retry_waiting(loop);
+        if (loop->now >= loop->next_sweep) close_idle_connections(loop);
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    // Check if the correct number of arguments are passed
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Usage: %s <home_directory> [threads]\n", argv[0]);
+        exit(1);
+    }
+
+    home_path = argv[1]; // Get the home directory from command line arguments
+    long threads = argc == 3 ? atol(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN); // One event loop per core by default
+    if (threads < 1) threads = 1;
+
+    // sendfile and splice have no MSG_NOSIGNAL: a client resetting mid-download must fail its send with EPIPE,
+    // not kill the process and every other connection with it
+    signal(SIGPIPE, SIG_IGN);
+
+    event_loop *loops = (event_loop *)calloc(threads, sizeof(event_loop));
+    if (loops == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    for (long i = 0; i < threads; i++) {
+        loops[i].listener = open_listener();
+        loops[i].receive_buffer = (char *)malloc(RECEIVE_BUFFER_SIZE);
+        if (loops[i].receive_buffer == NULL) {
+            perror("malloc");
+            exit(1);
+        }
+        loops[i].epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (loops[i].epoll_fd == -1) {
+            perror("epoll_create1");
+            exit(1);
+        }
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL }; // NULL marks the listener
+        if (epoll_ctl(loops[i].epoll_fd, EPOLL_CTL_ADD, loops[i].listener, &event) == -1) {
+            perror("epoll_ctl");
+            exit(1);
+        }
+    }
+
+    printf("Server is waiting for connections on port %s with %ld threads...\n", PORT, threads);
+
+    for (long i = 1; i < threads; i++) {
+        if (pthread_create(&loops[i].thread, NULL, run_event_loop, &loops[i]) != 0) {
+            perror("pthread_create");
+            exit(1);
+        }
     }
+    run_event_loop(&loops[0]); // The main thread runs the first loop
     return 0; // Return from the program
 }